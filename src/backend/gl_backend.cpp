@@ -0,0 +1,106 @@
+#include "gl_backend.hpp"
+#include "gl_program.hpp"
+#include <cstdint>
+
+auto GlBackend::create_buffer(const void *data, size_t bytes) -> GLuint
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bytes), data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return buffer;
+}
+
+void GlBackend::delete_buffer(GLuint buffer)
+{
+    glDeleteBuffers(1, &buffer);
+}
+
+auto GlBackend::create_vertex_array(GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout)
+    -> GLuint
+{
+    GLuint vertex_array = 0;
+    glGenVertexArrays(1, &vertex_array);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (const auto &attribute : layout)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+        auto *offset = reinterpret_cast<void *>(static_cast<uintptr_t>(attribute.offset));
+        // Integer attributes reach the shader unconverted, used for bone indices
+        if (attribute.integer != 0)
+        {
+            glVertexAttribIPointer(attribute.location, attribute.size, attribute.type, stride, offset);
+        }
+        else
+        {
+            glVertexAttribPointer(
+                attribute.location, attribute.size, attribute.type, attribute.normalized, stride, offset
+            );
+        }
+        glEnableVertexAttribArray(attribute.location);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vertex_array;
+}
+
+void GlBackend::delete_vertex_array(GLuint vertex_array)
+{
+    glDeleteVertexArrays(1, &vertex_array);
+}
+
+void GlBackend::bind_vertex_array(GLuint vertex_array)
+{
+    glBindVertexArray(vertex_array);
+}
+
+auto GlBackend::create_program(
+    std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+) -> GLuint
+{
+    return link_program_with_defines(vertex_source, fragment_source, defines);
+}
+
+void GlBackend::use_program(GLuint program)
+{
+    glUseProgram(program);
+}
+
+auto GlBackend::uniform_location(GLuint program, const char *name) -> GLint
+{
+    return glGetUniformLocation(program, name);
+}
+
+void GlBackend::set_uniform(GLint location, UniformKind kind, GLsizei count, const void *data)
+{
+    const auto *floats = static_cast<const GLfloat *>(data);
+    const auto *ints = static_cast<const GLint *>(data);
+    const auto *uints = static_cast<const GLuint *>(data);
+    // clang-format off
+    switch (kind)
+    {
+    case UniformKind::float1: glUniform1fv(location, count, floats); break;
+    case UniformKind::float2: glUniform2fv(location, count, floats); break;
+    case UniformKind::float3: glUniform3fv(location, count, floats); break;
+    case UniformKind::float4: glUniform4fv(location, count, floats); break;
+    case UniformKind::int1: glUniform1iv(location, count, ints); break;
+    case UniformKind::int2: glUniform2iv(location, count, ints); break;
+    case UniformKind::int3: glUniform3iv(location, count, ints); break;
+    case UniformKind::int4: glUniform4iv(location, count, ints); break;
+    case UniformKind::uint1: glUniform1uiv(location, count, uints); break;
+    case UniformKind::uint2: glUniform2uiv(location, count, uints); break;
+    case UniformKind::uint3: glUniform3uiv(location, count, uints); break;
+    case UniformKind::uint4: glUniform4uiv(location, count, uints); break;
+    case UniformKind::mat2: glUniformMatrix2fv(location, count, GL_FALSE, floats); break;
+    case UniformKind::mat3: glUniformMatrix3fv(location, count, GL_FALSE, floats); break;
+    case UniformKind::mat4: glUniformMatrix4fv(location, count, GL_FALSE, floats); break;
+    }
+    // clang-format on
+}
+
+void GlBackend::draw_arrays(GLint first, GLsizei count)
+{
+    glDrawArrays(GL_TRIANGLES, first, count);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "render_backend.hpp"
+
+// Straight through to glad, needs a current GL context
+class GlBackend : public RenderBackend
+{
+  public:
+    auto create_buffer(const void *data, size_t bytes) -> GLuint override;
+    void delete_buffer(GLuint buffer) override;
+    auto create_vertex_array(GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout)
+        -> GLuint override;
+    void delete_vertex_array(GLuint vertex_array) override;
+    void bind_vertex_array(GLuint vertex_array) override;
+    auto create_program(
+        std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+    ) -> GLuint override;
+    void use_program(GLuint program) override;
+    auto uniform_location(GLuint program, const char *name) -> GLint override;
+    void set_uniform(GLint location, UniformKind kind, GLsizei count, const void *data) override;
+    void draw_arrays(GLint first, GLsizei count) override;
+};
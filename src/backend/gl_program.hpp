@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <glad/glad.h>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+const GLint shader_info_log_size = 512;
+
+// Compiles one stage from pieces of source handed to GL as they are, so splicing in defines copies nothing. Throws
+// with the info log on failure.
+template <size_t N>
+auto compile_shader(GLenum type, const char *stage, const std::array<std::string_view, N> &parts) -> GLuint
+{
+    std::array<const GLchar *, N> strings{};
+    std::array<GLint, N> lengths{};
+    for (size_t i = 0; i < N; i++)
+    {
+        strings[i] = parts[i].data();
+        lengths[i] = static_cast<GLint>(parts[i].size());
+    }
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, static_cast<GLsizei>(N), strings.data(), lengths.data());
+    glCompileShader(shader);
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success == 0)
+    {
+        std::string info_log(shader_info_log_size, '\0');
+        glGetShaderInfoLog(shader, shader_info_log_size, nullptr, info_log.data());
+        glDeleteShader(shader);
+        throw std::runtime_error(
+            std::string("ERROR::SHADER::").append(stage).append("::COMPILATION_FAILED\n").append(info_log)
+        );
+    }
+    return shader;
+}
+
+// Links compiled stages into a program and deletes them, throwing with the info log on failure
+inline auto link_shaders(std::initializer_list<GLuint> shaders) -> GLuint
+{
+    GLuint program = glCreateProgram();
+    for (GLuint shader : shaders)
+    {
+        glAttachShader(program, shader);
+    }
+    glLinkProgram(program);
+    for (GLuint shader : shaders)
+    {
+        glDeleteShader(shader);
+    }
+
+    int link_success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+    if (link_success == 0)
+    {
+        std::string info_log(shader_info_log_size, '\0');
+        glGetProgramInfoLog(program, shader_info_log_size, nullptr, info_log.data());
+        throw std::runtime_error(std::string("ERROR::SHADER::LINK_FAILED\n").append(info_log));
+    }
+    return program;
+}
+
+// Compiles and links a vertex and fragment shader, throwing with the info log on failure
+inline auto link_program(std::string_view vertex_source, std::string_view fragment_source) -> GLuint
+{
+    const GLuint vertex_shader = compile_shader<1>(GL_VERTEX_SHADER, "VERTEX", {vertex_source});
+    GLuint fragment_shader = 0;
+    try
+    {
+        fragment_shader = compile_shader<1>(GL_FRAGMENT_SHADER, "FRAGMENT", {fragment_source});
+    }
+    catch (...)
+    {
+        glDeleteShader(vertex_shader);
+        throw;
+    }
+    return link_shaders({vertex_shader, fragment_shader});
+}
+
+// Compiles and links a compute shader, needs GL 4.3
+inline auto link_compute_program(std::string_view compute_source) -> GLuint
+{
+    return link_shaders({compile_shader<1>(GL_COMPUTE_SHADER, "COMPUTE", {compute_source})});
+}
+
+// Like link_program, with defines in place of the sources' DEFINES line
+inline auto link_program_with_defines(
+    std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+) -> GLuint
+{
+    const std::string_view placeholder = "#define DEFINES";
+    auto spliced = [&](std::string_view source) {
+        const size_t pos = source.find(placeholder);
+        if (pos == std::string_view::npos)
+        {
+            throw std::runtime_error("Shader source has no DEFINES line");
+        }
+        return std::array{source.substr(0, pos), defines, source.substr(pos + placeholder.size())};
+    };
+    const GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, "VERTEX", spliced(vertex_source));
+    GLuint fragment_shader = 0;
+    try
+    {
+        fragment_shader = compile_shader(GL_FRAGMENT_SHADER, "FRAGMENT", spliced(fragment_source));
+    }
+    catch (...)
+    {
+        glDeleteShader(vertex_shader);
+        throw;
+    }
+    return link_shaders({vertex_shader, fragment_shader});
+}
@@ -0,0 +1,69 @@
+#include "null_backend.hpp"
+
+auto NullBackend::create_buffer(const void * /*data*/, size_t bytes) -> GLuint
+{
+    calls.buffers++;
+    calls.buffer_bytes += bytes;
+    return next_buffer++;
+}
+
+void NullBackend::delete_buffer(GLuint /*buffer*/)
+{
+}
+
+auto NullBackend::create_vertex_array(
+    GLuint /*buffer*/, GLsizei /*stride*/, const std::vector<VertexAttributeLayout> & /*layout*/
+) -> GLuint
+{
+    calls.vertex_arrays++;
+    return next_vertex_array++;
+}
+
+void NullBackend::delete_vertex_array(GLuint /*vertex_array*/)
+{
+}
+
+void NullBackend::bind_vertex_array(GLuint /*vertex_array*/)
+{
+    calls.vertex_array_binds++;
+}
+
+auto NullBackend::create_program(
+    std::string_view /*vertex_source*/, std::string_view /*fragment_source*/, std::string_view /*defines*/
+) -> GLuint
+{
+    calls.programs++;
+    return next_program++;
+}
+
+void NullBackend::use_program(GLuint /*program*/)
+{
+    calls.program_binds++;
+}
+
+auto NullBackend::uniform_location(GLuint /*program*/, const char *name) -> GLint
+{
+    return locations.emplace(name, static_cast<GLint>(locations.size())).first->second;
+}
+
+void NullBackend::set_uniform(GLint /*location*/, UniformKind kind, GLsizei count, const void * /*data*/)
+{
+    calls.uniforms++;
+    calls.uniform_bytes += uniform_kind_size(kind) * static_cast<size_t>(count);
+}
+
+void NullBackend::draw_arrays(GLint /*first*/, GLsizei count)
+{
+    calls.draws++;
+    calls.vertices += static_cast<size_t>(count);
+}
+
+auto NullBackend::counters() const -> BackendCounters
+{
+    return calls;
+}
+
+void NullBackend::reset_counters()
+{
+    calls = {};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "render_backend.hpp"
+#include <string>
+#include <unordered_map>
+
+struct BackendCounters
+{
+    size_t buffers;
+    size_t buffer_bytes;
+    size_t vertex_arrays;
+    size_t programs;
+    size_t vertex_array_binds;
+    size_t program_binds;
+    size_t uniforms;
+    size_t uniform_bytes;
+    size_t draws;
+    size_t vertices;
+};
+
+// Does no GPU work and counts what it's asked to do, so scene code can be run and timed without a context. Names
+// count up from 1 for each kind of object, and each uniform name gets one location shared by every program.
+class NullBackend : public RenderBackend
+{
+  public:
+    auto create_buffer(const void *data, size_t bytes) -> GLuint override;
+    void delete_buffer(GLuint buffer) override;
+    auto create_vertex_array(GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout)
+        -> GLuint override;
+    void delete_vertex_array(GLuint vertex_array) override;
+    void bind_vertex_array(GLuint vertex_array) override;
+    auto create_program(
+        std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+    ) -> GLuint override;
+    void use_program(GLuint program) override;
+    auto uniform_location(GLuint program, const char *name) -> GLint override;
+    void set_uniform(GLint location, UniformKind kind, GLsizei count, const void *data) override;
+    void draw_arrays(GLint first, GLsizei count) override;
+    [[nodiscard]] auto counters() const -> BackendCounters;
+    void reset_counters();
+
+  private:
+    BackendCounters calls{};
+    GLuint next_buffer{1};
+    GLuint next_vertex_array{1};
+    GLuint next_program{1};
+    std::unordered_map<std::string, GLint> locations;
+};
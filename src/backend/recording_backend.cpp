@@ -0,0 +1,86 @@
+#include "recording_backend.hpp"
+#include <algorithm>
+
+auto RecordingBackend::create_buffer(const void *data, size_t bytes) -> GLuint
+{
+    const GLuint buffer = NullBackend::create_buffer(data, bytes);
+    record(BackendOp::create_buffer, buffer, static_cast<GLsizei>(bytes));
+    return buffer;
+}
+
+void RecordingBackend::delete_buffer(GLuint buffer)
+{
+    NullBackend::delete_buffer(buffer);
+    record(BackendOp::delete_buffer, buffer);
+}
+
+auto RecordingBackend::create_vertex_array(
+    GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout
+) -> GLuint
+{
+    const GLuint vertex_array = NullBackend::create_vertex_array(buffer, stride, layout);
+    record(BackendOp::create_vertex_array, vertex_array, static_cast<GLsizei>(layout.size()));
+    return vertex_array;
+}
+
+void RecordingBackend::delete_vertex_array(GLuint vertex_array)
+{
+    NullBackend::delete_vertex_array(vertex_array);
+    record(BackendOp::delete_vertex_array, vertex_array);
+}
+
+void RecordingBackend::bind_vertex_array(GLuint vertex_array)
+{
+    NullBackend::bind_vertex_array(vertex_array);
+    record(BackendOp::bind_vertex_array, vertex_array);
+}
+
+auto RecordingBackend::create_program(
+    std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+) -> GLuint
+{
+    const GLuint program = NullBackend::create_program(vertex_source, fragment_source, defines);
+    record(BackendOp::create_program, program);
+    return program;
+}
+
+void RecordingBackend::use_program(GLuint program)
+{
+    NullBackend::use_program(program);
+    record(BackendOp::use_program, program);
+}
+
+void RecordingBackend::set_uniform(GLint location, UniformKind kind, GLsizei count, const void *data)
+{
+    NullBackend::set_uniform(location, kind, count, data);
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    const size_t size = uniform_kind_size(kind) * static_cast<size_t>(count);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    recorded.push_back({BackendOp::set_uniform, 0, location, kind, 0, count, {bytes, bytes + size}});
+}
+
+void RecordingBackend::draw_arrays(GLint first, GLsizei count)
+{
+    NullBackend::draw_arrays(first, count);
+    recorded.push_back({BackendOp::draw_arrays, 0, -1, {}, first, count, {}});
+}
+
+auto RecordingBackend::calls() const -> const std::vector<BackendCall> &
+{
+    return recorded;
+}
+
+auto RecordingBackend::count(BackendOp op) const -> size_t
+{
+    return std::count_if(recorded.begin(), recorded.end(), [&](const BackendCall &call) { return call.op == op; });
+}
+
+void RecordingBackend::clear()
+{
+    recorded.clear();
+}
+
+void RecordingBackend::record(BackendOp op, GLuint object, GLsizei count)
+{
+    recorded.push_back({op, object, -1, {}, 0, count, {}});
+}
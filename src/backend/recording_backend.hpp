@@ -0,0 +1,55 @@
+#pragma once
+
+#include "null_backend.hpp"
+#include <cstdint>
+
+enum class BackendOp
+{
+    create_buffer,
+    delete_buffer,
+    create_vertex_array,
+    delete_vertex_array,
+    bind_vertex_array,
+    create_program,
+    use_program,
+    set_uniform,
+    draw_arrays,
+};
+
+// One backend call. object is the buffer, vertex array or program it names, for uniforms data holds the values.
+struct BackendCall
+{
+    BackendOp op;
+    GLuint object;
+    GLint location;
+    UniformKind kind;
+    GLint first;
+    GLsizei count;
+    std::vector<uint8_t> data;
+};
+
+// A NullBackend that also keeps every call in order, for checking what scene code asked for
+class RecordingBackend : public NullBackend
+{
+  public:
+    auto create_buffer(const void *data, size_t bytes) -> GLuint override;
+    void delete_buffer(GLuint buffer) override;
+    auto create_vertex_array(GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout)
+        -> GLuint override;
+    void delete_vertex_array(GLuint vertex_array) override;
+    void bind_vertex_array(GLuint vertex_array) override;
+    auto create_program(
+        std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+    ) -> GLuint override;
+    void use_program(GLuint program) override;
+    void set_uniform(GLint location, UniformKind kind, GLsizei count, const void *data) override;
+    void draw_arrays(GLint first, GLsizei count) override;
+    [[nodiscard]] auto calls() const -> const std::vector<BackendCall> &;
+    // Calls of one kind, e.g. every draw
+    [[nodiscard]] auto count(BackendOp op) const -> size_t;
+    void clear();
+
+  private:
+    void record(BackendOp op, GLuint object, GLsizei count = 0);
+    std::vector<BackendCall> recorded;
+};
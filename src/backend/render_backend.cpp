@@ -0,0 +1,22 @@
+#include "render_backend.hpp"
+#include "gl_backend.hpp"
+
+namespace
+{
+RenderBackend *selected_backend = nullptr;
+} // namespace
+
+auto RenderBackend::current() -> RenderBackend &
+{
+    if (selected_backend != nullptr)
+    {
+        return *selected_backend;
+    }
+    static GlBackend gl;
+    return gl;
+}
+
+void RenderBackend::set_current(RenderBackend *backend)
+{
+    selected_backend = backend;
+}
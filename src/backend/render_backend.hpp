@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../capture/capture_file.hpp"
+#include <cstddef>
+#include <glad/glad.h>
+#include <string_view>
+#include <vector>
+
+// The GL calls meshes, shader programs and uniforms make, behind an interface so the scene's CPU side can run and be
+// timed without a context. Objects are named by GLuint as in GL, backends other than GL hand out their own names.
+class RenderBackend
+{
+  public:
+    RenderBackend() = default;
+    RenderBackend(const RenderBackend &) = delete;
+    RenderBackend(RenderBackend &&) = delete;
+    auto operator=(const RenderBackend &) -> RenderBackend & = delete;
+    auto operator=(RenderBackend &&) -> RenderBackend & = delete;
+    virtual ~RenderBackend() = default;
+
+    // Backend new meshes and shader programs are made with, which they keep for their lifetime. GL unless
+    // set_current() picked another, null goes back to GL.
+    static auto current() -> RenderBackend &;
+    static void set_current(RenderBackend *backend);
+
+    // Static vertex buffer holding bytes of data
+    virtual auto create_buffer(const void *data, size_t bytes) -> GLuint = 0;
+    virtual void delete_buffer(GLuint buffer) = 0;
+    // Vertex array reading buffer with the given attributes, leaves nothing bound
+    virtual auto create_vertex_array(GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout)
+        -> GLuint = 0;
+    virtual void delete_vertex_array(GLuint vertex_array) = 0;
+    virtual void bind_vertex_array(GLuint vertex_array) = 0;
+    // Vertex and fragment source with defines in place of their DEFINES line
+    virtual auto create_program(
+        std::string_view vertex_source, std::string_view fragment_source, std::string_view defines
+    ) -> GLuint = 0;
+    virtual void use_program(GLuint program) = 0;
+    // -1 when the program has no such uniform, setting it then does nothing
+    virtual auto uniform_location(GLuint program, const char *name) -> GLint = 0;
+    // count values of kind, for the program in use
+    virtual void set_uniform(GLint location, UniformKind kind, GLsizei count, const void *data) = 0;
+    // Triangles from the bound vertex array
+    virtual void draw_arrays(GLint first, GLsizei count) = 0;
+};
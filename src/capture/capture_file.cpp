@@ -0,0 +1,194 @@
+#include "capture_file.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+template <typename T> void write_value(std::ostream &stream, const T &value)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> void write_array(std::ostream &stream, const std::vector<T> &values)
+{
+    write_value(stream, static_cast<uint64_t>(values.size()));
+    const auto size = static_cast<std::streamsize>(values.size() * sizeof(T));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<const char *>(values.data()), size);
+}
+
+void write_string(std::ostream &stream, const std::string &value)
+{
+    write_value(stream, static_cast<uint32_t>(value.size()));
+    stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+template <typename T> auto read_value(std::istream &stream) -> T
+{
+    T value{};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.read(reinterpret_cast<char *>(&value), sizeof(T));
+    if (!stream)
+    {
+        throw std::runtime_error("Capture file truncated");
+    }
+    return value;
+}
+
+template <typename T> auto read_array(std::istream &stream) -> std::vector<T>
+{
+    // Guards against allocating something absurd from a corrupt length
+    const uint64_t max_array_bytes = uint64_t{1} << 32U;
+    const auto count = read_value<uint64_t>(stream);
+    if (count * sizeof(T) > max_array_bytes)
+    {
+        throw std::runtime_error("Capture file corrupt");
+    }
+    std::vector<T> values(count);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    if (!stream)
+    {
+        throw std::runtime_error("Capture file truncated");
+    }
+    return values;
+}
+
+auto read_string(std::istream &stream) -> std::string
+{
+    std::string value(read_value<uint32_t>(stream), '\0');
+    stream.read(value.data(), static_cast<std::streamsize>(value.size()));
+    if (!stream)
+    {
+        throw std::runtime_error("Capture file truncated");
+    }
+    return value;
+}
+} // namespace
+
+auto uniform_kind_size(UniformKind kind) -> size_t
+{
+    const size_t component = 4;
+    switch (kind)
+    {
+    case UniformKind::float1:
+    case UniformKind::int1:
+    case UniformKind::uint1:
+        return component;
+    case UniformKind::float2:
+    case UniformKind::int2:
+    case UniformKind::uint2:
+        return 2 * component;
+    case UniformKind::float3:
+    case UniformKind::int3:
+    case UniformKind::uint3:
+        return 3 * component;
+    case UniformKind::float4:
+    case UniformKind::int4:
+    case UniformKind::uint4:
+    case UniformKind::mat2:
+        return 4 * component;
+    case UniformKind::mat3:
+        return 3 * 3 * component;
+    case UniformKind::mat4:
+        return 4 * 4 * component;
+    }
+    throw std::runtime_error("Unknown uniform kind");
+}
+
+void write_capture(const std::string &path, const CaptureFile &capture)
+{
+    std::ofstream stream(path, std::ios::binary);
+    write_value(stream, capture_file_magic);
+    write_value(stream, capture_file_version);
+
+    write_value(stream, static_cast<uint32_t>(capture.programs.size()));
+    for (const auto &program : capture.programs)
+    {
+        write_value(stream, program.id);
+        write_string(stream, program.defines);
+        write_value(stream, static_cast<uint32_t>(program.uniforms.size()));
+        for (const auto &[location, name] : program.uniforms)
+        {
+            write_value(stream, location);
+            write_string(stream, name);
+        }
+    }
+
+    write_value(stream, static_cast<uint32_t>(capture.meshes.size()));
+    for (const auto &mesh : capture.meshes)
+    {
+        write_value(stream, mesh.id);
+        write_value(stream, mesh.stride);
+        write_array(stream, mesh.attributes);
+        write_array(stream, mesh.vertices);
+    }
+
+    write_value(stream, static_cast<uint32_t>(capture.frames.size()));
+    for (const auto &frame : capture.frames)
+    {
+        write_value(stream, frame.width);
+        write_value(stream, frame.height);
+        write_value(stream, frame.output_width);
+        write_value(stream, frame.output_height);
+        write_value(stream, frame.polygon_mode);
+        write_array(stream, frame.commands);
+    }
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to write capture " + path);
+    }
+}
+
+auto read_capture(const std::string &path) -> CaptureFile
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        throw std::runtime_error("Can't open capture " + path);
+    }
+    if (read_value<std::array<char, 4>>(stream) != capture_file_magic)
+    {
+        throw std::runtime_error(path + " is not a frame capture");
+    }
+    if (read_value<uint32_t>(stream) != capture_file_version)
+    {
+        throw std::runtime_error(path + " has an unsupported capture version");
+    }
+
+    CaptureFile capture;
+    capture.programs.resize(read_value<uint32_t>(stream));
+    for (auto &program : capture.programs)
+    {
+        program.id = read_value<uint32_t>(stream);
+        program.defines = read_string(stream);
+        program.uniforms.resize(read_value<uint32_t>(stream));
+        for (auto &[location, name] : program.uniforms)
+        {
+            location = read_value<int32_t>(stream);
+            name = read_string(stream);
+        }
+    }
+
+    capture.meshes.resize(read_value<uint32_t>(stream));
+    for (auto &mesh : capture.meshes)
+    {
+        mesh.id = read_value<uint32_t>(stream);
+        mesh.stride = read_value<uint32_t>(stream);
+        mesh.attributes = read_array<VertexAttributeLayout>(stream);
+        mesh.vertices = read_array<uint8_t>(stream);
+    }
+
+    capture.frames.resize(read_value<uint32_t>(stream));
+    for (auto &frame : capture.frames)
+    {
+        frame.width = read_value<int32_t>(stream);
+        frame.height = read_value<int32_t>(stream);
+        frame.output_width = read_value<int32_t>(stream);
+        frame.output_height = read_value<int32_t>(stream);
+        frame.polygon_mode = read_value<uint32_t>(stream);
+        frame.commands = read_array<uint8_t>(stream);
+    }
+    return capture;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout of one vertex attribute as passed to glVertexAttrib(I)Pointer, written to files as is
+struct VertexAttributeLayout
+{
+    uint32_t location;
+    int32_t size;
+    uint32_t type;
+    uint32_t offset;
+    uint8_t normalized;
+    uint8_t integer;
+    // Keeps the padding defined so captures are byte for byte repeatable
+    uint16_t reserved{};
+};
+
+enum class UniformKind : uint8_t
+{
+    float1,
+    float2,
+    float3,
+    float4,
+    int1,
+    int2,
+    int3,
+    int4,
+    uint1,
+    uint2,
+    uint3,
+    uint4,
+    mat2,
+    mat3,
+    mat4,
+};
+
+auto uniform_kind_size(UniformKind kind) -> size_t;
+
+// Each command is an opcode byte followed by its fixed payload, uniforms append their data after the payload
+enum class CaptureOp : uint8_t
+{
+    // u32 program
+    use_program,
+    // u32 vertex array
+    bind_mesh,
+    // i32 location, u8 kind, u32 count, data
+    uniform,
+    // i32 first, i32 count
+    draw_arrays,
+    // u8 UpscaleFilter, f32 sharpness. Everything drawn so far is scaled up to the frame's output size, then depth is
+    // cleared and later commands draw at the output size, as the game does for its overlay.
+    upscale,
+};
+
+struct CapturedProgram
+{
+    uint32_t id;
+    std::string defines;
+    // Uniform names by their location at capture time, locations can differ on replay
+    std::vector<std::pair<int32_t, std::string>> uniforms;
+};
+
+struct CapturedMesh
+{
+    uint32_t id;
+    uint32_t stride;
+    std::vector<VertexAttributeLayout> attributes;
+    std::vector<uint8_t> vertices;
+};
+
+struct CapturedFrame
+{
+    // Size the scene renders at
+    int32_t width;
+    int32_t height;
+    // Size after the upscale, the same as width x height in frames without one
+    int32_t output_width;
+    int32_t output_height;
+    uint32_t polygon_mode;
+    std::vector<uint8_t> commands;
+};
+
+struct CaptureFile
+{
+    std::vector<CapturedProgram> programs;
+    std::vector<CapturedMesh> meshes;
+    std::vector<CapturedFrame> frames;
+};
+
+const std::array<char, 4> capture_file_magic = {'G', 'C', 'A', 'P'};
+const uint32_t capture_file_version = 2;
+
+void write_capture(const std::string &path, const CaptureFile &capture);
+auto read_capture(const std::string &path) -> CaptureFile;
@@ -0,0 +1,179 @@
+#include "frame_capture.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+FrameCapture *active_capture = nullptr;
+} // namespace
+
+auto FrameCapture::current() -> FrameCapture *
+{
+    return active_capture;
+}
+
+void FrameCapture::start(std::string path, size_t frame_count)
+{
+    this->path = std::move(path);
+    frames_remaining = frame_count;
+    capture = {};
+    known_programs.clear();
+    known_meshes.clear();
+    unsupported.clear();
+}
+
+auto FrameCapture::capturing() const -> bool
+{
+    return frames_remaining > 0;
+}
+
+void FrameCapture::begin_frame(int width, int height, GLenum polygon_mode)
+{
+    if (!capturing())
+    {
+        return;
+    }
+    capture.frames.push_back({width, height, width, height, polygon_mode, {}});
+    uniform_values.clear();
+    bound_program = 0;
+    bound_mesh = 0;
+    active_capture = this;
+}
+
+void FrameCapture::end_frame()
+{
+    if (active_capture != this)
+    {
+        return;
+    }
+    active_capture = nullptr;
+    if (!unsupported.empty())
+    {
+        const std::string what = std::move(unsupported);
+        unsupported.clear();
+        frames_remaining = 0;
+        capture = {};
+        throw std::runtime_error("Capture dropped, it can't record " + what);
+    }
+    frames_remaining--;
+    if (frames_remaining == 0)
+    {
+        write_capture(path, capture);
+        capture = {};
+    }
+}
+
+void FrameCapture::record_program(GLuint program, const std::string &defines)
+{
+    if (known_programs.insert(program).second)
+    {
+        CapturedProgram captured{program, defines, {}};
+        GLint uniform_count = 0;
+        GLint max_name_length = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+        std::string name(static_cast<size_t>(max_name_length), '\0');
+        for (GLint uniform = 0; uniform < uniform_count; uniform++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, uniform, max_name_length, &length, &size, &type, name.data());
+            const std::string uniform_name = name.substr(0, static_cast<size_t>(length));
+            captured.uniforms.emplace_back(glGetUniformLocation(program, uniform_name.c_str()), uniform_name);
+        }
+        capture.programs.push_back(std::move(captured));
+    }
+    if (program != bound_program)
+    {
+        bound_program = program;
+        append(CaptureOp::use_program);
+        append(static_cast<uint32_t>(program));
+    }
+}
+
+void FrameCapture::record_mesh(
+    GLuint vertex_array, GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout
+)
+{
+    if (known_meshes.insert(vertex_array).second)
+    {
+        CapturedMesh captured{vertex_array, static_cast<uint32_t>(stride), layout, {}};
+        // The copy binding point leaves the array buffer binding untouched
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        GLint64 size = 0;
+        glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        captured.vertices.resize(static_cast<size_t>(size));
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, captured.vertices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        capture.meshes.push_back(std::move(captured));
+    }
+    if (vertex_array != bound_mesh)
+    {
+        bound_mesh = vertex_array;
+        append(CaptureOp::bind_mesh);
+        append(static_cast<uint32_t>(vertex_array));
+    }
+}
+
+void FrameCapture::record_draw(GLint first, GLsizei count)
+{
+    append(CaptureOp::draw_arrays);
+    append(static_cast<int32_t>(first));
+    append(static_cast<int32_t>(count));
+}
+
+void FrameCapture::record_upscale(int width, int height, uint8_t filter, float sharpness)
+{
+    capture.frames.back().output_width = width;
+    capture.frames.back().output_height = height;
+    append(CaptureOp::upscale);
+    append(filter);
+    append(sharpness);
+    // The pass binds its own program and vertex array, so the next draw has to bind again
+    bound_program = 0;
+    bound_mesh = 0;
+}
+
+void FrameCapture::record_unsupported(const char *what)
+{
+    if (unsupported.empty())
+    {
+        unsupported = what;
+    }
+}
+
+template <typename T> void FrameCapture::append(const T &value)
+{
+    auto &commands = capture.frames.back().commands;
+    const size_t offset = commands.size();
+    commands.resize(offset + sizeof(T));
+    std::memcpy(&commands[offset], &value, sizeof(T));
+}
+
+void FrameCapture::write_uniform(GLint location, UniformKind kind, size_t count, const void *data)
+{
+    // Writes to a missing uniform are ignored by GL, so there is nothing to replay
+    if (location < 0 || count == 0)
+    {
+        return;
+    }
+    const size_t size = uniform_kind_size(kind) * count;
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    const uint64_t key = (uint64_t{bound_program} << 32U) | static_cast<uint32_t>(location);
+    auto &previous = uniform_values[key];
+    if (previous.size() == size && std::memcmp(previous.data(), bytes, size) == 0)
+    {
+        return;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    previous.assign(bytes, bytes + size);
+
+    append(CaptureOp::uniform);
+    append(static_cast<int32_t>(location));
+    append(kind);
+    append(static_cast<uint32_t>(count));
+    auto &commands = capture.frames.back().commands;
+    commands.insert(commands.end(), previous.begin(), previous.end());
+}
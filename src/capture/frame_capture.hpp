@@ -0,0 +1,94 @@
+#pragma once
+
+#include "capture_file.hpp"
+#include <array>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+template <typename T> struct UniformTraits;
+// clang-format off
+template <> struct UniformTraits<float> { static constexpr UniformKind kind = UniformKind::float1; };
+template <> struct UniformTraits<glm::vec2> { static constexpr UniformKind kind = UniformKind::float2; };
+template <> struct UniformTraits<glm::vec3> { static constexpr UniformKind kind = UniformKind::float3; };
+template <> struct UniformTraits<glm::vec4> { static constexpr UniformKind kind = UniformKind::float4; };
+template <> struct UniformTraits<int> { static constexpr UniformKind kind = UniformKind::int1; };
+template <> struct UniformTraits<glm::ivec2> { static constexpr UniformKind kind = UniformKind::int2; };
+template <> struct UniformTraits<glm::ivec3> { static constexpr UniformKind kind = UniformKind::int3; };
+template <> struct UniformTraits<glm::ivec4> { static constexpr UniformKind kind = UniformKind::int4; };
+template <> struct UniformTraits<unsigned int> { static constexpr UniformKind kind = UniformKind::uint1; };
+template <> struct UniformTraits<glm::uvec2> { static constexpr UniformKind kind = UniformKind::uint2; };
+template <> struct UniformTraits<glm::uvec3> { static constexpr UniformKind kind = UniformKind::uint3; };
+template <> struct UniformTraits<glm::uvec4> { static constexpr UniformKind kind = UniformKind::uint4; };
+template <> struct UniformTraits<glm::mat2> { static constexpr UniformKind kind = UniformKind::mat2; };
+template <> struct UniformTraits<glm::mat3> { static constexpr UniformKind kind = UniformKind::mat3; };
+template <> struct UniformTraits<glm::mat4> { static constexpr UniformKind kind = UniformKind::mat4; };
+// clang-format on
+
+// Records the GL work of whole frames into a CaptureFile. The draw path reports to current(), which is only non-null
+// between begin_frame() and end_frame() of a frame being captured, so capturing costs one branch per call otherwise.
+// Vertex data is read back from the GPU the first time a mesh is drawn, and uniform writes that don't change the
+// value already set that frame are dropped. Draws with no command to record them report themselves instead, and the
+// capture is dropped rather than written without them.
+class FrameCapture
+{
+  public:
+    static auto current() -> FrameCapture *;
+    // Captures the next frame_count frames then writes them to path
+    void start(std::string path, size_t frame_count);
+    [[nodiscard]] auto capturing() const -> bool;
+    void begin_frame(int width, int height, GLenum polygon_mode);
+    // Writes the capture once its last frame ends, throwing if the file can't be written or the frame drew something
+    // unrecordable, which also ends the capture
+    void end_frame();
+
+    void record_program(GLuint program, const std::string &defines);
+    void record_mesh(
+        GLuint vertex_array, GLuint buffer, GLsizei stride, const std::vector<VertexAttributeLayout> &layout
+    );
+    void record_draw(GLint first, GLsizei count);
+    // filter is an UpscaleFilter, kept as a number since the renderer sits above capture
+    void record_upscale(int width, int height, uint8_t filter, float sharpness);
+    // what is named in the error end_frame() throws, e.g. "impostors"
+    void record_unsupported(const char *what);
+    template <typename T> void record_uniform(GLint location, const T &value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            record_uniform(location, static_cast<int>(value));
+        }
+        else if constexpr (std::is_same_v<T, std::vector<glm::mat4>> || std::is_same_v<T, std::vector<float>>)
+        {
+            using Element = typename T::value_type;
+            write_uniform(location, UniformTraits<Element>::kind, value.size(), value.data());
+        }
+        else
+        {
+            write_uniform(location, UniformTraits<T>::kind, 1, &value);
+        }
+    }
+    template <size_t N> void record_uniform(GLint location, const std::array<glm::mat4, N> &values)
+    {
+        write_uniform(location, UniformKind::mat4, N, values.data());
+    }
+
+  private:
+    template <typename T> void append(const T &value);
+    void write_uniform(GLint location, UniformKind kind, size_t count, const void *data);
+    std::string path;
+    size_t frames_remaining{};
+    CaptureFile capture;
+    std::unordered_set<GLuint> known_programs;
+    std::unordered_set<GLuint> known_meshes;
+    GLuint bound_program{};
+    GLuint bound_mesh{};
+    // First unrecordable draw of the frame, empty when everything was recorded
+    std::string unsupported;
+    // Last value written to each (program, location) this frame
+    std::unordered_map<uint64_t, std::vector<uint8_t>> uniform_values;
+};
@@ -0,0 +1,85 @@
+#include "allocation_count.hpp"
+
+#ifdef GAME_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+thread_local uint64_t thread_allocations = 0;
+} // namespace
+
+// The standard library's array and nothrow forms forward to these
+// NOLINTBEGIN(cppcoreguidelines-no-malloc)
+auto operator new(size_t size) -> void *
+{
+    thread_allocations++;
+    if (void *memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t /*size*/) noexcept
+{
+    std::free(memory);
+}
+
+auto operator new(size_t size, std::align_val_t alignment) -> void *
+{
+    thread_allocations++;
+    const auto align = static_cast<size_t>(alignment);
+#ifdef _MSC_VER
+    void *memory = _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    // aligned_alloc wants a whole number of alignments
+    void *memory = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory, std::align_val_t /*alignment*/) noexcept
+{
+#ifdef _MSC_VER
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void operator delete(void *memory, size_t /*size*/, std::align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+// NOLINTEND(cppcoreguidelines-no-malloc)
+
+auto allocation_counting() -> bool
+{
+    return true;
+}
+
+auto thread_allocation_count() -> uint64_t
+{
+    return thread_allocations;
+}
+#else
+auto allocation_counting() -> bool
+{
+    return false;
+}
+
+auto thread_allocation_count() -> uint64_t
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// Whether global operator new is replaced to count allocations, set by the GAME_COUNT_ALLOCATIONS build option
+auto allocation_counting() -> bool;
+// Heap allocations made by the calling thread through operator new so far, always zero without counting
+auto thread_allocation_count() -> uint64_t;
+
+// Counts the calling thread's heap allocations since construction or the last restart(), e.g. across one frame to
+// check the steady state stays off the heap
+class AllocationCounter
+{
+  public:
+    AllocationCounter() : start(thread_allocation_count())
+    {
+    }
+    void restart()
+    {
+        start = thread_allocation_count();
+    }
+    [[nodiscard]] auto count() const -> uint64_t
+    {
+        return thread_allocation_count() - start;
+    }
+
+  private:
+    uint64_t start;
+};
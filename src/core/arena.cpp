@@ -0,0 +1,119 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+const size_t block_alignment = alignof(std::max_align_t);
+const size_t frame_arena_capacity = size_t{1} << 20U;
+
+auto next_power_of_two(size_t value) -> size_t
+{
+    size_t power = 1;
+    while (power < value)
+    {
+        power *= 2;
+    }
+    return power;
+}
+} // namespace
+
+LinearArena::LinearArena(size_t capacity, std::pmr::memory_resource *upstream) : upstream(upstream), capacity(capacity)
+{
+    if (capacity > 0)
+    {
+        block = static_cast<std::byte *>(upstream->allocate(capacity, block_alignment));
+    }
+}
+
+LinearArena::~LinearArena()
+{
+    release_overflow();
+    if (block != nullptr)
+    {
+        upstream->deallocate(block, capacity, block_alignment);
+    }
+}
+
+void LinearArena::reset()
+{
+    release_overflow();
+    if (high_water > capacity)
+    {
+        if (block != nullptr)
+        {
+            upstream->deallocate(block, capacity, block_alignment);
+        }
+        capacity = next_power_of_two(high_water);
+        block = static_cast<std::byte *>(upstream->allocate(capacity, block_alignment));
+    }
+    used = 0;
+    high_water = 0;
+    reset_count++;
+}
+
+auto LinearArena::mark() const -> size_t
+{
+    return used;
+}
+
+void LinearArena::rewind(size_t mark)
+{
+    if (mark > used)
+    {
+        throw std::invalid_argument("LinearArena::rewind past the current position");
+    }
+    used = mark;
+}
+
+auto LinearArena::stats() const -> ArenaStats
+{
+    return {capacity, used, high_water, overflow_count, reset_count};
+}
+
+auto LinearArena::do_allocate(size_t bytes, size_t alignment) -> void *
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto base = reinterpret_cast<uintptr_t>(block);
+    const size_t start = ((base + used + alignment - 1) & ~(alignment - 1)) - base;
+    if (block != nullptr && start + bytes <= capacity)
+    {
+        used = start + bytes;
+        high_water = std::max(high_water, used + overflow_bytes);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        return block + start;
+    }
+    void *memory = upstream->allocate(bytes, alignment);
+    overflow.push_back({memory, bytes, alignment});
+    // Padding is counted too, so the grown block fits the same sequence of allocations
+    overflow_bytes += bytes + alignment;
+    high_water = std::max(high_water, used + overflow_bytes);
+    overflow_count++;
+    return memory;
+}
+
+void LinearArena::do_deallocate(void * /*memory*/, size_t /*bytes*/, size_t /*alignment*/)
+{
+}
+
+auto LinearArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept -> bool
+{
+    return this == &other;
+}
+
+void LinearArena::release_overflow()
+{
+    for (const Overflow &allocation : overflow)
+    {
+        upstream->deallocate(allocation.memory, allocation.bytes, allocation.alignment);
+    }
+    overflow.clear();
+    overflow_bytes = 0;
+}
+
+auto frame_arena() -> LinearArena &
+{
+    static LinearArena arena(frame_arena_capacity);
+    return arena;
+}
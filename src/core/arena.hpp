@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+struct ArenaStats
+{
+    size_t capacity;
+    size_t used;
+    // Most bytes in use at once since the last reset, counting overflow
+    size_t high_water;
+    // Allocations that didn't fit the block since construction, zero once a workload has settled
+    size_t overflows;
+    size_t resets;
+};
+
+// Bump allocator over one block, freed all at once by reset(). Deallocating does nothing. Allocations that don't fit
+// go to the upstream resource until the next reset, which grows the block to the high water mark, so a workload that
+// repeats each frame stops touching the heap after its first few frames.
+class LinearArena : public std::pmr::memory_resource
+{
+  public:
+    explicit LinearArena(size_t capacity, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+    LinearArena(const LinearArena &) = delete;
+    LinearArena(LinearArena &&) = delete;
+    auto operator=(const LinearArena &) -> LinearArena & = delete;
+    auto operator=(LinearArena &&) -> LinearArena & = delete;
+    ~LinearArena() override;
+    void reset();
+    // Position to rewind() to, freeing everything allocated from the block since. Overflow stays until reset().
+    [[nodiscard]] auto mark() const -> size_t;
+    void rewind(size_t mark);
+    [[nodiscard]] auto stats() const -> ArenaStats;
+
+  private:
+    auto do_allocate(size_t bytes, size_t alignment) -> void * override;
+    void do_deallocate(void *memory, size_t bytes, size_t alignment) override;
+    [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource &other) const noexcept -> bool override;
+    void release_overflow();
+    struct Overflow
+    {
+        void *memory;
+        size_t bytes;
+        size_t alignment;
+    };
+    std::pmr::memory_resource *upstream;
+    std::byte *block{};
+    size_t capacity;
+    size_t used{};
+    std::vector<Overflow> overflow;
+    size_t overflow_bytes{};
+    size_t high_water{};
+    size_t overflow_count{};
+    size_t reset_count{};
+};
+
+// Rewinds the arena when it goes out of scope, for scratch memory such as an importer's per mesh buffers
+class ArenaScope
+{
+  public:
+    explicit ArenaScope(LinearArena &arena) : arena(arena), start(arena.mark())
+    {
+    }
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope(ArenaScope &&) = delete;
+    auto operator=(const ArenaScope &) -> ArenaScope & = delete;
+    auto operator=(ArenaScope &&) -> ArenaScope & = delete;
+    ~ArenaScope()
+    {
+        arena.rewind(start);
+    }
+
+  private:
+    LinearArena &arena;
+    size_t start;
+};
+
+// Memory that lives until the end of the current frame, for lists built and thrown away each update. The main loop
+// resets it after presenting. Main thread only.
+auto frame_arena() -> LinearArena &;
@@ -0,0 +1,134 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t num_threads)
+{
+    num_threads = std::max<size_t>(num_threads, 1);
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+auto ThreadPool::size() const -> size_t
+{
+    return workers.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+void ThreadPool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t num_chunks = (count + grain - 1) / grain;
+    if (num_chunks == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    // Helpers may only get scheduled after every chunk is finished and this call has returned, so everything they
+    // touch lives in shared state rather than on this stack frame
+    struct State
+    {
+        std::function<void(size_t, size_t)> body;
+        size_t count;
+        size_t grain;
+        size_t num_chunks;
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> chunks_done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->body = body;
+    state->count = count;
+    state->grain = grain;
+    state->num_chunks = num_chunks;
+
+    auto run_chunks = [](State &shared) {
+        size_t chunk = 0;
+        while ((chunk = shared.next_chunk.fetch_add(1)) < shared.num_chunks)
+        {
+            const size_t begin = chunk * shared.grain;
+            try
+            {
+                shared.body(begin, std::min(begin + shared.grain, shared.count));
+            }
+            catch (...)
+            {
+                std::lock_guard lock(shared.mutex);
+                if (!shared.error)
+                {
+                    shared.error = std::current_exception();
+                }
+            }
+            if (shared.chunks_done.fetch_add(1) + 1 == shared.num_chunks)
+            {
+                std::lock_guard lock(shared.mutex);
+                shared.finished.notify_all();
+            }
+        }
+    };
+
+    const size_t num_helpers = std::min(workers.size(), num_chunks - 1);
+    for (size_t i = 0; i < num_helpers; i++)
+    {
+        enqueue([state, run_chunks]() { run_chunks(*state); });
+    }
+    run_chunks(*state);
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->chunks_done.load() == state->num_chunks; });
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
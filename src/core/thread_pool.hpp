@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+  public:
+    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+    auto operator=(ThreadPool &&) -> ThreadPool & = delete;
+    ~ThreadPool();
+
+    // Runs task on a worker thread, the future holds its result or exception
+    template <typename F> auto submit(F &&task) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        // std::function needs a copyable target, packaged_task isn't
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+    // Calls body(begin, end) over [0, count) in chunks of at most grain, blocking until every chunk is done. The
+    // calling thread works through chunks too, so this is safe to call from inside a task.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body);
+    [[nodiscard]] auto size() const -> size_t;
+
+  private:
+    void enqueue(std::function<void()> task);
+    void worker_loop();
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping{};
+};
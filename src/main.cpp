@@ -5,6 +5,9 @@
 #include <SDL3/SDL_video.h>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
 #include <glad/glad.h>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
@@ -16,18 +19,32 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include "capture/frame_capture.hpp"
+#include "core/allocation_count.hpp"
+#include "core/arena.hpp"
+#include "render/gpu_timer.hpp"
+#include "render/render_target.hpp"
+#include "render/resolution_controller.hpp"
+#include "render/upscaler.hpp"
+#include "scene/impostor.hpp"
 #include "scene/mesh.hpp"
 #include "scene/scene.hpp"
+#include "scene/transform_batch.hpp"
 #include "shader/shader.hpp"
+#include "texture/texture.hpp"
+#include "world/world_streamer.hpp"
 
 #define WINDOW_WIDTH 1920
 #define WINDOW_HEIGHT 1080
+// Frames written by each press of F12, replay them with tools/replay
+#define CAPTURE_FRAMES 10
 
 // NOLINTBEGIN
 
@@ -117,8 +134,8 @@ auto cube(float side_length) -> std::vector<VertexAttributes<has_colour, has_nor
 
 template <bool NDC, bool has_colour, bool has_lighting, size_t num_tex_coords>
 auto load_scene(
-    const std::string &path
-) -> std::vector<Mesh<has_colour, has_lighting, num_tex_coords>>
+    const std::string &path, bool build_bvh = false
+) -> std::vector<std::shared_ptr<Mesh<has_colour, has_lighting, num_tex_coords>>>
 {
     Assimp::Importer importer;
 
@@ -132,18 +149,101 @@ auto load_scene(
         throw std::runtime_error("Assimp: " + std::string(importer.GetErrorString()));
     }
 
-    std::vector<Mesh<has_colour, has_lighting, num_tex_coords>> meshes;
+    using SceneMesh = Mesh<has_colour, has_lighting, num_tex_coords>;
+    std::vector<std::shared_ptr<SceneMesh>> meshes;
+    meshes.reserve(scene->mNumMeshes);
 
+    // Each mesh's vertices are built in scratch memory sized for the largest, which is rewound between meshes
+    size_t largest = 0;
     for (unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++)
     {
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        meshes.push_back(Mesh<has_colour, has_lighting, num_tex_coords>(*scene->mMeshes[mesh_idx]));
+        largest = std::max<size_t>(largest, scene->mMeshes[mesh_idx]->mNumFaces);
+    }
+    using Vertex = VertexAttributes<has_colour, has_lighting, num_tex_coords>;
+    LinearArena scratch(largest * 3 * (sizeof(Vertex) + sizeof(glm::vec3)));
+    for (unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++)
+    {
+        ArenaScope scope(scratch);
+        meshes.push_back(std::make_shared<SceneMesh>(*scene->mMeshes[mesh_idx], build_bvh, &scratch));
+    }
+    return meshes;
+}
+
+using TexturedMesh = Mesh<false, false, 2>;
+
+// The meshes of a model whose materials have a diffuse texture, each with that texture. tools/texbake must have baked
+// the images to .btex files next to them.
+auto load_textured_scene(const std::string &path, TextureManager &textures)
+    -> std::vector<std::pair<std::shared_ptr<TexturedMesh>, std::shared_ptr<Texture>>>
+{
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        throw std::runtime_error("Assimp: " + std::string(importer.GetErrorString()));
+    }
+
+    const std::string directory = std::filesystem::path(path).parent_path().string();
+    std::vector<std::pair<std::shared_ptr<TexturedMesh>, std::shared_ptr<Texture>>> meshes;
+    for (unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++)
+    {
+        aiMesh &mesh = *scene->mMeshes[mesh_idx];
+        auto texture = textures.load_material(*scene->mMaterials[mesh.mMaterialIndex], directory);
+        if (texture)
+        {
+            meshes.emplace_back(std::make_shared<TexturedMesh>(mesh), std::move(texture));
+        }
     }
     return meshes;
 }
 
-auto main() -> int
+// Scripted camera route over a streamed world: a figure of eight spanning most of it, repeating every period seconds
+auto flight_path(const WorldIndex &world, float time) -> glm::vec3
+{
+    const float period = 240.0f;
+    const float altitude = 40.0f;
+    Bounds extent{world.chunks[0].bounds.min, world.chunks[0].bounds.max};
+    for (const auto &entry : world.chunks)
+    {
+        extent.min = glm::min(extent.min, entry.bounds.min);
+        extent.max = glm::max(extent.max, entry.bounds.max);
+    }
+    const glm::vec3 centre = (extent.min + extent.max) / 2.0f;
+    const glm::vec3 reach = (extent.max - extent.min) * 0.4f;
+    const float angle = time / period * 2.0f * glm::pi<float>();
+    return {centre.x + reach.x * std::sin(angle), extent.max.y + altitude, centre.z + reach.z * std::sin(2.0f * angle)};
+}
+
+// Pass --world file.gworld (made by tools/worldgen) to fly through a streamed world, and --cpu-draw to draw it node by
+// node even where the GPU driven path is supported. --crowd n stands n more teapots in rows behind the first, the far
+// ones drawn as impostors. --textured model.obj draws the model's textured meshes beside the teapot, streaming their
+// baked textures.
+auto main(int argc, char **argv) -> int
 {
+    std::optional<std::string> world_path;
+    std::optional<std::string> textured_path;
+    bool cpu_draw = false;
+    size_t crowd = 0;
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (std::string(argv[arg]) == "--world" && arg + 1 < argc)
+        {
+            world_path = argv[arg + 1];
+        }
+        if (std::string(argv[arg]) == "--crowd" && arg + 1 < argc)
+        {
+            crowd = std::stoul(argv[arg + 1]);
+        }
+        if (std::string(argv[arg]) == "--textured" && arg + 1 < argc)
+        {
+            textured_path = argv[arg + 1];
+        }
+        if (std::string(argv[arg]) == "--cpu-draw")
+        {
+            cpu_draw = true;
+        }
+    }
+
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
         std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
@@ -192,6 +292,10 @@ auto main() -> int
 
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
+    auto workers = std::make_shared<ThreadPool>();
+    auto textures = TextureManager(workers);
+    textures.set_viewport_height(WINDOW_HEIGHT);
+
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
@@ -207,14 +311,47 @@ auto main() -> int
     auto scene = Scene(camera, light);
 
     auto vertices = cube<true, false, 0>(50.0f);
-    auto worldspace_mesh = std::make_shared<Mesh<true, false, 0>>(
-    load_scene<false, true, false, 0>("teapot2.obj")[0]
-    );
+    // Clicking picks against the teapot's triangles
+    auto worldspace_mesh = load_scene<false, true, false, 0>("teapot2.obj", true)[0];
     // auto worldspace_mesh = std::make_shared<Mesh<true, false, 0>>(vertices);
     auto worldspace_node =
         std::make_shared<Node<false, true, false, 0>>(worldspace_mesh, worldspace_shader, glm::mat4(1));
     scene.add_node(worldspace_node);
 
+    std::shared_ptr<Impostor> crowd_impostor;
+    if (crowd > 0)
+    {
+        crowd_impostor = std::make_shared<Impostor>(*worldspace_mesh);
+        scene.add_impostor(crowd_impostor);
+        const Bounds bounds = worldspace_mesh->bounds();
+        const float spacing = 1.5f * glm::length(bounds.max - bounds.min);
+        const auto row = static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(crowd))));
+        for (size_t copy = 0; copy < crowd; copy++)
+        {
+            const glm::vec3 offset(
+                (static_cast<float>(copy % row) - static_cast<float>(row - 1) / 2.0f) * spacing, 0.0f,
+                -static_cast<float>(copy / row + 1) * spacing
+            );
+            auto node = std::make_shared<Node<false, true, false, 0>>(
+                worldspace_mesh, worldspace_shader, glm::translate(glm::mat4(1), offset)
+            );
+            node->set_impostor(crowd_impostor);
+            scene.add_node(node);
+        }
+    }
+
+    if (textured_path)
+    {
+        auto textured_shader = std::make_shared<ShaderProgram<false, false, false, 2>>();
+        const glm::mat4 beside = glm::translate(glm::mat4(1), glm::vec3(-60.0f, 0.0f, 0.0f));
+        for (auto &[mesh, texture] : load_textured_scene(*textured_path, textures))
+        {
+            auto node = std::make_shared<Node<false, false, false, 2>>(mesh, textured_shader, beside);
+            node->set_texture(texture);
+            scene.add_node(node);
+        }
+    }
+
     auto triangle_vertices = std::vector<VertexAttributes<true, false, 0>>({
         {{0.5f, 0.5f, 0.0f}, {0.0f, 1.0f, 0.0f, 1.0f}, {}, {}},
         {{1.0f, 0.5f, 0.0f}, {0.0f, 1.0f, 0.0f, 1.0f}, {}, {}},
@@ -224,6 +361,20 @@ auto main() -> int
     auto ndc_node = std::make_shared<Node<true, true, false, 0>>(ndc_mesh, ndcspace_shader, glm::mat4(1));
     scene.add_node(ndc_node);
 
+    std::unique_ptr<WorldStreamer> world;
+    if (world_path)
+    {
+        if (!cpu_draw && GpuScene::supported())
+        {
+            scene.set_gpu_scene(std::make_shared<GpuScene>());
+        }
+        world = std::make_unique<WorldStreamer>(*world_path, workers, lighting_shader, scene);
+    }
+
+    // Animated nodes are the first ones added to the scene, in the same order
+    auto animation = TransformBatch(1);
+    std::vector<glm::mat4> animated_transforms;
+
     bool quit = false;
     SDL_Event event;
 
@@ -237,8 +388,28 @@ auto main() -> int
 
     size_t frames = 0;
 
+    FrameCapture capture;
+
+    // The world renders off screen at a scale chasing the GPU frame budget, the overlay at native resolution
+    RenderTarget scene_target;
+    scene_target.reserve(window_width, window_height);
+    ResolutionController resolution;
+    GpuTimer frame_timer;
+    Upscaler upscaler;
+    UpscaleFilter upscale_filter = UpscaleFilter::sharpen;
+    auto last_title_update = std::chrono::steady_clock::now();
+    // Result of the last left click, shown in the title
+    std::optional<RayHit> last_pick;
+
+    // With GAME_COUNT_ALLOCATIONS the title shows heap allocations made on this thread by the last frame, which should
+    // be zero once streaming and texture loads have settled
+    AllocationCounter frame_allocations;
+    uint64_t last_frame_allocations = 0;
+    size_t allocating_frames = 0;
+
     while (!quit)
     {
+        frame_allocations.restart();
         while (SDL_PollEvent(&event))
         {
             if (event.type == SDL_EVENT_QUIT)
@@ -247,6 +418,19 @@ auto main() -> int
                 std::cout << ((frames * 1000000000) /
                               (std::chrono::system_clock::now().time_since_epoch() - start_time).count())
                           << std::endl;
+                if (allocation_counting())
+                {
+                    std::cout << "allocations: " << allocating_frames << "/" << frames << " frames allocated"
+                              << std::endl;
+                }
+                if (world)
+                {
+                    const StreamingStats stats = world->stats();
+                    std::cout << "streaming: " << stats.stalled_frames << "/" << stats.frames << " frames stalled, "
+                              << stats.loads << " loads, " << stats.unloads << " unloads, " << stats.failed_loads
+                              << " failed, peak " << stats.peak_bytes / (1024 * 1024) << " MiB, worst update "
+                              << stats.max_update_ms << " ms" << std::endl;
+                }
                 quit = true;
             }
             if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_SPACE)
@@ -257,11 +441,29 @@ auto main() -> int
                     mode = 0;
                 }
             }
+            if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_F1)
+            {
+                upscale_filter =
+                    upscale_filter == UpscaleFilter::sharpen ? UpscaleFilter::bilinear : UpscaleFilter::sharpen;
+            }
+            if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_F12 && !capture.capturing())
+            {
+                capture.start("frame.gcap", CAPTURE_FRAMES);
+            }
+            if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_LEFT)
+            {
+                const glm::vec2 ndc{
+                    event.button.x / static_cast<float>(window_width) * 2.0F - 1.0F,
+                    1.0F - event.button.y / static_cast<float>(window_height) * 2.0F
+                };
+                const auto picked = scene.closest_hit(camera->ray(ndc));
+                last_pick = picked ? std::optional(picked->hit) : std::nullopt;
+            }
             if (event.type == SDL_EVENT_WINDOW_RESIZED)
             {
                 window_width = event.window.data1;
                 window_height = event.window.data2;
-                glViewport(0, 0, window_width, window_height);
+                scene_target.reserve(window_width, window_height);
             }
         }
 
@@ -272,16 +474,99 @@ auto main() -> int
 
         GLfloat curr_time =
             std::chrono::duration<float>(std::chrono::system_clock::now().time_since_epoch() - start_time).count();
-        worldspace_node->set_transform(glm::rotate(glm::mat4(1), glm::radians(30.0f * curr_time), glm::vec3(0.0f, 1.0f, 0.0f)));
+        animation.set_rotation(0, glm::angleAxis(glm::radians(30.0f * curr_time), glm::vec3(0.0f, 1.0f, 0.0f)));
+        animation.compose(animated_transforms);
+        scene.set_transforms(0, animated_transforms);
 
+        if (world && !world->index().chunks.empty())
+        {
+            const float step = 0.01f;
+            const glm::vec3 position = flight_path(world->index(), curr_time);
+            const glm::vec3 velocity =
+                (flight_path(world->index(), curr_time + step) - flight_path(world->index(), curr_time - step)) /
+                (2.0f * step);
+            camera->set_position(position);
+            camera->look_at(position + velocity, glm::vec3(0.0f, 1.0f, 0.0f));
+            world->update(position, velocity);
+        }
+
+        if (auto gpu_ms = frame_timer.poll())
+        {
+            resolution.add_sample(*gpu_ms);
+        }
+        const glm::ivec2 render_size = resolution.render_size(window_width, window_height);
+        // Mip selection follows the pixels actually rendered
+        textures.set_viewport_height(render_size.y);
+
+        frame_timer.begin();
+        scene_target.bind(render_size.x, render_size.y);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        scene.draw();
+        capture.begin_frame(render_size.x, render_size.y, modes[mode]);
+        scene.draw_world();
+        upscaler.draw(scene_target, window_width, window_height, upscale_filter);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        scene.draw_overlay();
+        frame_timer.end();
+        try
+        {
+            capture.end_frame();
+        }
+        catch (const std::runtime_error &error)
+        {
+            std::cerr << "Frame capture failed: " << error.what() << std::endl;
+        }
+        textures.update();
+
+        if (std::chrono::steady_clock::now() - last_title_update > std::chrono::milliseconds(500))
+        {
+            // Formatted into a fixed buffer, a string stream here would be the only allocation in a settled frame
+            const ResolutionStats stats = resolution.stats();
+            std::array<char, 256> title{};
+            size_t length = 0;
+            auto append = [&](const char *format, auto... values) {
+                const int written = std::snprintf(title.data() + length, title.size() - length, format, values...);
+                length = std::min(length + std::max(written, 0), title.size() - 1);
+            };
+            append(
+                "scale %.2f (%s) %dx%d  gpu %.2f/%.2f ms", stats.scale, to_string(stats.state), render_size.x,
+                render_size.y, stats.average_frame_ms, stats.target_frame_ms
+            );
+            if (world)
+            {
+                const StreamingStats streaming = world->stats();
+                append(
+                    "  chunks %zu (+%zu) %zu MiB  stalls %zu", streaming.resident_chunks, streaming.pending_loads,
+                    (streaming.cpu_bytes + streaming.gpu_bytes) / (1024 * 1024), streaming.stalled_frames
+                );
+            }
+            if (const auto &gpu = scene.gpu_scene())
+            {
+                append("  gpu driven %zu%s", gpu->stats().instances, gpu->stats().indirect_count ? " (count)" : "");
+            }
+            if (crowd_impostor)
+            {
+                append("  impostors %zu", crowd_impostor->stats().instances);
+            }
+            if (last_pick)
+            {
+                append("  picked triangle %u at %.2f", last_pick->triangle, last_pick->t);
+            }
+            if (allocation_counting())
+            {
+                append("  allocs %llu", static_cast<unsigned long long>(last_frame_allocations));
+            }
+            SDL_SetWindowTitle(window.get(), title.data());
+            last_title_update = std::chrono::steady_clock::now();
+        }
 
         // Present the backbuffer to the screen
         SDL_GL_SwapWindow(window.get());
+        frame_arena().reset();
 
+        last_frame_allocations = frame_allocations.count();
+        allocating_frames += last_frame_allocations > 0 ? 1 : 0;
         frames++;
     }
     SDL_Quit();
@@ -0,0 +1,476 @@
+#include "broadphase.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+// Insertion sort gives up and sorts from scratch past this many swaps per body, after teleports or a big shuffle
+const size_t max_swaps_per_body = 8;
+
+auto overlaps(const Bounds &lhs, const Bounds &rhs) -> bool
+{
+    return lhs.min.x <= rhs.max.x && rhs.min.x <= lhs.max.x && lhs.min.y <= rhs.max.y && rhs.min.y <= lhs.max.y &&
+           lhs.min.z <= rhs.max.z && rhs.min.z <= lhs.max.z;
+}
+
+auto make_pair(uint32_t lhs, uint32_t rhs) -> OverlapPair
+{
+    return lhs < rhs ? OverlapPair{lhs, rhs} : OverlapPair{rhs, lhs};
+}
+
+// Chunks are indexed by begin / grain, so grain must not be 0. parallel_for treats 0 as 1 and so does this.
+auto with_valid_grain(BroadphaseSettings settings) -> BroadphaseSettings
+{
+    settings.grain = std::max<size_t>(settings.grain, 1);
+    return settings;
+}
+
+auto chunk_count(size_t count, size_t grain) -> size_t
+{
+    return (count + grain - 1) / grain;
+}
+
+struct Cell
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+};
+
+auto operator==(const Cell &lhs, const Cell &rhs) -> bool
+{
+    return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+}
+
+auto cell_of(const glm::vec3 &point, float inv_cell_size) -> Cell
+{
+    return {
+        static_cast<int32_t>(std::floor(point.x * inv_cell_size)),
+        static_cast<int32_t>(std::floor(point.y * inv_cell_size)),
+        static_cast<int32_t>(std::floor(point.z * inv_cell_size)),
+    };
+}
+
+auto cell_hash(const Cell &cell) -> uint32_t
+{
+    const uint32_t x_prime = 73856093U;
+    const uint32_t y_prime = 19349663U;
+    const uint32_t z_prime = 83492791U;
+    return (static_cast<uint32_t>(cell.x) * x_prime) ^ (static_cast<uint32_t>(cell.y) * y_prime) ^
+           (static_cast<uint32_t>(cell.z) * z_prime);
+}
+
+struct CellEntry
+{
+    Cell cell;
+    uint32_t body;
+};
+} // namespace
+
+Broadphase::Broadphase(std::shared_ptr<ThreadPool> pool, BroadphaseSettings settings)
+    : pool(std::move(pool)), settings(with_valid_grain(settings))
+{
+}
+
+auto Broadphase::add(const Bounds &bounds) -> uint32_t
+{
+    uint32_t body = 0;
+    if (!free_bodies.empty())
+    {
+        body = free_bodies.back();
+        free_bodies.pop_back();
+        bodies[body] = bounds;
+        alive[body] = true;
+    }
+    else
+    {
+        body = static_cast<uint32_t>(bodies.size());
+        bodies.push_back(bounds);
+        alive.push_back(true);
+    }
+    // Insertion sort moves it into place at the next sweep
+    order.push_back({bounds.min[std::max(sort_axis, 0)], body});
+    return body;
+}
+
+void Broadphase::remove(uint32_t body)
+{
+    if (body >= bodies.size() || !alive[body])
+    {
+        throw std::out_of_range("Broadphase::remove of a missing body");
+    }
+    alive[body] = false;
+    removed.push_back(body);
+}
+
+void Broadphase::set_bounds(uint32_t body, const Bounds &bounds)
+{
+    bodies.at(body) = bounds;
+}
+
+void Broadphase::set_bounds(uint32_t first, const std::vector<Bounds> &bounds)
+{
+    if (first + bounds.size() > bodies.size())
+    {
+        throw std::out_of_range("Broadphase::set_bounds range exceeds body count");
+    }
+    std::copy(bounds.begin(), bounds.end(), bodies.begin() + first);
+}
+
+void Broadphase::set_settings(BroadphaseSettings settings)
+{
+    this->settings = with_valid_grain(settings);
+}
+
+auto Broadphase::update() -> const OverlapEvents &
+{
+    const auto start = std::chrono::steady_clock::now();
+    counters.swaps = 0;
+    counters.resorted = false;
+    if (!removed.empty())
+    {
+        order.erase(
+            std::remove_if(order.begin(), order.end(), [&](const SortEntry &entry) { return !alive[entry.body]; }),
+            order.end()
+        );
+        free_bodies.insert(free_bodies.end(), removed.begin(), removed.end());
+        removed.clear();
+    }
+
+    ChunkPairs found;
+    if (settings.method == BroadphaseMethod::sweep_and_prune)
+    {
+        sweep(found);
+    }
+    else
+    {
+        grid(found);
+    }
+    build_table(found);
+    diff_tables();
+    std::swap(latest, building);
+
+    counters.bodies = order.size();
+    counters.pairs = latest.partners.size();
+    counters.began = events.began.size();
+    counters.ended = events.ended.size();
+    counters.update_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return events;
+}
+
+auto Broadphase::pairs() const -> std::vector<OverlapPair>
+{
+    std::vector<OverlapPair> result;
+    result.reserve(latest.partners.size());
+    for (uint32_t body = 0; body + 1 < latest.offsets.size(); body++)
+    {
+        for (uint32_t partner = latest.offsets[body]; partner < latest.offsets[body + 1]; partner++)
+        {
+            result.push_back({body, latest.partners[partner]});
+        }
+    }
+    return result;
+}
+
+auto Broadphase::stats() const -> BroadphaseStats
+{
+    return counters;
+}
+
+void Broadphase::sweep(ChunkPairs &found)
+{
+    // Sweep along the axis the bodies are most spread over, so each body's forward scan stays short
+    glm::vec3 sum{0.0F};
+    glm::vec3 sum_squares{0.0F};
+    for (const SortEntry &entry : order)
+    {
+        const glm::vec3 centre = (bodies[entry.body].min + bodies[entry.body].max) * 0.5F;
+        sum += centre;
+        sum_squares += centre * centre;
+    }
+    const glm::vec3 variance = sum_squares - sum * sum / std::max(static_cast<float>(order.size()), 1.0F);
+    int axis = 0;
+    if (variance.y > variance[axis])
+    {
+        axis = 1;
+    }
+    if (variance.z > variance[axis])
+    {
+        axis = 2;
+    }
+    sort_order(axis);
+
+    const size_t count = order.size();
+    sorted.resize(count);
+    pool->parallel_for(count, settings.grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            // Rotate the sweep axis into x, the overlap test doesn't care about axis order
+            const Bounds &bounds = bodies[order[i].body];
+            sorted[i] = {
+                {bounds.min[axis], bounds.min[(axis + 1) % 3], bounds.min[(axis + 2) % 3]},
+                {bounds.max[axis], bounds.max[(axis + 1) % 3], bounds.max[(axis + 2) % 3]},
+            };
+        }
+    });
+
+    found.assign(chunk_count(count, settings.grain), {});
+    pool->parallel_for(count, settings.grain, [&](size_t begin, size_t end) {
+        std::vector<OverlapPair> &chunk = found[begin / settings.grain];
+        for (size_t i = begin; i < end; i++)
+        {
+            const Bounds &bounds = sorted[i];
+            // Later bodies start no earlier along the axis, so the scan ends at the first that starts past this one
+            for (size_t j = i + 1; j < count && sorted[j].min.x <= bounds.max.x; j++)
+            {
+                if (overlaps(bounds, sorted[j]))
+                {
+                    chunk.push_back(make_pair(order[i].body, order[j].body));
+                }
+            }
+        }
+    });
+}
+
+void Broadphase::sort_order(int axis)
+{
+    pool->parallel_for(order.size(), settings.grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            order[i].key = bodies[order[i].body].min[axis];
+        }
+    });
+    auto by_key = [](const SortEntry &lhs, const SortEntry &rhs) { return lhs.key < rhs.key; };
+    if (axis != sort_axis)
+    {
+        sort_axis = axis;
+        std::sort(order.begin(), order.end(), by_key);
+        counters.resorted = true;
+        return;
+    }
+
+    // Bodies move a little each tick, so the last order is nearly sorted and insertion sort is close to linear
+    const size_t max_swaps = max_swaps_per_body * order.size();
+    size_t swaps = 0;
+    for (size_t i = 1; i < order.size(); i++)
+    {
+        const SortEntry entry = order[i];
+        size_t j = i;
+        for (; j > 0 && order[j - 1].key > entry.key; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = entry;
+        swaps += i - j;
+        if (swaps > max_swaps)
+        {
+            std::sort(order.begin(), order.end(), by_key);
+            counters.resorted = true;
+            break;
+        }
+    }
+    counters.swaps = swaps;
+}
+
+void Broadphase::grid(ChunkPairs &found)
+{
+    const size_t count = bodies.size();
+    float cell_size = settings.cell_size;
+    if (cell_size <= 0.0F)
+    {
+        float extent_sum = 0.0F;
+        for (const SortEntry &entry : order)
+        {
+            const glm::vec3 size = bodies[entry.body].max - bodies[entry.body].min;
+            extent_sum += std::max({size.x, size.y, size.z});
+        }
+        cell_size = std::max(2.0F * extent_sum / std::max(static_cast<float>(order.size()), 1.0F), 1e-3F);
+    }
+    const float inv_cell_size = 1.0F / cell_size;
+
+    // Each body goes in every cell its box touches
+    std::vector<uint32_t> first_entry(count + 1, 0);
+    pool->parallel_for(count, settings.grain, [&](size_t begin, size_t end) {
+        for (size_t body = begin; body < end; body++)
+        {
+            if (!alive[body])
+            {
+                continue;
+            }
+            const Cell low = cell_of(bodies[body].min, inv_cell_size);
+            const Cell high = cell_of(bodies[body].max, inv_cell_size);
+            first_entry[body + 1] = static_cast<uint32_t>(
+                static_cast<int64_t>(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1)
+            );
+        }
+    });
+    for (size_t body = 0; body < count; body++)
+    {
+        first_entry[body + 1] += first_entry[body];
+    }
+    std::vector<CellEntry> entries(first_entry[count]);
+    pool->parallel_for(count, settings.grain, [&](size_t begin, size_t end) {
+        for (size_t body = begin; body < end; body++)
+        {
+            if (!alive[body])
+            {
+                continue;
+            }
+            const Cell low = cell_of(bodies[body].min, inv_cell_size);
+            const Cell high = cell_of(bodies[body].max, inv_cell_size);
+            uint32_t entry = first_entry[body];
+            for (int32_t x = low.x; x <= high.x; x++)
+            {
+                for (int32_t y = low.y; y <= high.y; y++)
+                {
+                    for (int32_t z = low.z; z <= high.z; z++)
+                    {
+                        entries[entry++] = {{x, y, z}, static_cast<uint32_t>(body)};
+                    }
+                }
+            }
+        }
+    });
+
+    // Counting sort into hash buckets, distinct cells can share a bucket so pairs only count within one cell
+    size_t bucket_count = 1;
+    while (bucket_count < entries.size() * 2)
+    {
+        bucket_count *= 2;
+    }
+    const uint32_t bucket_mask = static_cast<uint32_t>(bucket_count - 1);
+    std::vector<uint32_t> first_in_bucket(bucket_count + 1, 0);
+    for (const CellEntry &entry : entries)
+    {
+        first_in_bucket[(cell_hash(entry.cell) & bucket_mask) + 1]++;
+    }
+    for (size_t bucket = 0; bucket < bucket_count; bucket++)
+    {
+        first_in_bucket[bucket + 1] += first_in_bucket[bucket];
+    }
+    std::vector<CellEntry> bucketed(entries.size());
+    std::vector<uint32_t> cursor(first_in_bucket.begin(), first_in_bucket.end() - 1);
+    for (const CellEntry &entry : entries)
+    {
+        bucketed[cursor[cell_hash(entry.cell) & bucket_mask]++] = entry;
+    }
+
+    // Buckets hold a few entries each, so chunks cover many buckets
+    const size_t bucket_grain = settings.grain * 4;
+    found.assign(chunk_count(bucket_count, bucket_grain), {});
+    pool->parallel_for(bucket_count, bucket_grain, [&](size_t begin, size_t end) {
+        std::vector<OverlapPair> &chunk = found[begin / bucket_grain];
+        for (size_t bucket = begin; bucket < end; bucket++)
+        {
+            for (uint32_t lhs = first_in_bucket[bucket]; lhs < first_in_bucket[bucket + 1]; lhs++)
+            {
+                for (uint32_t rhs = lhs + 1; rhs < first_in_bucket[bucket + 1]; rhs++)
+                {
+                    const CellEntry &a = bucketed[lhs];
+                    const CellEntry &b = bucketed[rhs];
+                    if (!(a.cell == b.cell) || !overlaps(bodies[a.body], bodies[b.body]))
+                    {
+                        continue;
+                    }
+                    // Overlapping boxes share several cells, only the one holding their overlap's minimum reports it
+                    const glm::vec3 overlap_min = glm::max(bodies[a.body].min, bodies[b.body].min);
+                    if (cell_of(overlap_min, inv_cell_size) == a.cell)
+                    {
+                        chunk.push_back(make_pair(a.body, b.body));
+                    }
+                }
+            }
+        }
+    });
+}
+
+void Broadphase::build_table(const ChunkPairs &found)
+{
+    const size_t count = bodies.size();
+    building.offsets.assign(count + 1, 0);
+    for (const auto &chunk : found)
+    {
+        for (const OverlapPair &pair : chunk)
+        {
+            building.offsets[pair.a + 1]++;
+        }
+    }
+    for (size_t body = 0; body < count; body++)
+    {
+        building.offsets[body + 1] += building.offsets[body];
+    }
+    building.partners.resize(building.offsets[count]);
+    std::vector<uint32_t> cursor(building.offsets.begin(), building.offsets.end() - 1);
+    for (const auto &chunk : found)
+    {
+        for (const OverlapPair &pair : chunk)
+        {
+            building.partners[cursor[pair.a]++] = pair.b;
+        }
+    }
+    pool->parallel_for(count, settings.grain, [&](size_t begin, size_t end) {
+        for (size_t body = begin; body < end; body++)
+        {
+            std::sort(
+                building.partners.begin() + building.offsets[body],
+                building.partners.begin() + building.offsets[body + 1]
+            );
+        }
+    });
+}
+
+void Broadphase::diff_tables()
+{
+    // Rows of bodies added since the last update are empty in the latest table
+    const size_t count = bodies.size();
+    auto row = [](const PairTable &table, size_t body) {
+        if (body + 1 >= table.offsets.size())
+        {
+            return std::pair<const uint32_t *, const uint32_t *>{nullptr, nullptr};
+        }
+        const uint32_t *data = table.partners.data();
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        return std::pair{data + table.offsets[body], data + table.offsets[body + 1]};
+    };
+
+    std::vector<OverlapEvents> chunks(chunk_count(count, settings.grain));
+    pool->parallel_for(count, settings.grain, [&](size_t begin, size_t end) {
+        OverlapEvents &chunk = chunks[begin / settings.grain];
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        for (size_t body = begin; body < end; body++)
+        {
+            const auto a = static_cast<uint32_t>(body);
+            auto [now, now_end] = row(building, body);
+            auto [before, before_end] = row(latest, body);
+            while (now != now_end || before != before_end)
+            {
+                if (before == before_end || (now != now_end && *now < *before))
+                {
+                    chunk.began.push_back({a, *now++});
+                }
+                else if (now == now_end || *before < *now)
+                {
+                    chunk.ended.push_back({a, *before++});
+                }
+                else
+                {
+                    chunk.persisting.push_back({a, *now++});
+                    before++;
+                }
+            }
+        }
+        // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    });
+
+    events.began.clear();
+    events.persisting.clear();
+    events.ended.clear();
+    for (const OverlapEvents &chunk : chunks)
+    {
+        events.began.insert(events.began.end(), chunk.began.begin(), chunk.began.end());
+        events.persisting.insert(events.persisting.end(), chunk.persisting.begin(), chunk.persisting.end());
+        events.ended.insert(events.ended.end(), chunk.ended.begin(), chunk.ended.end());
+    }
+}
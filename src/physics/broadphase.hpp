@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../core/thread_pool.hpp"
+#include "../scene/bounds.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Two bodies whose boxes overlap, a < b
+struct OverlapPair
+{
+    uint32_t a;
+    uint32_t b;
+};
+
+inline auto operator==(const OverlapPair &lhs, const OverlapPair &rhs) -> bool
+{
+    return lhs.a == rhs.a && lhs.b == rhs.b;
+}
+
+// Changes since the previous update, each list sorted by a then b
+struct OverlapEvents
+{
+    std::vector<OverlapPair> began;
+    std::vector<OverlapPair> persisting;
+    std::vector<OverlapPair> ended;
+};
+
+enum class BroadphaseMethod
+{
+    // Bodies stay sorted along one axis between updates, cheap when they move a little each tick
+    sweep_and_prune,
+    // Bodies are binned into cells each update, suits evenly spread bodies of similar size
+    uniform_grid,
+};
+
+struct BroadphaseSettings
+{
+    BroadphaseMethod method = BroadphaseMethod::sweep_and_prune;
+    // Grid cell edge, zero sizes cells to twice the average body extent
+    float cell_size = 0.0F;
+    // Bodies per parallel task, 0 is taken as 1
+    size_t grain = 2048;
+};
+
+struct BroadphaseStats
+{
+    size_t bodies;
+    size_t pairs;
+    size_t began;
+    size_t ended;
+    // Sweep and prune only, swaps made keeping the bodies sorted and whether it gave up and sorted from scratch
+    size_t swaps;
+    bool resorted;
+    float update_ms;
+};
+
+// Finds overlapping pairs among world space boxes. Bodies keep the id add() gives them until removed, set their
+// boxes as they move and call update() once per tick for the overlaps that began, persisted and ended since the
+// last one. The sweep, the per body pair lists and the comparison with the last tick all run across the pool.
+class Broadphase
+{
+  public:
+    explicit Broadphase(std::shared_ptr<ThreadPool> pool, BroadphaseSettings settings = {});
+    auto add(const Bounds &bounds) -> uint32_t;
+    // The body's pairs end at the next update
+    void remove(uint32_t body);
+    void set_bounds(uint32_t body, const Bounds &bounds);
+    // Bodies [first, first + bounds.size()) in one call, for callers that added them in order and never remove any
+    void set_bounds(uint32_t first, const std::vector<Bounds> &bounds);
+    void set_settings(BroadphaseSettings settings);
+    auto update() -> const OverlapEvents &;
+    // Every overlap found by the last update, sorted by a then b
+    [[nodiscard]] auto pairs() const -> std::vector<OverlapPair>;
+    [[nodiscard]] auto stats() const -> BroadphaseStats;
+
+  private:
+    // Pairs for every body in compressed rows, row a holds each b > a that a overlaps, sorted
+    struct PairTable
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> partners;
+    };
+    struct SortEntry
+    {
+        float key;
+        uint32_t body;
+    };
+    // Found pairs go in one list per parallel chunk, so no locking is needed
+    using ChunkPairs = std::vector<std::vector<OverlapPair>>;
+    void sweep(ChunkPairs &found);
+    void sort_order(int axis);
+    void grid(ChunkPairs &found);
+    void build_table(const ChunkPairs &found);
+    void diff_tables();
+    std::shared_ptr<ThreadPool> pool;
+    BroadphaseSettings settings;
+    std::vector<Bounds> bodies;
+    std::vector<bool> alive;
+    std::vector<uint32_t> free_bodies;
+    // Ids only become free for reuse at the next update, once they're out of the sweep order
+    std::vector<uint32_t> removed;
+    // Live bodies sorted by box minimum along sort_axis as of the last sweep, new bodies are appended
+    std::vector<SortEntry> order;
+    int sort_axis{-1};
+    // Boxes gathered into sweep order with the sweep axis in x
+    std::vector<Bounds> sorted;
+    PairTable latest;
+    PairTable building;
+    OverlapEvents events;
+    BroadphaseStats counters{};
+};
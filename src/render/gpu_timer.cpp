@@ -0,0 +1,54 @@
+#include "gpu_timer.hpp"
+
+GpuTimer::GpuTimer(size_t latency) : queries(latency)
+{
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+void GpuTimer::begin()
+{
+    if (pending == queries.size())
+    {
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+    running = true;
+}
+
+void GpuTimer::end()
+{
+    if (!running)
+    {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    running = false;
+    next = (next + 1) % queries.size();
+    pending++;
+}
+
+auto GpuTimer::poll() -> std::optional<float>
+{
+    const float nanoseconds_per_ms = 1e6F;
+    std::optional<float> latest;
+    while (pending > 0)
+    {
+        const GLuint query = queries[(next + queries.size() - pending) % queries.size()];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+        {
+            break;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        latest = static_cast<float>(elapsed) / nanoseconds_per_ms;
+        pending--;
+    }
+    return latest;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <optional>
+#include <vector>
+
+// Times GPU work with GL_TIME_ELAPSED queries kept in a ring. Results are read a few frames after they were issued,
+// once the GPU has caught up, so timing never stalls the pipeline. Only one timer can be running at a time.
+class GpuTimer
+{
+  public:
+    explicit GpuTimer(size_t latency = 4);
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer(GpuTimer &&) = delete;
+    auto operator=(const GpuTimer &) -> GpuTimer & = delete;
+    auto operator=(GpuTimer &&) -> GpuTimer & = delete;
+    ~GpuTimer();
+    // Frames where every query is still in flight go untimed
+    void begin();
+    void end();
+    // Newest measurement in milliseconds that finished since the last poll
+    auto poll() -> std::optional<float>;
+
+  private:
+    std::vector<GLuint> queries;
+    size_t next{};
+    size_t pending{};
+    bool running{};
+};
@@ -0,0 +1,87 @@
+#include "render_target.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+RenderTarget::RenderTarget()
+{
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &colour);
+    glGenRenderbuffers(1, &depth);
+}
+
+RenderTarget::~RenderTarget()
+{
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &colour);
+    glDeleteRenderbuffers(1, &depth);
+}
+
+void RenderTarget::reserve(int width, int height)
+{
+    if (width <= allocated_width && height <= allocated_height)
+    {
+        return;
+    }
+    allocated_width = std::max(width, allocated_width);
+    allocated_height = std::max(height, allocated_height);
+
+    glBindTexture(GL_TEXTURE_2D, colour);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, allocated_width, allocated_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, allocated_width, allocated_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("Render target framebuffer incomplete");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::bind(int width, int height)
+{
+    reserve(width, height);
+    render_width = width;
+    render_height = height;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+auto RenderTarget::framebuffer() const -> GLuint
+{
+    return fbo;
+}
+
+auto RenderTarget::colour_texture() const -> GLuint
+{
+    return colour;
+}
+
+auto RenderTarget::width() const -> int
+{
+    return render_width;
+}
+
+auto RenderTarget::height() const -> int
+{
+    return render_height;
+}
+
+auto RenderTarget::storage_width() const -> int
+{
+    return allocated_width;
+}
+
+auto RenderTarget::storage_height() const -> int
+{
+    return allocated_height;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Offscreen colour and depth target. Storage grows to the largest size rendered and smaller renders use its bottom
+// left corner, so changing resolution every frame never reallocates.
+class RenderTarget
+{
+  public:
+    RenderTarget();
+    RenderTarget(const RenderTarget &) = delete;
+    RenderTarget(RenderTarget &&) = delete;
+    auto operator=(const RenderTarget &) -> RenderTarget & = delete;
+    auto operator=(RenderTarget &&) -> RenderTarget & = delete;
+    ~RenderTarget();
+    // Allocates storage for at least width x height up front, avoiding a reallocation the first time it's reached
+    void reserve(int width, int height);
+    // Binds the target for drawing at width x height and sets the viewport to match
+    void bind(int width, int height);
+    [[nodiscard]] auto framebuffer() const -> GLuint;
+    [[nodiscard]] auto colour_texture() const -> GLuint;
+    // Size of the last bind
+    [[nodiscard]] auto width() const -> int;
+    [[nodiscard]] auto height() const -> int;
+    [[nodiscard]] auto storage_width() const -> int;
+    [[nodiscard]] auto storage_height() const -> int;
+
+  private:
+    GLuint fbo{};
+    GLuint colour{};
+    GLuint depth{};
+    int render_width{};
+    int render_height{};
+    int allocated_width{};
+    int allocated_height{};
+};
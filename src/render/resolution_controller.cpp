@@ -0,0 +1,80 @@
+#include "resolution_controller.hpp"
+#include <algorithm>
+#include <cmath>
+
+ResolutionController::ResolutionController(ResolutionSettings settings)
+    : settings(settings), current_scale(settings.max_scale)
+{
+}
+
+void ResolutionController::set_settings(ResolutionSettings settings)
+{
+    this->settings = settings;
+    current_scale = std::clamp(current_scale, settings.min_scale, settings.max_scale);
+}
+
+void ResolutionController::add_sample(float gpu_frame_ms)
+{
+    last_ms = gpu_frame_ms;
+    average_ms = has_samples ? average_ms + (gpu_frame_ms - average_ms) * settings.smoothing : gpu_frame_ms;
+    has_samples = true;
+    if (average_ms <= 0.0F)
+    {
+        return;
+    }
+
+    const float ratio = settings.target_frame_ms * settings.headroom / average_ms;
+    if (std::abs(ratio - 1.0F) <= settings.deadband)
+    {
+        state = ResolutionState::holding;
+        return;
+    }
+    const float desired = current_scale * std::sqrt(ratio);
+    const float stepped = std::clamp(desired, current_scale - settings.max_step, current_scale + settings.max_step);
+    const float next = std::clamp(stepped, settings.min_scale, settings.max_scale);
+    if (next == current_scale)
+    {
+        state = ratio < 1.0F ? ResolutionState::limited_at_min : ResolutionState::limited_at_max;
+    }
+    else
+    {
+        state = next < current_scale ? ResolutionState::scaling_down : ResolutionState::scaling_up;
+    }
+    current_scale = next;
+}
+
+auto ResolutionController::scale() const -> float
+{
+    return current_scale;
+}
+
+auto ResolutionController::render_size(int width, int height) const -> glm::ivec2
+{
+    return {
+        std::max(1, static_cast<int>(std::lround(static_cast<float>(width) * current_scale))),
+        std::max(1, static_cast<int>(std::lround(static_cast<float>(height) * current_scale))),
+    };
+}
+
+auto ResolutionController::stats() const -> ResolutionStats
+{
+    return {current_scale, last_ms, average_ms, settings.target_frame_ms, state};
+}
+
+auto to_string(ResolutionState state) -> const char *
+{
+    switch (state)
+    {
+    case ResolutionState::holding:
+        return "holding";
+    case ResolutionState::scaling_down:
+        return "scaling down";
+    case ResolutionState::scaling_up:
+        return "scaling up";
+    case ResolutionState::limited_at_min:
+        return "at min";
+    case ResolutionState::limited_at_max:
+        return "at max";
+    }
+    return "unknown";
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct ResolutionSettings
+{
+    // GPU time per frame the controller aims for
+    float target_frame_ms = 1000.0F / 60.0F;
+    // Bounds on the fraction of the window size the scene renders at, per axis
+    float min_scale = 0.5F;
+    float max_scale = 1.0F;
+    // Fraction of the budget aimed for, leaving room for spikes
+    float headroom = 0.9F;
+    // Frame time error ignored, so small noise doesn't move the resolution
+    float deadband = 0.05F;
+    // Largest change in scale per sample, keeps the resolution from oscillating while the GPU catches up
+    float max_step = 0.05F;
+    // Weight of each new sample in the averaged frame time
+    float smoothing = 0.1F;
+};
+
+enum class ResolutionState
+{
+    holding,
+    scaling_down,
+    scaling_up,
+    // Over budget at the minimum scale, the frame is bound by something resolution doesn't change
+    limited_at_min,
+    // Under budget at the maximum scale
+    limited_at_max,
+};
+
+struct ResolutionStats
+{
+    float scale;
+    float last_frame_ms;
+    float average_frame_ms;
+    float target_frame_ms;
+    ResolutionState state;
+};
+
+// Picks the scene render scale from measured GPU frame times. Pixel count is treated as proportional to GPU time, so
+// scale moves by the square root of the budget ratio, rate limited and clamped to the settings.
+class ResolutionController
+{
+  public:
+    explicit ResolutionController(ResolutionSettings settings = {});
+    void set_settings(ResolutionSettings settings);
+    void add_sample(float gpu_frame_ms);
+    [[nodiscard]] auto scale() const -> float;
+    // Size to render a window of width x height at, never below one pixel
+    [[nodiscard]] auto render_size(int width, int height) const -> glm::ivec2;
+    [[nodiscard]] auto stats() const -> ResolutionStats;
+
+  private:
+    ResolutionSettings settings;
+    float current_scale;
+    float last_ms{};
+    float average_ms{};
+    bool has_samples{};
+    ResolutionState state{ResolutionState::holding};
+};
+
+auto to_string(ResolutionState state) -> const char *;
@@ -0,0 +1,29 @@
+#version 330 core
+// Bilinear upscale followed by contrast adaptive sharpening: neighbours are subtracted from the centre, less so where
+// local contrast is already high, which avoids ringing around hard edges.
+in vec2 uv;
+uniform sampler2D source;
+uniform vec2 texel_size;
+// Last texel centre of the rendered region, taps past it would read stale storage
+uniform vec2 uv_max;
+uniform float sharpness;
+
+out vec4 frag_colour;
+
+vec3 tap(vec2 offset) {
+    return texture(source, min(uv + offset * texel_size, uv_max)).rgb;
+}
+
+void main() {
+    vec3 centre = tap(vec2(0.0f));
+    vec3 north = tap(vec2(0.0f, 1.0f));
+    vec3 south = tap(vec2(0.0f, -1.0f));
+    vec3 east = tap(vec2(1.0f, 0.0f));
+    vec3 west = tap(vec2(-1.0f, 0.0f));
+    vec3 lowest = min(centre, min(min(north, south), min(east, west)));
+    vec3 highest = max(centre, max(max(north, south), max(east, west)));
+    vec3 headroom = min(lowest, 1.0f - highest) / max(highest, vec3(0.0001f));
+    vec3 weight = -sqrt(clamp(headroom, 0.0f, 1.0f)) * mix(0.125f, 0.2f, sharpness);
+    vec3 sharpened = (centre + (north + south + east + west) * weight) / (1.0f + 4.0f * weight);
+    frag_colour = vec4(clamp(sharpened, 0.0f, 1.0f), 1.0f);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+// Full screen triangle generated from the vertex index, no vertex buffer needed
+uniform vec2 uv_scale;
+out vec2 uv;
+void main() {
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = corner * uv_scale;
+    gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+}
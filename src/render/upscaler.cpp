@@ -0,0 +1,79 @@
+#include "upscaler.hpp"
+#include "../capture/frame_capture.hpp"
+#include "../shader/shader.hpp"
+#include "upscale_fragment_source.h"
+#include "upscale_vertex_source.h"
+#include <array>
+
+Upscaler::Upscaler()
+    : program(link_program(UPSCALE_VERTEX_SOURCE, UPSCALE_FRAGMENT_SOURCE)),
+      uv_scale(glGetUniformLocation(program, "uv_scale")), texel_size(glGetUniformLocation(program, "texel_size")),
+      uv_max(glGetUniformLocation(program, "uv_max")), sharpness_location(glGetUniformLocation(program, "sharpness")),
+      source_location(glGetUniformLocation(program, "source"))
+{
+    // Core profile refuses draws without a vertex array, even one with no attributes
+    glGenVertexArrays(1, &vertex_array);
+}
+
+Upscaler::~Upscaler()
+{
+    glDeleteVertexArrays(1, &vertex_array);
+    glDeleteProgram(program);
+}
+
+void Upscaler::draw(
+    const RenderTarget &source, int width, int height, UpscaleFilter filter, float sharpness, GLuint target
+)
+{
+    if (auto *capture = FrameCapture::current())
+    {
+        capture->record_upscale(width, height, static_cast<uint8_t>(filter), sharpness);
+    }
+    if (filter == UpscaleFilter::bilinear)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, source.framebuffer());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+        glBlitFramebuffer(
+            0, 0, source.width(), source.height(), 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR
+        );
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(0, 0, width, height);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, width, height);
+
+    // The pass covers the screen as a filled triangle whatever state the scene left behind
+    std::array<GLint, 2> polygon_mode{};
+    glGetIntegerv(GL_POLYGON_MODE, polygon_mode.data());
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    const auto storage_width = static_cast<float>(source.storage_width());
+    const auto storage_height = static_cast<float>(source.storage_height());
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source.colour_texture());
+    glUniform1i(source_location, 0);
+    glUniform2f(
+        uv_scale, static_cast<float>(source.width()) / storage_width,
+        static_cast<float>(source.height()) / storage_height
+    );
+    glUniform2f(texel_size, 1.0F / storage_width, 1.0F / storage_height);
+    glUniform2f(
+        uv_max, (static_cast<float>(source.width()) - 0.5F) / storage_width,
+        (static_cast<float>(source.height()) - 0.5F) / storage_height
+    );
+    glUniform1f(sharpness_location, sharpness);
+    glBindVertexArray(vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(polygon_mode[0]));
+    if (depth_test == GL_TRUE)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
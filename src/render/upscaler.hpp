@@ -0,0 +1,37 @@
+#pragma once
+
+#include "render_target.hpp"
+#include <glad/glad.h>
+
+enum class UpscaleFilter
+{
+    bilinear,
+    sharpen,
+};
+
+// Draws the rendered region of a RenderTarget over the whole default framebuffer
+class Upscaler
+{
+  public:
+    Upscaler();
+    Upscaler(const Upscaler &) = delete;
+    Upscaler(Upscaler &&) = delete;
+    auto operator=(const Upscaler &) -> Upscaler & = delete;
+    auto operator=(Upscaler &&) -> Upscaler & = delete;
+    ~Upscaler();
+    // Leaves target bound with its viewport at width x height, the default framebuffer unless given. Sharpness in
+    // [0, 1] only affects the sharpen filter.
+    void draw(
+        const RenderTarget &source, int width, int height, UpscaleFilter filter, float sharpness = 0.5F,
+        GLuint target = 0
+    );
+
+  private:
+    GLuint program;
+    GLuint vertex_array{};
+    GLint uv_scale;
+    GLint texel_size;
+    GLint uv_max;
+    GLint sharpness_location;
+    GLint source_location;
+};
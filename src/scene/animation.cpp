@@ -0,0 +1,404 @@
+#include "animation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+const float quantized_max = 32767.0F;
+const uint16_t quantized_mask = 0x7FFF;
+const int index_shift = 15;
+const double default_ticks_per_second = 25.0;
+
+struct Segment
+{
+    size_t lower;
+    size_t upper;
+    float weight;
+};
+
+// Finds the two keys either side of frame within frames[first, first + count)
+auto find_segment(const std::vector<uint16_t> &frames, size_t first, size_t count, float frame) -> Segment
+{
+    const auto begin = frames.begin() + static_cast<std::ptrdiff_t>(first);
+    const auto end = begin + static_cast<std::ptrdiff_t>(count);
+    const auto upper = std::upper_bound(begin, end, frame, [](float value, uint16_t key) {
+        return value < static_cast<float>(key);
+    });
+    if (upper == begin)
+    {
+        return {first, first, 0.0F};
+    }
+    if (upper == end)
+    {
+        return {first + count - 1, first + count - 1, 0.0F};
+    }
+    const auto lower = upper - 1;
+    const float span = static_cast<float>(*upper - *lower);
+    return {
+        static_cast<size_t>(lower - frames.begin()),
+        static_cast<size_t>(upper - frames.begin()),
+        (frame - static_cast<float>(*lower)) / span,
+    };
+}
+
+auto nlerp(glm::quat from, glm::quat to, float weight) -> glm::quat
+{
+    if (glm::dot(from, to) < 0.0F)
+    {
+        to = -to;
+    }
+    return glm::normalize(from * (1.0F - weight) + to * weight);
+}
+
+auto rotation_error(glm::quat lhs, glm::quat rhs) -> float
+{
+    const float cos_half_angle = std::min(std::abs(glm::dot(lhs, rhs)), 1.0F);
+    return 2.0F * std::acos(cos_half_angle);
+}
+
+// Interpolated value of an Assimp key array at ticks
+template <typename Key, typename Interpolate>
+auto sample_keys(const Key *keys, unsigned int count, double ticks, Interpolate interpolate)
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (count == 1 || ticks <= keys[0].mTime)
+    {
+        return interpolate(keys[0].mValue, keys[0].mValue, 0.0F);
+    }
+    for (unsigned int i = 1; i < count; i++)
+    {
+        if (ticks < keys[i].mTime)
+        {
+            const auto weight = static_cast<float>((ticks - keys[i - 1].mTime) / (keys[i].mTime - keys[i - 1].mTime));
+            return interpolate(keys[i - 1].mValue, keys[i].mValue, weight);
+        }
+    }
+    return interpolate(keys[count - 1].mValue, keys[count - 1].mValue, 0.0F);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+auto lerp_vector(const aiVector3D &from, const aiVector3D &to, float weight) -> glm::vec3
+{
+    return glm::mix(glm::vec3(from.x, from.y, from.z), glm::vec3(to.x, to.y, to.z), weight);
+}
+
+auto slerp_rotation(const aiQuaternion &from, const aiQuaternion &to, float weight) -> glm::quat
+{
+    return glm::slerp(glm::quat(from.w, from.x, from.y, from.z), glm::quat(to.w, to.x, to.y, to.z), weight);
+}
+
+// Greedily drops every sample that linear interpolation between the surrounding kept samples reproduces within
+// tolerance. error(from, to, weight, expected) measures one interpolated sample.
+template <typename Value, typename Error>
+auto reduce_keys(const std::vector<Value> &samples, float tolerance, Error error) -> std::vector<size_t>
+{
+    std::vector<size_t> kept{0};
+    size_t anchor = 0;
+    for (size_t candidate = 2; candidate < samples.size(); candidate++)
+    {
+        bool fits = true;
+        for (size_t i = anchor + 1; i < candidate && fits; i++)
+        {
+            const auto weight = static_cast<float>(i - anchor) / static_cast<float>(candidate - anchor);
+            fits = error(samples[anchor], samples[candidate], weight, samples[i]) <= tolerance;
+        }
+        if (!fits)
+        {
+            anchor = candidate - 1;
+            kept.push_back(anchor);
+        }
+    }
+    if (samples.size() > 1)
+    {
+        kept.push_back(samples.size() - 1);
+    }
+    // A constant track only needs one key
+    if (kept.size() == 2 && std::all_of(samples.begin(), samples.end(), [&](const Value &sample) {
+            return error(samples[0], samples[0], 0.0F, sample) <= tolerance;
+        }))
+    {
+        kept.pop_back();
+    }
+    return kept;
+}
+
+template <typename Channel, typename Value, typename Encode>
+void append_track(
+    Channel &channel, size_t joint, const std::vector<Value> &samples, const std::vector<size_t> &kept, Encode encode
+)
+{
+    channel.tracks[joint] = {static_cast<uint32_t>(channel.keys.size()), static_cast<uint32_t>(kept.size())};
+    for (size_t frame : kept)
+    {
+        channel.frames.push_back(static_cast<uint16_t>(frame));
+        channel.keys.push_back(encode(samples[frame]));
+    }
+}
+} // namespace
+
+auto QuantizedQuat::encode(glm::quat rotation) -> QuantizedQuat
+{
+    rotation = glm::normalize(rotation);
+    const std::array<float, 4> components{rotation.x, rotation.y, rotation.z, rotation.w};
+    size_t largest = 0;
+    for (size_t i = 1; i < components.size(); i++)
+    {
+        if (std::abs(components[i]) > std::abs(components[largest]))
+        {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so make the dropped component positive
+    const float sign = components[largest] < 0.0F ? -1.0F : 1.0F;
+
+    QuantizedQuat quantized{};
+    size_t out = 0;
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        if (i == largest)
+        {
+            continue;
+        }
+        // The smaller three are within +-1/sqrt(2)
+        const float normalised = std::clamp(((components[i] * sign * std::sqrt(2.0F)) + 1.0F) * 0.5F, 0.0F, 1.0F);
+        quantized.packed.at(out++) = static_cast<uint16_t>(std::lround(normalised * quantized_max));
+    }
+    quantized.packed[0] = static_cast<uint16_t>(quantized.packed[0] | ((largest & 1U) << index_shift));
+    quantized.packed[1] = static_cast<uint16_t>(quantized.packed[1] | ((largest >> 1U) << index_shift));
+    return quantized;
+}
+
+auto QuantizedQuat::decode() const -> glm::quat
+{
+    const size_t largest = (packed[0] >> index_shift) | ((packed[1] >> index_shift) << 1U);
+    std::array<float, 4> components{};
+    float sum = 0.0F;
+    size_t in = 0;
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        if (i == largest)
+        {
+            continue;
+        }
+        const float normalised = static_cast<float>(packed.at(in++) & quantized_mask) / quantized_max;
+        components[i] = ((normalised * 2.0F) - 1.0F) / std::sqrt(2.0F);
+        sum += components[i] * components[i];
+    }
+    components[largest] = std::sqrt(std::max(0.0F, 1.0F - sum));
+    return {components[3], components[0], components[1], components[2]};
+}
+
+AnimationClip::AnimationClip(const aiAnimation &animation, const Skeleton &skeleton, const ClipCompression &compression)
+    : clip_name(animation.mName.C_Str()), sample_rate(compression.sample_rate)
+{
+    const double ticks_per_second =
+        animation.mTicksPerSecond > 0.0 ? animation.mTicksPerSecond : default_ticks_per_second;
+    frame_count = std::max(1.0F, static_cast<float>(animation.mDuration / ticks_per_second) * sample_rate);
+    const auto last_frame = static_cast<size_t>(std::ceil(frame_count));
+    if (last_frame > std::numeric_limits<uint16_t>::max())
+    {
+        throw std::runtime_error("Animation too long for 16 bit frame numbers: " + clip_name);
+    }
+
+    const size_t joints = skeleton.joint_count();
+    rotations.tracks.assign(joints, {0, 0});
+    translations.tracks.assign(joints, {0, 0});
+    scales.tracks.assign(joints, {0, 0});
+
+    auto vector_error = [](glm::vec3 from, glm::vec3 to, float weight, glm::vec3 expected) {
+        return glm::length(glm::mix(from, to, weight) - expected);
+    };
+    auto quat_error = [](glm::quat from, glm::quat to, float weight, glm::quat expected) {
+        return rotation_error(nlerp(from, to, weight), expected);
+    };
+    auto keep_vector = [](glm::vec3 value) {
+        return value;
+    };
+
+    std::vector<glm::quat> rotation_samples(last_frame + 1);
+    std::vector<glm::vec3> translation_samples(last_frame + 1);
+    std::vector<glm::vec3> scale_samples(last_frame + 1);
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (unsigned int channel_idx = 0; channel_idx < animation.mNumChannels; channel_idx++)
+    {
+        const aiNodeAnim &channel = *animation.mChannels[channel_idx];
+        auto joint = skeleton.find_joint(channel.mNodeName.C_Str());
+        if (!joint)
+        {
+            continue;
+        }
+        for (size_t frame = 0; frame <= last_frame; frame++)
+        {
+            const double ticks =
+                std::min(static_cast<double>(frame) / sample_rate * ticks_per_second, animation.mDuration);
+            translation_samples[frame] =
+                sample_keys(channel.mPositionKeys, channel.mNumPositionKeys, ticks, lerp_vector);
+            scale_samples[frame] = sample_keys(channel.mScalingKeys, channel.mNumScalingKeys, ticks, lerp_vector);
+            rotation_samples[frame] =
+                sample_keys(channel.mRotationKeys, channel.mNumRotationKeys, ticks, slerp_rotation);
+            // Keep neighbouring samples in the same hemisphere so they interpolate along the short path
+            if (frame > 0 && glm::dot(rotation_samples[frame - 1], rotation_samples[frame]) < 0.0F)
+            {
+                rotation_samples[frame] = -rotation_samples[frame];
+            }
+        }
+
+        append_track(
+            rotations,
+            *joint,
+            rotation_samples,
+            reduce_keys(rotation_samples, compression.rotation_tolerance, quat_error),
+            QuantizedQuat::encode
+        );
+        append_track(
+            translations,
+            *joint,
+            translation_samples,
+            reduce_keys(translation_samples, compression.translation_tolerance, vector_error),
+            keep_vector
+        );
+        append_track(
+            scales,
+            *joint,
+            scale_samples,
+            reduce_keys(scale_samples, compression.scale_tolerance, vector_error),
+            keep_vector
+        );
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    rotations.frames.shrink_to_fit();
+    rotations.keys.shrink_to_fit();
+    translations.frames.shrink_to_fit();
+    translations.keys.shrink_to_fit();
+    scales.frames.shrink_to_fit();
+    scales.keys.shrink_to_fit();
+}
+
+auto AnimationClip::name() const -> const std::string &
+{
+    return clip_name;
+}
+
+auto AnimationClip::duration() const -> float
+{
+    return frame_count / sample_rate;
+}
+
+auto AnimationClip::memory_usage() const -> size_t
+{
+    auto channel_size = [](const auto &channel) {
+        return (channel.tracks.capacity() * sizeof(Track)) + (channel.frames.capacity() * sizeof(uint16_t)) +
+               (channel.keys.capacity() * sizeof(typename std::decay_t<decltype(channel.keys)>::value_type));
+    };
+    return sizeof(*this) + clip_name.capacity() + channel_size(rotations) + channel_size(translations) +
+           channel_size(scales);
+}
+
+void AnimationClip::sample(float time, const Skeleton &skeleton, Pose &out) const
+{
+    const Pose &bind = skeleton.bind_pose();
+    out.resize(bind.size());
+    float frame = std::fmod(time * sample_rate, frame_count);
+    if (frame < 0.0F)
+    {
+        frame += frame_count;
+    }
+
+    for (size_t joint = 0; joint < bind.size(); joint++)
+    {
+        out[joint] = bind[joint];
+        if (const Track track = rotations.tracks[joint]; track.count > 0)
+        {
+            const Segment segment = find_segment(rotations.frames, track.first, track.count, frame);
+            out[joint].rotation =
+                nlerp(rotations.keys[segment.lower].decode(), rotations.keys[segment.upper].decode(), segment.weight);
+        }
+        if (const Track track = translations.tracks[joint]; track.count > 0)
+        {
+            const Segment segment = find_segment(translations.frames, track.first, track.count, frame);
+            out[joint].translation =
+                glm::mix(translations.keys[segment.lower], translations.keys[segment.upper], segment.weight);
+        }
+        if (const Track track = scales.tracks[joint]; track.count > 0)
+        {
+            const Segment segment = find_segment(scales.frames, track.first, track.count, frame);
+            out[joint].scale = glm::mix(scales.keys[segment.lower], scales.keys[segment.upper], segment.weight);
+        }
+    }
+}
+
+Character::Character(std::shared_ptr<const Skeleton> skeleton)
+    : skeleton(std::move(skeleton)), bone_palette(std::make_shared<BonePalette>())
+{
+    // Size everything up front so updates never allocate
+    const size_t joints = this->skeleton->joint_count();
+    current_pose = this->skeleton->bind_pose();
+    previous_pose.resize(joints);
+    blended_pose.resize(joints);
+    globals.resize(joints);
+    bone_palette->resize(this->skeleton->bone_count(), glm::mat4(1.0F));
+    this->skeleton->compute_palette(current_pose, globals, *bone_palette);
+}
+
+void Character::play(std::shared_ptr<const AnimationClip> clip, float fade_time)
+{
+    previous = fade_time > 0.0F ? std::move(current) : nullptr;
+    previous_time = current_time;
+    current = std::move(clip);
+    current_time = 0.0F;
+    fade_elapsed = 0.0F;
+    fade_duration = fade_time;
+}
+
+void Character::set_speed(float speed)
+{
+    this->speed = speed;
+}
+
+void Character::update(float delta_time)
+{
+    if (!current)
+    {
+        return;
+    }
+    // Wrap so long running characters don't lose float precision
+    current_time = std::fmod(current_time + (delta_time * speed), current->duration());
+    current->sample(current_time, *skeleton, current_pose);
+
+    const Pose *pose = &current_pose;
+    if (previous)
+    {
+        fade_elapsed += delta_time;
+        if (fade_elapsed < fade_duration)
+        {
+            previous_time = std::fmod(previous_time + (delta_time * speed), previous->duration());
+            previous->sample(previous_time, *skeleton, previous_pose);
+            blend_poses(previous_pose, current_pose, fade_elapsed / fade_duration, blended_pose);
+            pose = &blended_pose;
+        }
+        else
+        {
+            previous.reset();
+        }
+    }
+    skeleton->compute_palette(*pose, globals, *bone_palette);
+}
+
+auto Character::palette() const -> std::shared_ptr<const BonePalette>
+{
+    return bone_palette;
+}
+
+void update_characters(ThreadPool &pool, const std::vector<std::shared_ptr<Character>> &characters, float delta_time)
+{
+    const size_t characters_per_task = 16;
+    pool.parallel_for(characters.size(), characters_per_task, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            characters[i]->update(delta_time);
+        }
+    });
+}
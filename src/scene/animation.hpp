@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../core/thread_pool.hpp"
+#include "skeleton.hpp"
+#include <array>
+#include <assimp/scene.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Unit quaternion in 48 bits using the smallest-three encoding: the largest component is dropped (its sign is
+// flipped positive) and rebuilt from the other three, which are stored as 15 bit fixed point. The index of the dropped
+// component lives in the top bit of the first two words.
+struct QuantizedQuat
+{
+    std::array<uint16_t, 3> packed;
+    static auto encode(glm::quat rotation) -> QuantizedQuat;
+    [[nodiscard]] auto decode() const -> glm::quat;
+};
+
+struct ClipCompression
+{
+    // Source channels are resampled at this rate before key reduction
+    float sample_rate = 30.0F;
+    // A key is dropped when interpolating its neighbours stays within these errors, radians for rotation and model
+    // units for translation and scale
+    float rotation_tolerance = 0.001F;
+    float translation_tolerance = 0.0005F;
+    float scale_tolerance = 0.0005F;
+};
+
+// Looping animation with rotations quantised to QuantizedQuat and redundant keys removed. Key times are frame numbers
+// at the clip's sample rate and every track is packed into shared arrays, so a clip is a handful of allocations no
+// matter how many joints it animates.
+class AnimationClip
+{
+  public:
+    AnimationClip(const aiAnimation &animation, const Skeleton &skeleton, const ClipCompression &compression = {});
+    [[nodiscard]] auto name() const -> const std::string &;
+    [[nodiscard]] auto duration() const -> float;
+    [[nodiscard]] auto memory_usage() const -> size_t;
+    // Writes the pose at time in seconds (wrapped to the clip) into out, joints without a track keep the bind pose
+    void sample(float time, const Skeleton &skeleton, Pose &out) const;
+
+  private:
+    struct Track
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+    template <typename Key> struct Channel
+    {
+        std::vector<Track> tracks;
+        std::vector<uint16_t> frames;
+        std::vector<Key> keys;
+    };
+    std::string clip_name;
+    float sample_rate;
+    float frame_count;
+    Channel<QuantizedQuat> rotations;
+    Channel<glm::vec3> translations;
+    Channel<glm::vec3> scales;
+};
+
+// One animated instance of a skeleton. Everything update() touches is owned by the character, so different characters
+// can be updated on different threads.
+class Character
+{
+  public:
+    explicit Character(std::shared_ptr<const Skeleton> skeleton);
+    // Switches to clip, cross-fading from the current clip over fade_time seconds
+    void play(std::shared_ptr<const AnimationClip> clip, float fade_time = 0.0F);
+    void set_speed(float speed);
+    void update(float delta_time);
+    // Skinning matrices for the mesh bones, refreshed in place by update()
+    [[nodiscard]] auto palette() const -> std::shared_ptr<const BonePalette>;
+
+  private:
+    std::shared_ptr<const Skeleton> skeleton;
+    std::shared_ptr<const AnimationClip> current;
+    std::shared_ptr<const AnimationClip> previous;
+    float current_time{};
+    float previous_time{};
+    float fade_elapsed{};
+    float fade_duration{};
+    float speed{1.0F};
+    Pose current_pose;
+    Pose previous_pose;
+    Pose blended_pose;
+    std::vector<glm::mat4> globals;
+    std::shared_ptr<BonePalette> bone_palette;
+};
+
+// Samples, blends and skins every character, spread across the pool
+void update_characters(ThreadPool &pool, const std::vector<std::shared_ptr<Character>> &characters, float delta_time);
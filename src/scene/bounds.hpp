@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct Bounds
+{
+    glm::vec3 min{0.0F};
+    glm::vec3 max{0.0F};
+};
+
+// Axis aligned box enclosing bounds after transform
+inline auto transform_bounds(const Bounds &bounds, const glm::mat4 &transform) -> Bounds
+{
+    // Each output axis takes the smaller and larger contribution of every input axis separately (Arvo's method)
+    Bounds result{glm::vec3(transform[3]), glm::vec3(transform[3])};
+    for (int col = 0; col < 3; col++)
+    {
+        const glm::vec3 axis = glm::vec3(transform[col]);
+        const glm::vec3 from_min = axis * bounds.min[col];
+        const glm::vec3 from_max = axis * bounds.max[col];
+        result.min += glm::min(from_min, from_max);
+        result.max += glm::max(from_min, from_max);
+    }
+    return result;
+}
@@ -1,5 +1,6 @@
 #include "camera.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 #include <glm/trigonometric.hpp>
 
 Camera::Camera(glm::vec3 position, glm::quat rotation, float fov, float aspect_ratio, float clip_near, float clip_far)
@@ -13,6 +14,27 @@ auto Camera::pos() -> glm::vec3
     return position;
 }
 
+auto Camera::projected_size(glm::vec3 centre, float radius) -> float
+{
+    const float distance = glm::length(centre - position);
+    if (distance <= radius)
+    {
+        return 1.0F;
+    }
+    return radius / (distance * std::tan(glm::radians(fov) / 2.0F));
+}
+
+auto Camera::ray(glm::vec2 ndc) -> Ray
+{
+    const glm::mat4 inverse = glm::inverse(projection_mat());
+    const glm::vec4 near = inverse * glm::vec4(ndc, -1.0F, 1.0F);
+    const glm::vec4 far = inverse * glm::vec4(ndc, 1.0F, 1.0F);
+    const glm::vec3 origin = glm::vec3(near) / near.w;
+    const glm::vec3 to_far = glm::vec3(far) / far.w - origin;
+    const float length = glm::length(to_far);
+    return {origin, to_far / length, 0.0F, length};
+}
+
 void Camera::set_position(glm::vec3 pos)
 {
     this->position = pos;
@@ -1,4 +1,5 @@
 #pragma once
+#include "mesh_bvh.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
@@ -8,6 +9,10 @@ class Camera
     Camera(glm::vec3 position, glm::quat rotation, float fov, float aspect_ratio, float clip_near, float clip_far);
     auto projection_mat() -> glm::mat4;
     auto pos() -> glm::vec3;
+    // Fraction of the screen height covered by a sphere
+    auto projected_size(glm::vec3 centre, float radius) -> float;
+    // World space ray from the near plane through a point in NDC, with a unit direction so t is a distance
+    auto ray(glm::vec2 ndc) -> Ray;
     void set_position(glm::vec3 position);
     void set_rotation(glm::quat rotation);
     void set_fov(float fov);
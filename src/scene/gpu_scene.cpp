@@ -0,0 +1,527 @@
+#include "gpu_scene.hpp"
+#include "../capture/frame_capture.hpp"
+#include "../shader/shader.hpp"
+#include "gpu_cull_source.h"
+#include "gpu_scene_fragment_source.h"
+#include "gpu_scene_vertex_source.h"
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+const GLuint cull_group_size = 64;
+const GLuint instance_attribute = 6;
+
+struct DrawArraysIndirectCommand
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first;
+    GLuint base_instance;
+};
+
+void vertex_attribute(GLuint location, GLint size, size_t offset)
+{
+    glVertexAttribPointer(
+        location,
+        size,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(GpuSceneVertex),
+        reinterpret_cast<void *>(offset) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    );
+    glEnableVertexAttribArray(location);
+}
+
+// The attributes vertex_attribute() sets up, as a capture records them
+auto gpu_scene_layout() -> std::vector<VertexAttributeLayout>
+{
+    const auto attribute = [](uint32_t location, int32_t size, size_t offset) {
+        return VertexAttributeLayout{location, size, GL_FLOAT, static_cast<uint32_t>(offset), GL_FALSE, GL_FALSE};
+    };
+    return {
+        attribute(0, 3, offsetof(GpuSceneVertex, position)),
+        attribute(1, 4, offsetof(GpuSceneVertex, colour)),
+        attribute(3, 3, offsetof(GpuSceneVertex, normal)),
+    };
+}
+
+// Writes slot ids 0..capacity-1 into buffer, read back per draw through the base instance
+void fill_slot_ids(GLuint buffer, size_t capacity)
+{
+    std::vector<uint32_t> ids(capacity);
+    std::iota(ids.begin(), ids.end(), 0U);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ids.size() * sizeof(uint32_t)), ids.data(), GL_STATIC_DRAW);
+}
+} // namespace
+
+auto GpuScene::supported() -> bool
+{
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+GpuScene::GpuScene(size_t vertex_capacity, size_t instance_capacity)
+    : draw_program(link_program(GPU_SCENE_VERTEX_SOURCE, GPU_SCENE_FRAGMENT_SOURCE)),
+      cull_program(link_compute_program(GPU_CULL_SOURCE)), vertex_capacity(vertex_capacity),
+      indirect_count(GLAD_GL_VERSION_4_6 != 0),
+      projection_location(glGetUniformLocation(draw_program, "projection_mat")),
+      light_pos_location(glGetUniformLocation(draw_program, "light_pos")),
+      light_colour_location(glGetUniformLocation(draw_program, "light_colour")),
+      intensities_location(glGetUniformLocation(draw_program, "intensities")),
+      view_pos_location(glGetUniformLocation(draw_program, "view_pos")),
+      frustum_location(glGetUniformLocation(cull_program, "frustum_planes")),
+      camera_pos_location(glGetUniformLocation(cull_program, "camera_pos")),
+      lod_distance_location(glGetUniformLocation(cull_program, "lod_distance")),
+      slot_count_location(glGetUniformLocation(cull_program, "slot_count")),
+      compact_location(glGetUniformLocation(cull_program, "compact")),
+      capture_uniforms(capture_shader.get_uniforms())
+{
+    glGenVertexArrays(1, &vertex_array);
+    glBindVertexArray(vertex_array);
+    glGenBuffers(1, &vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBufferData(
+        GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertex_capacity * sizeof(GpuSceneVertex)), nullptr, GL_STATIC_DRAW
+    );
+    vertex_attribute(0, 3, offsetof(GpuSceneVertex, position));
+    vertex_attribute(1, 4, offsetof(GpuSceneVertex, colour));
+    vertex_attribute(3, 3, offsetof(GpuSceneVertex, normal));
+    free_ranges[0] = static_cast<uint32_t>(vertex_capacity);
+
+    slot_capacity = instance_capacity;
+    glGenBuffers(1, &slot_buffer);
+    fill_slot_ids(slot_buffer, slot_capacity);
+    glVertexAttribIPointer(instance_attribute, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+    glVertexAttribDivisor(instance_attribute, 1);
+    glEnableVertexAttribArray(instance_attribute);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    command_capacity = instance_capacity;
+    glGenBuffers(1, &command_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(command_capacity * sizeof(DrawArraysIndirectCommand)),
+        nullptr, GL_DYNAMIC_DRAW
+    );
+    glGenBuffers(1, &count_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, count_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &meshes.buffer);
+    glGenBuffers(1, &instances.buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+GpuScene::~GpuScene()
+{
+    const std::array<GLuint, 6> buffers = {
+        vertex_buffer, slot_buffer, command_buffer, count_buffer, meshes.buffer, instances.buffer,
+    };
+    glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+    glDeleteVertexArrays(1, &vertex_array);
+    glDeleteVertexArrays(static_cast<GLsizei>(capture_vertex_arrays.size()), capture_vertex_arrays.data());
+    glDeleteProgram(draw_program);
+    glDeleteProgram(cull_program);
+}
+
+auto GpuScene::add_mesh(const std::vector<std::vector<GpuSceneVertex>> &lods) -> uint32_t
+{
+    if (lods.empty() || lods.size() > max_lods)
+    {
+        throw std::invalid_argument("GpuScene meshes need between 1 and 4 levels of detail");
+    }
+    // Checked up front so a bad level doesn't leave the ones before it allocated
+    for (const auto &lod : lods)
+    {
+        if (lod.empty())
+        {
+            throw std::invalid_argument("GpuScene mesh level of detail has no vertices");
+        }
+    }
+    MeshRecord record{};
+    Bounds bounds{lods[0][0].position, lods[0][0].position};
+    for (const auto &vertex : lods[0])
+    {
+        bounds.min = glm::min(bounds.min, vertex.position);
+        bounds.max = glm::max(bounds.max, vertex.position);
+    }
+    record.bounds_min = glm::vec4(bounds.min, 0.0F);
+    record.bounds_max = glm::vec4(bounds.max, 0.0F);
+    for (size_t lod = 0; lod < lods.size(); lod++)
+    {
+        const auto count = static_cast<uint32_t>(lods[lod].size());
+        const uint32_t first = allocate_vertices(count);
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+        glBufferSubData(
+            GL_ARRAY_BUFFER, static_cast<GLintptr>(first * sizeof(GpuSceneVertex)),
+            static_cast<GLsizeiptr>(count * sizeof(GpuSceneVertex)), lods[lod].data()
+        );
+        record.lod_first.at(lod) = first;
+        record.lod_count.at(lod) = count;
+        used_vertices += count;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    capture_vertices_changed = true;
+
+    const uint32_t mesh = meshes.allocate();
+    meshes.records[mesh] = record;
+    meshes.mark(mesh);
+    live_meshes++;
+    return mesh;
+}
+
+void GpuScene::remove_mesh(uint32_t mesh)
+{
+    MeshRecord &record = meshes.records.at(mesh);
+    for (size_t lod = 0; lod < max_lods; lod++)
+    {
+        if (record.lod_count.at(lod) > 0)
+        {
+            free_vertices(record.lod_first.at(lod), record.lod_count.at(lod));
+            used_vertices -= record.lod_count.at(lod);
+        }
+    }
+    record = {};
+    meshes.mark(mesh);
+    meshes.free_slots.push_back(mesh);
+    live_meshes--;
+}
+
+auto GpuScene::add_instance(uint32_t mesh, const glm::mat4 &transform, const MaterialValues &material) -> uint32_t
+{
+    if (mesh >= meshes.records.size() || meshes.records[mesh].lod_count[0] == 0)
+    {
+        throw std::out_of_range("GpuScene instance of a missing mesh");
+    }
+    const uint32_t instance = instances.allocate();
+    instances.records[instance] = {
+        transform,
+        glm::vec4(material.ambient, material.shininess),
+        glm::vec4(material.diffuse, 0.0F),
+        glm::vec4(material.specular, 0.0F),
+        {mesh, 1, 0, 0},
+    };
+    instances.mark(instance);
+    live_instances++;
+    return instance;
+}
+
+void GpuScene::remove_instance(uint32_t instance)
+{
+    // The slot stays in the buffer as a dead record until it's reused
+    instances.records.at(instance).mesh = {0, 0, 0, 0};
+    instances.mark(instance);
+    instances.free_slots.push_back(instance);
+    live_instances--;
+}
+
+void GpuScene::set_instance_transform(uint32_t instance, const glm::mat4 &transform)
+{
+    instances.records.at(instance).transform = transform;
+    instances.mark(instance);
+}
+
+void GpuScene::set_lod_distance(float distance)
+{
+    lod_distance = distance;
+}
+
+void GpuScene::draw(Camera &camera, Light &light)
+{
+    const size_t slots = instances.records.size();
+    if (live_instances == 0)
+    {
+        return;
+    }
+    // Frustum planes straight from the combined matrix (Gribb and Hartmann), pointing inwards
+    const glm::mat4 projection = camera.projection_mat();
+    std::array<glm::vec4, 6> planes{};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const glm::vec4 row{projection[0][axis], projection[1][axis], projection[2][axis], projection[3][axis]};
+        const glm::vec4 w_row{projection[0][3], projection[1][3], projection[2][3], projection[3][3]};
+        planes.at(static_cast<size_t>(axis) * 2) = w_row + row;
+        planes.at(static_cast<size_t>(axis) * 2 + 1) = w_row - row;
+    }
+    if (auto *capture = FrameCapture::current())
+    {
+        draw_captured(camera, light, *capture, planes);
+        return;
+    }
+    if (!capture_vertex_arrays.empty())
+    {
+        glDeleteVertexArrays(static_cast<GLsizei>(capture_vertex_arrays.size()), capture_vertex_arrays.data());
+        capture_vertex_arrays.clear();
+    }
+    meshes.upload();
+    instances.upload();
+    if (slots > slot_capacity)
+    {
+        slot_capacity = std::max(slots, slot_capacity * 2);
+        fill_slot_ids(slot_buffer, slot_capacity);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if (slots > command_capacity)
+    {
+        command_capacity = std::max(slots, command_capacity * 2);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer);
+        glBufferData(
+            GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(command_capacity * sizeof(DrawArraysIndirectCommand)),
+            nullptr, GL_DYNAMIC_DRAW
+        );
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, meshes.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instances.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, command_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, count_buffer);
+    if (indirect_count)
+    {
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, count_buffer);
+        glClearBufferSubData(
+            GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero
+        );
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    glUseProgram(cull_program);
+    glUniform4fv(frustum_location, static_cast<GLsizei>(planes.size()), &planes[0][0]);
+    const glm::vec3 camera_pos = camera.pos();
+    glUniform3f(camera_pos_location, camera_pos.x, camera_pos.y, camera_pos.z);
+    glUniform1f(lod_distance_location, lod_distance);
+    glUniform1ui(slot_count_location, static_cast<GLuint>(slots));
+    glUniform1i(compact_location, indirect_count ? 1 : 0);
+    glDispatchCompute(static_cast<GLuint>((slots + cull_group_size - 1) / cull_group_size), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(draw_program);
+    glUniformMatrix4fv(projection_location, 1, GL_FALSE, &projection[0][0]);
+    const glm::vec3 light_pos = light.pos();
+    const glm::vec3 light_colour = light.colour();
+    const glm::vec3 intensities = light.intensities();
+    glUniform3f(light_pos_location, light_pos.x, light_pos.y, light_pos.z);
+    glUniform3f(light_colour_location, light_colour.x, light_colour.y, light_colour.z);
+    glUniform3f(intensities_location, intensities.x, intensities.y, intensities.z);
+    glUniform3f(view_pos_location, camera_pos.x, camera_pos.y, camera_pos.z);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+    if (indirect_count)
+    {
+        glBindBuffer(GL_PARAMETER_BUFFER, count_buffer);
+        glMultiDrawArraysIndirectCount(GL_TRIANGLES, nullptr, 0, static_cast<GLsizei>(slots), 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, static_cast<GLsizei>(slots), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GpuScene::draw_captured(
+    Camera &camera, Light &light, FrameCapture &capture, const std::array<glm::vec4, 6> &planes
+)
+{
+    // The same culling and level of detail choice as gpu_cull.comp
+    const glm::vec3 camera_pos = camera.pos();
+    const GLuint array = capture_vertex_array();
+    capture_shader.use();
+    glBindVertexArray(array);
+    capture.record_mesh(array, vertex_buffer, sizeof(GpuSceneVertex), gpu_scene_layout());
+    capture_uniforms.projection_mat.set(camera.projection_mat());
+    capture_uniforms.light_pos.set(light.pos());
+    capture_uniforms.light_colour.set(light.colour());
+    capture_uniforms.intensities.set(light.intensities());
+    capture_uniforms.view_pos.set(camera_pos);
+    for (const InstanceRecord &instance : instances.records)
+    {
+        if (instance.mesh[1] == 0)
+        {
+            continue;
+        }
+        const MeshRecord &mesh = meshes.records[instance.mesh[0]];
+        const Bounds bounds =
+            transform_bounds({glm::vec3(mesh.bounds_min), glm::vec3(mesh.bounds_max)}, instance.transform);
+        bool visible = true;
+        for (size_t plane = 0; plane < planes.size() && visible; plane++)
+        {
+            // The corner furthest along the plane normal
+            glm::vec3 corner = bounds.min;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (planes.at(plane)[axis] >= 0.0F)
+                {
+                    corner[axis] = bounds.max[axis];
+                }
+            }
+            visible = glm::dot(glm::vec3(planes.at(plane)), corner) + planes.at(plane).w >= 0.0F;
+        }
+        if (!visible)
+        {
+            continue;
+        }
+        const float distance =
+            glm::length(glm::max(glm::max(bounds.min - camera_pos, camera_pos - bounds.max), glm::vec3(0.0F)));
+        size_t lod = 0;
+        while (lod + 1 < max_lods && mesh.lod_count.at(lod + 1) != 0 &&
+               distance > lod_distance * static_cast<float>(1U << lod))
+        {
+            lod++;
+        }
+        capture_uniforms.transform_mat.set(instance.transform);
+        capture_uniforms.material.ambient.set(glm::vec3(instance.ambient_shininess));
+        capture_uniforms.material.diffuse.set(glm::vec3(instance.diffuse));
+        capture_uniforms.material.specular.set(glm::vec3(instance.specular));
+        capture_uniforms.material.shininess.set(instance.ambient_shininess.w);
+        const auto first = static_cast<GLint>(mesh.lod_first.at(lod));
+        const auto count = static_cast<GLsizei>(mesh.lod_count.at(lod));
+        glDrawArrays(GL_TRIANGLES, first, count);
+        capture.record_draw(first, count);
+    }
+    glBindVertexArray(0);
+}
+
+auto GpuScene::capture_vertex_array() -> GLuint
+{
+    if (capture_vertices_changed || capture_vertex_arrays.empty())
+    {
+        GLuint array = 0;
+        glGenVertexArrays(1, &array);
+        glBindVertexArray(array);
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+        vertex_attribute(0, 3, offsetof(GpuSceneVertex, position));
+        vertex_attribute(1, 4, offsetof(GpuSceneVertex, colour));
+        vertex_attribute(3, 3, offsetof(GpuSceneVertex, normal));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        capture_vertex_arrays.push_back(array);
+        capture_vertices_changed = false;
+    }
+    return capture_vertex_arrays.back();
+}
+
+auto GpuScene::stats() const -> GpuSceneStats
+{
+    return {live_meshes, live_instances, used_vertices * sizeof(GpuSceneVertex), indirect_count};
+}
+
+auto GpuScene::allocate_vertices(uint32_t count) -> uint32_t
+{
+    // First fit, growing the buffer when nothing is large enough
+    auto found = std::find_if(free_ranges.begin(), free_ranges.end(), [&](const auto &range) {
+        return range.second >= count;
+    });
+    if (found == free_ranges.end())
+    {
+        grow_vertices(std::max(vertex_capacity * 2, vertex_capacity + count));
+        return allocate_vertices(count);
+    }
+    const uint32_t first = found->first;
+    const uint32_t remaining = found->second - count;
+    free_ranges.erase(found);
+    if (remaining > 0)
+    {
+        free_ranges[first + count] = remaining;
+    }
+    return first;
+}
+
+void GpuScene::free_vertices(uint32_t first, uint32_t count)
+{
+    auto inserted = free_ranges.emplace(first, count).first;
+    auto next = std::next(inserted);
+    if (next != free_ranges.end() && inserted->first + inserted->second == next->first)
+    {
+        inserted->second += next->second;
+        free_ranges.erase(next);
+    }
+    if (inserted != free_ranges.begin())
+    {
+        auto previous = std::prev(inserted);
+        if (previous->first + previous->second == inserted->first)
+        {
+            previous->second += inserted->second;
+            free_ranges.erase(inserted);
+        }
+    }
+}
+
+void GpuScene::grow_vertices(size_t capacity)
+{
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(
+        GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity * sizeof(GpuSceneVertex)), nullptr, GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_COPY_READ_BUFFER, vertex_buffer);
+    glCopyBufferSubData(
+        GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+        static_cast<GLsizeiptr>(vertex_capacity * sizeof(GpuSceneVertex))
+    );
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &vertex_buffer);
+    vertex_buffer = grown;
+    capture_vertices_changed = true;
+
+    // The vertex array still points at the old buffer
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    vertex_attribute(0, 3, offsetof(GpuSceneVertex, position));
+    vertex_attribute(1, 4, offsetof(GpuSceneVertex, colour));
+    vertex_attribute(3, 3, offsetof(GpuSceneVertex, normal));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    free_vertices(static_cast<uint32_t>(vertex_capacity), static_cast<uint32_t>(capacity - vertex_capacity));
+    vertex_capacity = capacity;
+}
+
+template <typename Record> void GpuScene::MirroredBuffer<Record>::mark(size_t slot)
+{
+    dirty_first = std::min(dirty_first, slot);
+    dirty_last = std::max(dirty_last, slot + 1);
+}
+
+template <typename Record> auto GpuScene::MirroredBuffer<Record>::allocate() -> uint32_t
+{
+    if (!free_slots.empty())
+    {
+        const uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+    records.emplace_back();
+    return static_cast<uint32_t>(records.size() - 1);
+}
+
+template <typename Record> void GpuScene::MirroredBuffer<Record>::upload()
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    if (records.size() > capacity)
+    {
+        // Reallocating loses the old contents, so everything goes up again
+        capacity = std::max(records.size(), capacity * 2);
+        glBufferData(
+            GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity * sizeof(Record)), nullptr, GL_DYNAMIC_DRAW
+        );
+        dirty_first = 0;
+        dirty_last = records.size();
+    }
+    if (dirty_first < dirty_last)
+    {
+        glBufferSubData(
+            GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(dirty_first * sizeof(Record)),
+            static_cast<GLsizeiptr>((dirty_last - dirty_first) * sizeof(Record)), &records[dirty_first]
+        );
+    }
+    dirty_first = SIZE_MAX;
+    dirty_last = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
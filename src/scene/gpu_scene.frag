@@ -0,0 +1,36 @@
+#version 430 core
+// Same lighting as shader.frag with VERTEX_COLOUR and LIGHTING, the material coming from the instance record
+in vec4 vertex_colour;
+in vec3 normal;
+in vec3 frag_pos;
+flat in uint instance_slot;
+
+struct InstanceRecord {
+    mat4 transform;
+    vec4 ambient_shininess;
+    vec4 diffuse;
+    vec4 specular;
+    uvec4 mesh;
+};
+layout(std430, binding = 1) readonly buffer Instances { InstanceRecord instances[]; };
+
+uniform vec3 light_pos;
+uniform vec3 light_colour;
+uniform vec3 intensities;
+uniform vec3 view_pos;
+
+out vec4 frag_colour;
+
+void main() {
+    InstanceRecord instance = instances[instance_slot];
+    vec3 light_dir = normalize(light_pos - frag_pos);
+    float light_attenuation = 0.0001f * length(light_pos - frag_pos) + 1.0f;
+    vec4 ambient_colour = vec4(instance.ambient_shininess.xyz, 1.0f) * intensities.x;
+    float diffuse = max(dot(normalize(normal), light_dir), 0.0) / light_attenuation;
+    vec4 diffuse_colour = diffuse * intensities.y * vec4(instance.diffuse.xyz, 1.0f);
+    vec3 view_dir = normalize(view_pos - frag_pos);
+    vec3 reflect_dir = reflect(-light_dir, normalize(normal));
+    float spec = pow(max(dot(view_dir, reflect_dir), 0.0), instance.ambient_shininess.w) / light_attenuation;
+    vec4 specular_colour = vec4(spec * intensities.z * instance.specular.xyz, 1.0f);
+    frag_colour = vertex_colour * vec4(light_colour, 1.0f) * (ambient_colour + diffuse_colour + specular_colour);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "camera.hpp"
+#include "light.hpp"
+#include "mesh.hpp"
+#include "node.hpp"
+#include <array>
+#include <cstdint>
+#include <glad/glad.h>
+#include <map>
+#include <vector>
+
+// Vertex format of everything drawn by the GPU driven path, vertex coloured and lit
+using GpuSceneVertex = VertexAttributes<true, true, 0>;
+
+struct GpuSceneStats
+{
+    size_t meshes;
+    size_t instances;
+    size_t vertex_bytes;
+    // Whether draws are compacted and counted on the GPU, otherwise culled slots draw nothing
+    bool indirect_count;
+};
+
+// GPU driven renderer for lit, vertex coloured instances. Meshes share one vertex buffer and instances live in
+// shader storage buffers, each frame a compute shader frustum culls every instance, picks its level of detail and
+// writes the indirect draws, which go out in a single multi-draw. The CPU cost of draw() doesn't depend on how many
+// instances there are. Needs GL 4.3, see supported(); meshes are non-indexed so draws are DrawArraysIndirectCommands.
+// Only WorldStreamer puts chunks in here, nodes added to a Scene directly are still drawn one by one. Frames being
+// captured are culled on the CPU instead and drawn an instance at a time through the uber shader, which lights the
+// same way and whose draws the capture can record.
+class GpuScene
+{
+  public:
+    static const size_t max_lods = 4;
+    // Whether the current context can run this path, call after loading GL
+    static auto supported() -> bool;
+    explicit GpuScene(size_t vertex_capacity = size_t{1} << 20U, size_t instance_capacity = size_t{1} << 14U);
+    GpuScene(const GpuScene &) = delete;
+    GpuScene(GpuScene &&) = delete;
+    auto operator=(const GpuScene &) -> GpuScene & = delete;
+    auto operator=(GpuScene &&) -> GpuScene & = delete;
+    ~GpuScene();
+    // Levels of detail run from full detail to coarsest, at most max_lods. Returns the mesh id.
+    auto add_mesh(const std::vector<std::vector<GpuSceneVertex>> &lods) -> uint32_t;
+    // The mesh must have no instances left
+    void remove_mesh(uint32_t mesh);
+    auto add_instance(uint32_t mesh, const glm::mat4 &transform, const MaterialValues &material) -> uint32_t;
+    void remove_instance(uint32_t instance);
+    void set_instance_transform(uint32_t instance, const glm::mat4 &transform);
+    // Level n + 1 is drawn beyond lod_distance * 2^n
+    void set_lod_distance(float distance);
+    void draw(Camera &camera, Light &light);
+    [[nodiscard]] auto stats() const -> GpuSceneStats;
+
+  private:
+    // Mirrors the std430 structs in gpu_cull.comp
+    struct MeshRecord
+    {
+        glm::vec4 bounds_min;
+        glm::vec4 bounds_max;
+        std::array<uint32_t, max_lods> lod_first;
+        std::array<uint32_t, max_lods> lod_count;
+    };
+    struct InstanceRecord
+    {
+        glm::mat4 transform;
+        glm::vec4 ambient_shininess;
+        glm::vec4 diffuse;
+        glm::vec4 specular;
+        std::array<uint32_t, 4> mesh;
+    };
+    static_assert(sizeof(MeshRecord) == 64 && sizeof(InstanceRecord) == 128, "Records must match std430 layout");
+    // Record arrays mirrored in a shader storage buffer, uploading the changed range before each draw
+    template <typename Record> struct MirroredBuffer
+    {
+        GLuint buffer{};
+        std::vector<Record> records;
+        std::vector<uint32_t> free_slots;
+        size_t capacity{};
+        size_t dirty_first{SIZE_MAX};
+        size_t dirty_last{};
+        void mark(size_t slot);
+        auto allocate() -> uint32_t;
+        void upload();
+    };
+    auto allocate_vertices(uint32_t count) -> uint32_t;
+    void free_vertices(uint32_t first, uint32_t count);
+    void grow_vertices(size_t capacity);
+    using CaptureShader = ShaderProgram<false, true, true, 0>;
+    void draw_captured(Camera &camera, Light &light, FrameCapture &capture, const std::array<glm::vec4, 6> &planes);
+    // A vertex array over the vertex buffer as it is now, see capture_vertex_arrays
+    auto capture_vertex_array() -> GLuint;
+    GLuint draw_program;
+    GLuint cull_program;
+    GLuint vertex_array{};
+    GLuint vertex_buffer{};
+    GLuint slot_buffer{};
+    GLuint command_buffer{};
+    GLuint count_buffer{};
+    size_t vertex_capacity;
+    size_t slot_capacity{};
+    size_t command_capacity{};
+    // Free vertex ranges by first vertex, adjacent ranges are merged
+    std::map<uint32_t, uint32_t> free_ranges;
+    MirroredBuffer<MeshRecord> meshes;
+    MirroredBuffer<InstanceRecord> instances;
+    size_t live_meshes{};
+    size_t live_instances{};
+    size_t used_vertices{};
+    bool indirect_count;
+    float lod_distance{100.0F};
+    GLint projection_location;
+    GLint light_pos_location;
+    GLint light_colour_location;
+    GLint intensities_location;
+    GLint view_pos_location;
+    GLint frustum_location;
+    GLint camera_pos_location;
+    GLint lod_distance_location;
+    GLint slot_count_location;
+    GLint compact_location;
+    CaptureShader capture_shader;
+    CaptureShader::Uniforms capture_uniforms;
+    // A capture reads a vertex array's buffer back the first time it's drawn, so each change to the vertices gets a
+    // new array. They're only deleted once the capture ends, keeping their names unique within it.
+    std::vector<GLuint> capture_vertex_arrays;
+    bool capture_vertices_changed{true};
+};
@@ -0,0 +1,32 @@
+#version 430 core
+// Vertex shader of the GPU driven path. Every draw is one instance whose base instance is its slot, read back through
+// an instanced attribute since gl_BaseInstance needs GL 4.6.
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec4 aColour;
+layout(location = 3) in vec3 aNormals;
+layout(location = 6) in uint aInstance;
+
+struct InstanceRecord {
+    mat4 transform;
+    vec4 ambient_shininess;
+    vec4 diffuse;
+    vec4 specular;
+    uvec4 mesh;
+};
+layout(std430, binding = 1) readonly buffer Instances { InstanceRecord instances[]; };
+
+uniform mat4 projection_mat;
+
+out vec4 vertex_colour;
+out vec3 normal;
+out vec3 frag_pos;
+flat out uint instance_slot;
+
+void main() {
+    mat4 model_mat = instances[aInstance].transform;
+    gl_Position = projection_mat * model_mat * vec4(aPos, 1.0f);
+    vertex_colour = aColour;
+    normal = normalize(mat3(model_mat) * aNormals);
+    frag_pos = (model_mat * vec4(aPos, 1.0f)).xyz;
+    instance_slot = aInstance;
+}
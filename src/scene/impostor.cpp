@@ -0,0 +1,334 @@
+#include "impostor.hpp"
+#include "../backend/gl_program.hpp"
+#include "../capture/frame_capture.hpp"
+#include "impostor_bake_fragment_source.h"
+#include "impostor_bake_vertex_source.h"
+#include "impostor_fragment_source.h"
+#include "impostor_vertex_source.h"
+#include "node.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stdexcept>
+
+namespace
+{
+// Smallest a view gets in the atlas's mip chain, below this neighbouring views blur into each other
+const int min_mip_frame_size = 8;
+
+// Maps [-1, 1]^2 onto the upper hemisphere, with the pole at the centre and the horizon around the edge. Must match
+// impostor.vert.
+auto hemi_octahedral_direction(glm::vec2 uv) -> glm::vec3
+{
+    const float x = (uv.x + uv.y) * 0.5F;
+    const float z = (uv.x - uv.y) * 0.5F;
+    return glm::normalize(glm::vec3(x, 1.0F - std::abs(x) - std::abs(z), z));
+}
+
+// Up vector of the view along direction, must match impostor.vert
+auto frame_up(glm::vec3 direction) -> glm::vec3
+{
+    return std::abs(direction.y) > 0.999F ? glm::vec3(0.0F, 0.0F, -1.0F) : glm::vec3(0.0F, 1.0F, 0.0F);
+}
+
+auto checked_settings(const ImpostorSettings &settings) -> ImpostorSettings
+{
+    if (settings.frames < 2 || settings.frame_size < 1)
+    {
+        throw std::invalid_argument("Impostor needs at least 2x2 views of at least one pixel");
+    }
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    if (settings.frames * settings.frame_size > max_size)
+    {
+        throw std::invalid_argument("Impostor atlas larger than GL_MAX_TEXTURE_SIZE");
+    }
+    return settings;
+}
+
+auto bounding_radius(const Bounds &bounds) -> float
+{
+    const float radius = glm::length(bounds.max - bounds.min) / 2.0F;
+    if (!(radius > 0.0F))
+    {
+        throw std::invalid_argument("Impostor mesh has no extent");
+    }
+    return radius;
+}
+
+auto create_atlas(int side, int levels) -> GLuint
+{
+    GLuint texture{};
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (int level = 0; level <= levels; level++)
+    {
+        const int size = side >> level;
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void instance_attribute(GLuint location, size_t offset, size_t stride)
+{
+    glVertexAttribPointer(
+        location,
+        4,
+        GL_FLOAT,
+        GL_FALSE,
+        static_cast<GLsizei>(stride),
+        reinterpret_cast<void *>(offset) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    );
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
+}
+} // namespace
+
+auto Impostor::bake_defines(bool has_colour, bool has_normal) -> std::string
+{
+    std::string defines;
+    if (has_colour)
+    {
+        defines.append("#define VERTEX_COLOUR\n");
+    }
+    if (has_normal)
+    {
+        defines.append("#define LIGHTING\n");
+    }
+    return defines;
+}
+
+Impostor::Impostor(VirtualMesh &mesh, const std::string &defines, bool lit, ImpostorSettings settings)
+    : config(checked_settings(settings)), lit(lit), centre((mesh.bounds().min + mesh.bounds().max) / 2.0F),
+      radius(bounding_radius(mesh.bounds())),
+      draw_program(link_program(IMPOSTOR_VERTEX_SOURCE, IMPOSTOR_FRAGMENT_SOURCE)),
+      projection_location(glGetUniformLocation(draw_program, "projection_mat")),
+      view_pos_location(glGetUniformLocation(draw_program, "view_pos")),
+      centre_location(glGetUniformLocation(draw_program, "centre")),
+      radius_location(glGetUniformLocation(draw_program, "radius")),
+      frames_location(glGetUniformLocation(draw_program, "frames")),
+      lit_location(glGetUniformLocation(draw_program, "lit")),
+      colour_atlas_location(glGetUniformLocation(draw_program, "colour_atlas")),
+      normal_depth_atlas_location(glGetUniformLocation(draw_program, "normal_depth_atlas")),
+      light_pos_location(glGetUniformLocation(draw_program, "light_pos")),
+      light_colour_location(glGetUniformLocation(draw_program, "light_colour")),
+      intensities_location(glGetUniformLocation(draw_program, "intensities"))
+{
+    const int side = config.frames * config.frame_size;
+    int levels = 0;
+    while ((config.frame_size >> (levels + 1)) >= min_mip_frame_size)
+    {
+        levels++;
+    }
+    colour_atlas = create_atlas(side, levels);
+    normal_depth_atlas = create_atlas(side, levels);
+    for (int level = 0; level <= levels; level++)
+    {
+        atlas_bytes += 2 * static_cast<size_t>(side >> level) * static_cast<size_t>(side >> level) * 4;
+    }
+
+    // The quad's corners come from the vertex index, only the instance records are attributes
+    glGenVertexArrays(1, &vertex_array);
+    glGenBuffers(1, &instance_buffer);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    const size_t stride = sizeof(InstanceRecord);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        instance_attribute(column, offsetof(InstanceRecord, transform) + column * sizeof(glm::vec4), stride);
+    }
+    instance_attribute(4, offsetof(InstanceRecord, ambient_shininess), stride);
+    instance_attribute(5, offsetof(InstanceRecord, diffuse), stride);
+    instance_attribute(6, offsetof(InstanceRecord, specular_fade), stride);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    bake(mesh, defines);
+}
+
+Impostor::~Impostor()
+{
+    glDeleteVertexArrays(1, &vertex_array);
+    glDeleteBuffers(1, &instance_buffer);
+    glDeleteTextures(1, &colour_atlas);
+    glDeleteTextures(1, &normal_depth_atlas);
+    glDeleteProgram(draw_program);
+}
+
+void Impostor::bake(VirtualMesh &mesh, const std::string &defines)
+{
+    const int side = config.frames * config.frame_size;
+    const GLuint program =
+        link_program_with_defines(IMPOSTOR_BAKE_VERTEX_SOURCE, IMPOSTOR_BAKE_FRAGMENT_SOURCE, defines);
+    const GLint view_location = glGetUniformLocation(program, "view_mat");
+
+    GLuint fbo{};
+    GLuint depth{};
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, side, side);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour_atlas, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal_depth_atlas, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    const std::array<GLenum, 2> attachments{GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(static_cast<GLsizei>(attachments.size()), attachments.data());
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    if (complete)
+    {
+        // Views are filled triangles with depth testing whatever the scene is set up for
+        std::array<GLint, 4> viewport{};
+        std::array<GLint, 2> polygon_mode{};
+        std::array<GLfloat, 4> clear_colour{};
+        glGetIntegerv(GL_VIEWPORT, viewport.data());
+        glGetIntegerv(GL_POLYGON_MODE, polygon_mode.data());
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_colour.data());
+        const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glEnable(GL_DEPTH_TEST);
+        glViewport(0, 0, side, side);
+        glClearColor(0.0F, 0.0F, 0.0F, 0.0F);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Each view is an orthographic projection of the bounding sphere, depth running over its diameter
+        const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0F * radius);
+        glUseProgram(program);
+        mesh.use();
+        const auto frames = static_cast<float>(config.frames);
+        for (int y = 0; y < config.frames; y++)
+        {
+            for (int x = 0; x < config.frames; x++)
+            {
+                const glm::vec2 cell(static_cast<float>(x), static_cast<float>(y));
+                const glm::vec3 direction = hemi_octahedral_direction((cell + 0.5F) / frames * 2.0F - 1.0F);
+                const glm::mat4 view_mat =
+                    projection * glm::lookAt(centre + direction * 2.0F * radius, centre, frame_up(direction));
+                glUniformMatrix4fv(view_location, 1, GL_FALSE, &view_mat[0][0]);
+                glViewport(x * config.frame_size, y * config.frame_size, config.frame_size, config.frame_size);
+                mesh.draw();
+            }
+        }
+        glBindVertexArray(0);
+
+        glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(polygon_mode[0]));
+        if (depth_test != GL_TRUE)
+        {
+            glDisable(GL_DEPTH_TEST);
+        }
+        glClearColor(clear_colour[0], clear_colour[1], clear_colour[2], clear_colour[3]);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteProgram(program);
+    if (!complete)
+    {
+        throw std::runtime_error("Impostor bake framebuffer incomplete");
+    }
+
+    for (const GLuint atlas : {colour_atlas, normal_depth_atlas})
+    {
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+auto Impostor::fade(float screen_size) const -> float
+{
+    const float band = config.screen_size * config.fade_band;
+    if (band <= 0.0F)
+    {
+        return screen_size <= config.screen_size ? 1.0F : 0.0F;
+    }
+    return std::clamp((config.screen_size + band - screen_size) / band, 0.0F, 1.0F);
+}
+
+void Impostor::queue(const glm::mat4 &transform, float fade, const MaterialValues *material)
+{
+    InstanceRecord record{transform, glm::vec4(0.0F), glm::vec4(0.0F), glm::vec4(0.0F, 0.0F, 0.0F, fade)};
+    if (material != nullptr)
+    {
+        record.ambient_shininess = glm::vec4(material->ambient, material->shininess);
+        record.diffuse = glm::vec4(material->diffuse, 0.0F);
+        record.specular_fade = glm::vec4(material->specular, fade);
+    }
+    pending.push_back(record);
+}
+
+void Impostor::draw(Camera &camera, Light &light)
+{
+    drawn = pending.size();
+    if (pending.empty())
+    {
+        return;
+    }
+    // Nodes don't queue while a frame is captured, anything else that did would replay without its copies
+    if (auto *capture = FrameCapture::current())
+    {
+        capture->record_unsupported("impostors");
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    if (pending.size() > instance_capacity)
+    {
+        instance_capacity = std::max(pending.size(), instance_capacity * 2);
+        glBufferData(
+            GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instance_capacity * sizeof(InstanceRecord)), nullptr,
+            GL_STREAM_DRAW
+        );
+    }
+    glBufferSubData(
+        GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(pending.size() * sizeof(InstanceRecord)), pending.data()
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const glm::mat4 projection = camera.projection_mat();
+    const glm::vec3 camera_pos = camera.pos();
+    const glm::vec3 light_pos = light.pos();
+    const glm::vec3 light_colour = light.colour();
+    const glm::vec3 intensities = light.intensities();
+    glUseProgram(draw_program);
+    glUniformMatrix4fv(projection_location, 1, GL_FALSE, &projection[0][0]);
+    glUniform3f(view_pos_location, camera_pos.x, camera_pos.y, camera_pos.z);
+    glUniform3f(centre_location, centre.x, centre.y, centre.z);
+    glUniform1f(radius_location, radius);
+    glUniform1f(frames_location, static_cast<float>(config.frames));
+    glUniform1i(lit_location, lit ? 1 : 0);
+    glUniform3f(light_pos_location, light_pos.x, light_pos.y, light_pos.z);
+    glUniform3f(light_colour_location, light_colour.x, light_colour.y, light_colour.z);
+    glUniform3f(intensities_location, intensities.x, intensities.y, intensities.z);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normal_depth_atlas);
+    glUniform1i(normal_depth_atlas_location, 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colour_atlas);
+    glUniform1i(colour_atlas_location, 0);
+    glBindVertexArray(vertex_array);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(pending.size()));
+    glBindVertexArray(0);
+    pending.clear();
+}
+
+auto Impostor::settings() const -> const ImpostorSettings &
+{
+    return config;
+}
+
+auto Impostor::stats() const -> ImpostorStats
+{
+    return {static_cast<size_t>(config.frames) * static_cast<size_t>(config.frames), atlas_bytes, drawn};
+}
@@ -0,0 +1,65 @@
+#version 330 core
+// Blends the three views picked in impostor.vert, then lights the result the same way as shader.frag
+in vec2 frame_uv[3];
+flat in vec2 frame_cell[3];
+flat in vec3 frame_weights;
+in vec3 frag_pos;
+flat in mat3 normal_mat;
+flat in float world_radius;
+flat in vec4 ambient_shininess;
+flat in vec3 diffuse;
+flat in vec4 specular_fade;
+
+uniform sampler2D colour_atlas;
+uniform sampler2D normal_depth_atlas;
+uniform float frames;
+uniform bool lit;
+uniform mat4 projection_mat;
+uniform vec3 light_pos;
+uniform vec3 light_colour;
+uniform vec3 intensities;
+uniform vec3 view_pos;
+
+out vec4 frag_colour;
+
+void main() {
+    // The complement of the dither in shader.frag, while a node fades each pixel shows its geometry or its impostor
+    float dither = fract(52.9829189f * fract(dot(gl_FragCoord.xy, vec2(0.06711056f, 0.00583715f))));
+    if (dither >= specular_fade.w) {
+        discard;
+    }
+    vec4 colour = vec4(0.0f);
+    vec4 normal_depth = vec4(0.0f);
+    for (int i = 0; i < 3; i++) {
+        // Clamped to the view's own tile so its neighbours never bleed in
+        vec2 uv = (frame_cell[i] + clamp(frame_uv[i], 0.0f, 1.0f)) / frames;
+        colour += texture(colour_atlas, uv) * frame_weights[i];
+        normal_depth += texture(normal_depth_atlas, uv) * frame_weights[i];
+    }
+    if (colour.a < 0.5f) {
+        discard;
+    }
+    // Texels no view covered are zero, dividing by coverage averages only the views that saw this point
+    colour.rgb /= colour.a;
+    normal_depth /= colour.a;
+
+    // Moves the quad's depth onto the surface the views saw, so impostors intersect other geometry properly
+    vec3 to_eye = normalize(view_pos - frag_pos);
+    vec3 surface = frag_pos + to_eye * world_radius * (1.0f - 2.0f * normal_depth.a);
+    vec4 clip = projection_mat * vec4(surface, 1.0f);
+    gl_FragDepth = clip.z / clip.w * 0.5f + 0.5f;
+
+    frag_colour = vec4(colour.rgb, 1.0f);
+    if (lit) {
+        vec3 normal = normalize(normal_mat * (normal_depth.xyz * 2.0f - 1.0f));
+        vec3 light_dir = normalize(light_pos - surface);
+        float light_attenuation = 0.0001f * length(light_pos - surface) + 1.0f;
+        vec4 ambient_colour = vec4(ambient_shininess.xyz, 1.0f) * intensities.x;
+        float diffuse_strength = max(dot(normal, light_dir), 0.0) / light_attenuation;
+        vec4 diffuse_colour = diffuse_strength * intensities.y * vec4(diffuse, 1.0f);
+        vec3 reflect_dir = reflect(-light_dir, normal);
+        float spec = pow(max(dot(to_eye, reflect_dir), 0.0), ambient_shininess.w) / light_attenuation;
+        vec4 specular_colour = vec4(spec * intensities.z * specular_fade.xyz, 1.0f);
+        frag_colour *= vec4(light_colour, 1.0f) * (ambient_colour + diffuse_colour + specular_colour);
+    }
+}
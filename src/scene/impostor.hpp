@@ -0,0 +1,103 @@
+#pragma once
+
+#include "camera.hpp"
+#include "light.hpp"
+#include "mesh.hpp"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+struct MaterialValues;
+
+struct ImpostorSettings
+{
+    // Views per side of the atlas, frames * frames views spread over the upper hemisphere
+    int frames{8};
+    // Pixels per side of each view
+    int frame_size{128};
+    // Fraction of the screen height at or below which a node is drawn only as its impostor, see
+    // Camera::projected_size
+    float screen_size{0.05F};
+    // Nodes up to screen_size * (1 + fade_band) cross-fade between their geometry and the impostor
+    float fade_band{0.5F};
+};
+
+struct ImpostorStats
+{
+    size_t views;
+    size_t atlas_bytes;
+    // Quads in the last draw
+    size_t instances;
+};
+
+struct empty_impostor
+{
+};
+
+// A mesh pre-rendered from a hemisphere of directions into an octahedral atlas of colour and normal/depth, standing in
+// for copies of it too small on screen to be worth their triangles. Nodes queue their far copies during the scene
+// draw and draw() puts every queued copy out as a camera facing quad in one instanced call, blending the three nearest
+// views and lighting them with each copy's material. Textures aren't baked, only vertex colour. The instanced call has
+// no frame capture command, so nodes skip their impostor while a frame is being captured.
+class Impostor
+{
+  public:
+    // Bakes the atlas straight away, so needs a current context. Leaves the default framebuffer bound.
+    template <bool has_colour, bool has_normal, size_t num_tex_coords>
+    explicit Impostor(Mesh<has_colour, has_normal, num_tex_coords> &mesh, ImpostorSettings settings = {})
+        : Impostor(mesh, bake_defines(has_colour, has_normal), has_normal, settings)
+    {
+        static_assert(num_tex_coords != 2, "Impostors bake vertex colour only, a textured mesh would lose its texture");
+    }
+    Impostor(const Impostor &) = delete;
+    Impostor(Impostor &&) = delete;
+    auto operator=(const Impostor &) -> Impostor & = delete;
+    auto operator=(Impostor &&) -> Impostor & = delete;
+    ~Impostor();
+    // How much of a node this size on screen is drawn as the impostor, 0 for geometry only and 1 for impostor only
+    [[nodiscard]] auto fade(float screen_size) const -> float;
+    // Adds a copy to the next draw, material is ignored by impostors of unlit meshes
+    void queue(const glm::mat4 &transform, float fade, const MaterialValues *material = nullptr);
+    // Draws and clears everything queued
+    void draw(Camera &camera, Light &light);
+    [[nodiscard]] auto settings() const -> const ImpostorSettings &;
+    [[nodiscard]] auto stats() const -> ImpostorStats;
+
+  private:
+    // Mirrors the per instance attributes in impostor.vert
+    struct InstanceRecord
+    {
+        glm::mat4 transform;
+        glm::vec4 ambient_shininess;
+        glm::vec4 diffuse;
+        glm::vec4 specular_fade;
+    };
+    static auto bake_defines(bool has_colour, bool has_normal) -> std::string;
+    Impostor(VirtualMesh &mesh, const std::string &defines, bool lit, ImpostorSettings settings);
+    void bake(VirtualMesh &mesh, const std::string &defines);
+    ImpostorSettings config;
+    bool lit;
+    glm::vec3 centre{};
+    float radius{};
+    GLuint colour_atlas{};
+    GLuint normal_depth_atlas{};
+    size_t atlas_bytes{};
+    GLuint draw_program;
+    GLuint vertex_array{};
+    GLuint instance_buffer{};
+    size_t instance_capacity{};
+    std::vector<InstanceRecord> pending;
+    size_t drawn{};
+    GLint projection_location;
+    GLint view_pos_location;
+    GLint centre_location;
+    GLint radius_location;
+    GLint frames_location;
+    GLint lit_location;
+    GLint colour_atlas_location;
+    GLint normal_depth_atlas_location;
+    GLint light_pos_location;
+    GLint light_colour_location;
+    GLint intensities_location;
+};
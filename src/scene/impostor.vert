@@ -0,0 +1,78 @@
+#version 330 core
+// One camera facing quad per instance, corners generated from the vertex index. The three atlas views nearest the
+// direction to the camera are picked per instance and each corner is projected into all three for impostor.frag to
+// blend, so turning around an impostor morphs between views instead of popping.
+layout(location = 0) in mat4 aTransform;
+layout(location = 4) in vec4 aAmbientShininess;
+layout(location = 5) in vec4 aDiffuse;
+layout(location = 6) in vec4 aSpecularFade;
+
+uniform mat4 projection_mat;
+uniform vec3 view_pos;
+// Object space bounding sphere the views were rendered around
+uniform vec3 centre;
+uniform float radius;
+uniform float frames;
+
+out vec2 frame_uv[3];
+flat out vec2 frame_cell[3];
+flat out vec3 frame_weights;
+out vec3 frag_pos;
+flat out mat3 normal_mat;
+flat out float world_radius;
+flat out vec4 ambient_shininess;
+flat out vec3 diffuse;
+flat out vec4 specular_fade;
+
+// These three must match impostor.cpp
+vec3 hemi_octahedral_direction(vec2 uv) {
+    float x = (uv.x + uv.y) * 0.5f;
+    float z = (uv.x - uv.y) * 0.5f;
+    return normalize(vec3(x, 1.0f - abs(x) - abs(z), z));
+}
+vec2 hemi_octahedral_coords(vec3 direction) {
+    // Views from below the horizon use the nearest views on it
+    direction.y = max(direction.y, 0.0f);
+    vec3 p = direction / max(abs(direction.x) + direction.y + abs(direction.z), 1e-6f);
+    return vec2(p.x + p.z, p.x - p.z);
+}
+vec3 frame_up(vec3 direction) {
+    return abs(direction.y) > 0.999f ? vec3(0.0f, 0.0f, -1.0f) : vec3(0.0f, 1.0f, 0.0f);
+}
+
+void main() {
+    vec3 eye = (inverse(aTransform) * vec4(view_pos, 1.0f)).xyz;
+    vec3 to_eye = normalize(eye - centre);
+    vec3 right = normalize(cross(frame_up(to_eye), to_eye));
+    vec3 up = cross(to_eye, right);
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0f - 1.0f;
+    vec3 position = centre + (right * corner.x + up * corner.y) * radius;
+
+    // Frame centres sit on integer grid positions, the cell's diagonal splits it into two triangles of views
+    vec2 grid = (hemi_octahedral_coords(to_eye) * 0.5f + 0.5f) * frames - 0.5f;
+    vec2 base = clamp(floor(grid), vec2(0.0f), vec2(frames - 2.0f));
+    vec2 f = clamp(grid - base, 0.0f, 1.0f);
+    vec2 middle = f.x > f.y ? vec2(1.0f, 0.0f) : vec2(0.0f, 1.0f);
+    frame_weights = f.x > f.y ? vec3(1.0f - f.x, f.x - f.y, f.y) : vec3(1.0f - f.y, f.y - f.x, f.x);
+    vec2 cells[3] = vec2[3](base, base + middle, base + vec2(1.0f));
+    vec3 ray = position - eye;
+    for (int i = 0; i < 3; i++) {
+        vec3 direction = hemi_octahedral_direction((cells[i] + 0.5f) / frames * 2.0f - 1.0f);
+        vec3 frame_right = normalize(cross(frame_up(direction), direction));
+        vec3 frame_upward = cross(direction, frame_right);
+        // Where the ray from the eye through this corner meets the plane the view was rendered onto
+        float along = dot(ray, direction);
+        float t = abs(along) > 1e-4f ? dot(centre - eye, direction) / along : 1.0f;
+        vec3 hit = eye + ray * t - centre;
+        frame_uv[i] = vec2(dot(hit, frame_right), dot(hit, frame_upward)) / (2.0f * radius) + 0.5f;
+        frame_cell[i] = cells[i];
+    }
+
+    frag_pos = (aTransform * vec4(position, 1.0f)).xyz;
+    normal_mat = mat3(aTransform);
+    world_radius = radius * max(length(aTransform[0].xyz), max(length(aTransform[1].xyz), length(aTransform[2].xyz)));
+    ambient_shininess = aAmbientShininess;
+    diffuse = aDiffuse.xyz;
+    specular_fade = aSpecularFade;
+    gl_Position = projection_mat * vec4(frag_pos, 1.0f);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+#define DEFINES
+#ifdef VERTEX_COLOUR
+in vec4 vertex_colour;
+#endif
+#ifdef LIGHTING
+in vec3 normal;
+#endif
+in float depth;
+
+layout(location = 0) out vec4 colour;
+// Object space normal packed into [0, 1], then depth across the bounding sphere with 0 nearest the view
+layout(location = 1) out vec4 normal_depth;
+
+void main() {
+    colour = vec4(1.0f);
+    #ifdef VERTEX_COLOUR
+    colour = vec4(vertex_colour.rgb, 1.0f);
+    #endif
+    vec3 packed_normal = vec3(0.5f);
+    #ifdef LIGHTING
+    packed_normal = normalize(normal) * 0.5f + 0.5f;
+    #endif
+    normal_depth = vec4(packed_normal, depth);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+#define DEFINES
+// Draws the mesh into one view of an impostor atlas, view_mat being that view's orthographic projection
+layout(location = 0) in vec3 aPos;
+#ifdef VERTEX_COLOUR
+layout(location = 1) in vec4 aColour;
+out vec4 vertex_colour;
+#endif
+#ifdef LIGHTING
+layout(location = 3) in vec3 aNormals;
+out vec3 normal;
+#endif
+uniform mat4 view_mat;
+out float depth;
+void main() {
+    gl_Position = view_mat * vec4(aPos.xyz, 1.0f);
+    depth = gl_Position.z * 0.5f + 0.5f;
+    #ifdef VERTEX_COLOUR
+    vertex_colour = aColour;
+    #endif
+    #ifdef LIGHTING
+    normal = aNormals;
+    #endif
+}
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "../backend/render_backend.hpp"
+#include "../capture/frame_capture.hpp"
+#include "mesh_bvh.hpp"
+#include "skeleton.hpp"
 #include <assimp/mesh.h>
 #include <cstddef>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <vector>
 
@@ -19,7 +25,11 @@ struct empty_tex
 {
 };
 
-template <bool has_colour, bool has_normal, size_t num_tex_coords> struct VertexAttributes
+struct empty_skin
+{
+};
+
+template <bool has_colour, bool has_normal, size_t num_tex_coords, bool has_skin = false> struct VertexAttributes
 {
     glm::vec3 position;
 
@@ -28,6 +38,7 @@ template <bool has_colour, bool has_normal, size_t num_tex_coords> struct Vertex
     [[no_unique_address]] std::conditional_t<has_normal, glm::vec3, empty_normal> normal;
     [[no_unique_address]] std::conditional_t<(num_tex_coords > 0), glm::vec<num_tex_coords, float>, empty_tex>
         tex_coords;
+    [[no_unique_address]] std::conditional_t<has_skin, SkinWeights, empty_skin> skin;
 };
 
 class VirtualMesh
@@ -41,20 +52,31 @@ class VirtualMesh
     virtual ~VirtualMesh() = default;
     virtual void use() = 0;
     virtual void draw() = 0;
+    // Object space box around every vertex
+    [[nodiscard]] virtual auto bounds() const -> Bounds = 0;
+    // Triangle BVH for CPU ray queries, only kept for meshes that asked for one
+    [[nodiscard]] virtual auto bvh() const -> const MeshBvh *
+    {
+        return nullptr;
+    }
 };
 
-template <bool has_colour, bool has_normal, size_t num_tex_coords> class Mesh : public VirtualMesh
+template <bool has_colour, bool has_normal, size_t num_tex_coords, bool has_skin = false>
+class Mesh : public VirtualMesh
 {
-    using Vertex = VertexAttributes<has_colour, has_normal, num_tex_coords>;
+    using Vertex = VertexAttributes<has_colour, has_normal, num_tex_coords, has_skin>;
 
   public:
-    explicit Mesh(std::vector<Vertex> &vertices)
+    // With build_bvh the mesh keeps a BVH of its triangles for ray casts and picking
+    explicit Mesh(const std::vector<Vertex> &vertices, bool build_bvh = false)
     {
-        add_vertices(vertices);
+        add_vertices(vertices.data(), vertices.size(), build_bvh, std::pmr::get_default_resource());
     }
-    explicit Mesh(aiMesh &mesh)
+    // Vertices are gathered in scratch, usually an importer's arena, and only outlive the constructor on the GPU
+    explicit Mesh(
+        aiMesh &mesh, bool build_bvh = false, std::pmr::memory_resource *scratch = std::pmr::get_default_resource()
+    )
     {
-        std::vector<Vertex> vertices;
         // Validation for required attributes
         if constexpr (has_colour)
         {
@@ -70,7 +92,23 @@ template <bool has_colour, bool has_normal, size_t num_tex_coords> class Mesh :
                 throw std::runtime_error("Mesh missing required texture data");
             }
         }
+        std::pmr::vector<SkinWeights> skin_weights(scratch);
+        if constexpr (has_skin)
+        {
+            if (!mesh.HasBones())
+            {
+                throw std::runtime_error("Mesh missing required bone data");
+            }
+            skin_weights = pack_skin_weights(mesh, scratch);
+        }
         // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        size_t index_count = 0;
+        for (unsigned int face_idx = 0; face_idx < mesh.mNumFaces; face_idx++)
+        {
+            index_count += mesh.mFaces[face_idx].mNumIndices;
+        }
+        std::pmr::vector<Vertex> vertices(scratch);
+        vertices.reserve(index_count);
         for (unsigned int face_idx = 0; face_idx < mesh.mNumFaces; face_idx++)
         {
             aiFace &face = mesh.mFaces[face_idx];
@@ -105,65 +143,125 @@ template <bool has_colour, bool has_normal, size_t num_tex_coords> class Mesh :
                     vertex.tex_coords[2] = mesh.mTextureCoords[0][idx][2];
                 }
 
+                if constexpr (has_skin)
+                {
+                    vertex.skin = skin_weights[idx];
+                }
+
                 vertices.push_back(vertex);
             }
         }
         // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        add_vertices(vertices);
+        add_vertices(vertices.data(), vertices.size(), build_bvh, scratch);
+    }
+    // Meshes own their GL objects, share them through shared_ptr rather than copying
+    Mesh(const Mesh &) = delete;
+    Mesh(Mesh &&) = delete;
+    auto operator=(const Mesh &) -> Mesh & = delete;
+    auto operator=(Mesh &&) -> Mesh & = delete;
+    ~Mesh() override
+    {
+        backend->delete_vertex_array(VAO);
+        backend->delete_buffer(VBO);
     }
     void use() override
     {
-        glBindVertexArray(VAO);
+        backend->bind_vertex_array(VAO);
+        if (auto *capture = FrameCapture::current())
+        {
+            capture->record_mesh(VAO, VBO, sizeof(Vertex), layout);
+        }
     }
     void draw() override
     {
-        glDrawArrays(GL_TRIANGLES, 0, count);
+        backend->draw_arrays(0, static_cast<GLsizei>(count));
+        if (auto *capture = FrameCapture::current())
+        {
+            capture->record_draw(0, static_cast<GLsizei>(count));
+        }
+    }
+    [[nodiscard]] auto bounds() const -> Bounds override
+    {
+        return mesh_bounds;
+    }
+    [[nodiscard]] auto bvh() const -> const MeshBvh * override
+    {
+        return triangle_bvh.get();
     }
 
   private:
-    void add_vertices(std::vector<Vertex> vertices)
+    void add_vertices(const Vertex *vertices, size_t vertex_count, bool build_bvh, std::pmr::memory_resource *scratch)
     {
-        glGenVertexArrays(1, &VAO);
-        use();
-        unsigned int VBO = 0;
-        glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
         // Position
-        add_attribute_pointer(0, 3, GL_FLOAT, offsetof(Vertex, position));
+        add_attribute(0, 3, GL_FLOAT, offsetof(Vertex, position));
         // Colour
         if constexpr (has_colour)
         {
-            add_attribute_pointer(1, 4, GL_FLOAT, offsetof(Vertex, colour));
+            add_attribute(1, 4, GL_FLOAT, offsetof(Vertex, colour));
         }
         // Texture coordinates
         static_assert(num_tex_coords <= 3, "Texture coordinates over 3d are not supported");
         if constexpr (num_tex_coords > 0 && num_tex_coords <= 3)
         {
-            add_attribute_pointer(2, num_tex_coords, GL_FLOAT, offsetof(Vertex, tex_coords));
+            add_attribute(2, num_tex_coords, GL_FLOAT, offsetof(Vertex, tex_coords));
         }
         // Normals
         if constexpr (has_normal)
         {
-            add_attribute_pointer(3, 3, GL_FLOAT, offsetof(Vertex, normal));
+            add_attribute(3, 3, GL_FLOAT, offsetof(Vertex, normal));
+        }
+        // Bone indices and weights
+        if constexpr (has_skin)
+        {
+            add_attribute(4, 4, GL_UNSIGNED_BYTE, offsetof(Vertex, skin.bone_indices), GL_FALSE, GL_TRUE);
+            add_attribute(5, 4, GL_UNSIGNED_BYTE, offsetof(Vertex, skin.bone_weights), GL_TRUE);
+        }
+        VBO = backend->create_buffer(vertices, vertex_count * sizeof(Vertex));
+        VAO = backend->create_vertex_array(VBO, sizeof(Vertex), layout);
+        count = vertex_count;
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (vertex_count > 0)
+        {
+            mesh_bounds = {vertices[0].position, vertices[0].position};
         }
-        count = vertices.size();
-        // Unbind
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        for (size_t i = 0; i < vertex_count; i++)
+        {
+            mesh_bounds.min = glm::min(mesh_bounds.min, vertices[i].position);
+            mesh_bounds.max = glm::max(mesh_bounds.max, vertices[i].position);
+        }
+        if (build_bvh)
+        {
+            std::pmr::vector<glm::vec3> positions(scratch);
+            positions.reserve(vertex_count);
+            for (size_t i = 0; i < vertex_count; i++)
+            {
+                positions.push_back(vertices[i].position);
+            }
+            triangle_bvh = std::make_unique<MeshBvh>(positions.data(), positions.size());
+        }
+        // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
     }
-    void add_attribute_pointer(size_t location, GLint size, size_t type, size_t offset)
+    // With integer set the attribute reaches the shader unconverted, used for bone indices
+    void add_attribute(
+        size_t location, GLint size, size_t type, size_t offset, GLboolean normalized = GL_FALSE,
+        GLboolean integer = GL_FALSE
+    )
     {
-        glVertexAttribPointer(
-            location,
+        layout.push_back({
+            static_cast<uint32_t>(location),
             size,
-            type,
-            GL_FALSE,
-            sizeof(VertexAttributes<has_colour, has_normal, num_tex_coords>),
-            reinterpret_cast<void *>(offset) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-        );
-        glEnableVertexAttribArray(location);
+            static_cast<uint32_t>(type),
+            static_cast<uint32_t>(offset),
+            normalized,
+            integer,
+        });
     }
+    RenderBackend *backend{&RenderBackend::current()};
     unsigned int VAO{};
+    unsigned int VBO{};
+    // Kept so frame captures and other backends can rebuild the vertex array
+    std::vector<VertexAttributeLayout> layout;
     unsigned int count{};
+    Bounds mesh_bounds;
+    std::unique_ptr<MeshBvh> triangle_bvh;
 };
\ No newline at end of file
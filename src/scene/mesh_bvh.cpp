@@ -0,0 +1,741 @@
+#include "mesh_bvh.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MESH_BVH_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC allows any intrinsic in any function, so no per-function target is needed
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace
+{
+using Node = MeshBvh::Node;
+using Block = MeshBvh::TriangleBlock;
+const size_t lanes = MeshBvh::packet_width;
+const unsigned all_lanes = (1U << lanes) - 1;
+const size_t bin_count = 16;
+const size_t max_leaf_triangles = 4 * lanes;
+// Past this depth the build splits at the median, which keeps every path short enough for the traversal stacks
+const size_t sah_depth = 32;
+const size_t max_depth = 64;
+// Cost of visiting a node relative to testing one block of triangles
+const float traversal_cost = 1.0F;
+const float infinity = std::numeric_limits<float>::infinity();
+
+auto surface_area(const Bounds &bounds) -> float
+{
+    const glm::vec3 size = bounds.max - bounds.min;
+    return 2.0F * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void grow(Bounds &bounds, const Bounds &other)
+{
+    bounds.min = glm::min(bounds.min, other.min);
+    bounds.max = glm::max(bounds.max, other.max);
+}
+
+auto block_count(size_t triangles) -> size_t
+{
+    return (triangles + lanes - 1) / lanes;
+}
+
+// A ray with its reciprocal direction, for slab tests
+struct PreparedRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 inverse;
+    float t_min;
+};
+
+auto prepare(const Ray &ray) -> PreparedRay
+{
+    return {ray.origin, ray.direction, 1.0F / ray.direction, ray.t_min};
+}
+
+// Distance at which the ray enters the box, or infinity if it misses before t_max
+auto box_entry(const PreparedRay &ray, const Node &node, float t_max) -> float
+{
+    float entry = ray.t_min;
+    float exit = t_max;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float to_min = (node.min[axis] - ray.origin[axis]) * ray.inverse[axis];
+        const float to_max = (node.max[axis] - ray.origin[axis]) * ray.inverse[axis];
+        entry = std::max(entry, std::min(to_min, to_max));
+        exit = std::min(exit, std::max(to_min, to_max));
+    }
+    return entry <= exit ? entry : infinity;
+}
+
+struct alignas(32) BlockHits
+{
+    std::array<float, lanes> t;
+    std::array<float, lanes> u;
+    std::array<float, lanes> v;
+    unsigned mask;
+};
+
+// Eight rays as structure-of-arrays, lanes without a ray have an empty interval
+struct alignas(32) Packet
+{
+    std::array<std::array<float, lanes>, 3> origin;
+    std::array<std::array<float, lanes>, 3> inverse;
+    std::array<float, lanes> t_min;
+    std::array<float, lanes> t_max;
+};
+
+// Reference Moller-Trumbore test, one lane at a time
+void intersect_scalar(const PreparedRay &ray, float t_max, const Block &block, BlockHits &hits)
+{
+    hits.mask = 0;
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        const glm::vec3 vertex{block.vertex[0][lane], block.vertex[1][lane], block.vertex[2][lane]};
+        const glm::vec3 edge1{block.edge1[0][lane], block.edge1[1][lane], block.edge1[2][lane]};
+        const glm::vec3 edge2{block.edge2[0][lane], block.edge2[1][lane], block.edge2[2][lane]};
+        const glm::vec3 p = glm::cross(ray.direction, edge2);
+        const float det = glm::dot(edge1, p);
+        if (det == 0.0F)
+        {
+            continue;
+        }
+        const float inv_det = 1.0F / det;
+        const glm::vec3 s = ray.origin - vertex;
+        const float u = glm::dot(s, p) * inv_det;
+        const glm::vec3 q = glm::cross(s, edge1);
+        const float v = glm::dot(ray.direction, q) * inv_det;
+        const float t = glm::dot(edge2, q) * inv_det;
+        if (u >= 0.0F && v >= 0.0F && u + v <= 1.0F && t >= ray.t_min && t < t_max)
+        {
+            hits.t[lane] = t;
+            hits.u[lane] = u;
+            hits.v[lane] = v;
+            hits.mask |= 1U << lane;
+        }
+    }
+}
+
+auto box_packet_scalar(const Packet &packet, const Node &node) -> unsigned
+{
+    unsigned mask = 0;
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        float entry = packet.t_min[lane];
+        float exit = packet.t_max[lane];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float to_min = (node.min[axis] - packet.origin[axis][lane]) * packet.inverse[axis][lane];
+            const float to_max = (node.max[axis] - packet.origin[axis][lane]) * packet.inverse[axis][lane];
+            entry = std::max(entry, std::min(to_min, to_max));
+            exit = std::min(exit, std::max(to_min, to_max));
+        }
+        mask |= entry <= exit ? 1U << lane : 0U;
+    }
+    return mask;
+}
+
+#ifdef MESH_BVH_X86
+// Four lanes of the block starting at offset, which is 0 or 4
+auto intersect_sse2(const PreparedRay &ray, float t_max, const Block &block, size_t offset, BlockHits &hits)
+    -> unsigned
+{
+    const __m128 dx = _mm_set1_ps(ray.direction.x);
+    const __m128 dy = _mm_set1_ps(ray.direction.y);
+    const __m128 dz = _mm_set1_ps(ray.direction.z);
+    const __m128 e1x = _mm_load_ps(&block.edge1[0][offset]);
+    const __m128 e1y = _mm_load_ps(&block.edge1[1][offset]);
+    const __m128 e1z = _mm_load_ps(&block.edge1[2][offset]);
+    const __m128 e2x = _mm_load_ps(&block.edge2[0][offset]);
+    const __m128 e2y = _mm_load_ps(&block.edge2[1][offset]);
+    const __m128 e2z = _mm_load_ps(&block.edge2[2][offset]);
+
+    const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0F), det);
+
+    const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_load_ps(&block.vertex[0][offset]));
+    const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_load_ps(&block.vertex[1][offset]));
+    const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_load_ps(&block.vertex[2][offset]));
+    const __m128 u = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv_det
+    );
+
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    const __m128 v = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv_det
+    );
+    const __m128 t = _mm_mul_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det
+    );
+
+    const __m128 zero = _mm_setzero_ps();
+    __m128 hit = _mm_cmpneq_ps(det, zero);
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0F)));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(t, _mm_set1_ps(ray.t_min)));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(t_max)));
+    _mm_store_ps(&hits.t[offset], t);
+    _mm_store_ps(&hits.u[offset], u);
+    _mm_store_ps(&hits.v[offset], v);
+    return static_cast<unsigned>(_mm_movemask_ps(hit));
+}
+
+auto box_packet_sse2(const Packet &packet, const Node &node, size_t offset) -> unsigned
+{
+    __m128 entry = _mm_load_ps(&packet.t_min[offset]);
+    __m128 exit = _mm_load_ps(&packet.t_max[offset]);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const __m128 origin = _mm_load_ps(&packet.origin[axis][offset]);
+        const __m128 inverse = _mm_load_ps(&packet.inverse[axis][offset]);
+        const __m128 to_min = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min[axis]), origin), inverse);
+        const __m128 to_max = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max[axis]), origin), inverse);
+        entry = _mm_max_ps(entry, _mm_min_ps(to_min, to_max));
+        exit = _mm_min_ps(exit, _mm_max_ps(to_min, to_max));
+    }
+    return static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(entry, exit)));
+}
+
+TARGET_AVX2 auto intersect_avx2(const PreparedRay &ray, float t_max, const Block &block, BlockHits &hits) -> unsigned
+{
+    const __m256 dx = _mm256_set1_ps(ray.direction.x);
+    const __m256 dy = _mm256_set1_ps(ray.direction.y);
+    const __m256 dz = _mm256_set1_ps(ray.direction.z);
+    const __m256 e1x = _mm256_load_ps(block.edge1[0].data());
+    const __m256 e1y = _mm256_load_ps(block.edge1[1].data());
+    const __m256 e1z = _mm256_load_ps(block.edge1[2].data());
+    const __m256 e2x = _mm256_load_ps(block.edge2[0].data());
+    const __m256 e2y = _mm256_load_ps(block.edge2[1].data());
+    const __m256 e2z = _mm256_load_ps(block.edge2[2].data());
+
+    const __m256 px = _mm256_fmsub_ps(dy, e2z, _mm256_mul_ps(dz, e2y));
+    const __m256 py = _mm256_fmsub_ps(dz, e2x, _mm256_mul_ps(dx, e2z));
+    const __m256 pz = _mm256_fmsub_ps(dx, e2y, _mm256_mul_ps(dy, e2x));
+    const __m256 det = _mm256_fmadd_ps(e1x, px, _mm256_fmadd_ps(e1y, py, _mm256_mul_ps(e1z, pz)));
+    const __m256 inv_det = _mm256_div_ps(_mm256_set1_ps(1.0F), det);
+
+    const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(ray.origin.x), _mm256_load_ps(block.vertex[0].data()));
+    const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(ray.origin.y), _mm256_load_ps(block.vertex[1].data()));
+    const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(ray.origin.z), _mm256_load_ps(block.vertex[2].data()));
+    const __m256 u = _mm256_mul_ps(_mm256_fmadd_ps(sx, px, _mm256_fmadd_ps(sy, py, _mm256_mul_ps(sz, pz))), inv_det);
+
+    const __m256 qx = _mm256_fmsub_ps(sy, e1z, _mm256_mul_ps(sz, e1y));
+    const __m256 qy = _mm256_fmsub_ps(sz, e1x, _mm256_mul_ps(sx, e1z));
+    const __m256 qz = _mm256_fmsub_ps(sx, e1y, _mm256_mul_ps(sy, e1x));
+    const __m256 v = _mm256_mul_ps(_mm256_fmadd_ps(dx, qx, _mm256_fmadd_ps(dy, qy, _mm256_mul_ps(dz, qz))), inv_det);
+    const __m256 t =
+        _mm256_mul_ps(_mm256_fmadd_ps(e2x, qx, _mm256_fmadd_ps(e2y, qy, _mm256_mul_ps(e2z, qz))), inv_det);
+
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 hit = _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1.0F), _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(ray.t_min), _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(t_max), _CMP_LT_OQ));
+    _mm256_store_ps(hits.t.data(), t);
+    _mm256_store_ps(hits.u.data(), u);
+    _mm256_store_ps(hits.v.data(), v);
+    return static_cast<unsigned>(_mm256_movemask_ps(hit));
+}
+
+TARGET_AVX2 auto box_packet_avx2(const Packet &packet, const Node &node) -> unsigned
+{
+    __m256 entry = _mm256_load_ps(packet.t_min.data());
+    __m256 exit = _mm256_load_ps(packet.t_max.data());
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const __m256 origin = _mm256_load_ps(packet.origin[axis].data());
+        const __m256 inverse = _mm256_load_ps(packet.inverse[axis].data());
+        const __m256 to_min = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.min[axis]), origin), inverse);
+        const __m256 to_max = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.max[axis]), origin), inverse);
+        entry = _mm256_max_ps(entry, _mm256_min_ps(to_min, to_max));
+        exit = _mm256_min_ps(exit, _mm256_max_ps(to_min, to_max));
+    }
+    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ)));
+}
+#endif
+
+void intersect_block(SimdLevel level, const PreparedRay &ray, float t_max, const Block &block, BlockHits &hits)
+{
+    switch (level)
+    {
+#ifdef MESH_BVH_X86
+    case SimdLevel::avx2:
+        hits.mask = intersect_avx2(ray, t_max, block, hits);
+        return;
+    case SimdLevel::sse2:
+        hits.mask = intersect_sse2(ray, t_max, block, 0, hits) | (intersect_sse2(ray, t_max, block, 4, hits) << 4U);
+        return;
+#endif
+    default:
+        intersect_scalar(ray, t_max, block, hits);
+        return;
+    }
+}
+
+auto box_packet(SimdLevel level, const Packet &packet, const Node &node) -> unsigned
+{
+    switch (level)
+    {
+#ifdef MESH_BVH_X86
+    case SimdLevel::avx2:
+        return box_packet_avx2(packet, node);
+    case SimdLevel::sse2:
+        return box_packet_sse2(packet, node, 0) | (box_packet_sse2(packet, node, 4) << 4U);
+#endif
+    default:
+        return box_packet_scalar(packet, node);
+    }
+}
+
+// Tests the ray against every block of a leaf, shrinking t_max to the closest hit. Returns whether anything was hit.
+template <bool any>
+auto intersect_leaf(
+    SimdLevel level, const std::vector<Block> &blocks, const Node &leaf, const PreparedRay &ray, float &t_max,
+    RayHit &hit
+) -> bool
+{
+    BlockHits hits;
+    bool found = false;
+    for (uint32_t block_idx = leaf.first; block_idx < leaf.first + leaf.count; block_idx++)
+    {
+        intersect_block(level, ray, t_max, blocks[block_idx], hits);
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            if ((hits.mask & (1U << lane)) != 0 && hits.t[lane] < t_max)
+            {
+                t_max = hits.t[lane];
+                hit = {hits.t[lane], blocks[block_idx].triangle[lane], {hits.u[lane], hits.v[lane]}};
+                found = true;
+            }
+        }
+        if (any && found)
+        {
+            return true;
+        }
+    }
+    return found;
+}
+
+// Front to back traversal, children are visited nearest first and skipped once they start beyond the closest hit
+template <bool any>
+auto traverse(
+    SimdLevel level, const std::vector<Node> &nodes, const std::vector<Block> &blocks, const Ray &ray, RayHit &hit
+) -> bool
+{
+    struct Entry
+    {
+        uint32_t node;
+        float entry;
+    };
+    const PreparedRay prepared = prepare(ray);
+    float t_max = ray.t_max;
+    if (nodes.empty() || box_entry(prepared, nodes[0], t_max) == infinity)
+    {
+        return false;
+    }
+    std::array<Entry, max_depth> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = {0, ray.t_min};
+    bool found = false;
+    while (stack_size > 0)
+    {
+        const Entry entry = stack[--stack_size];
+        if (entry.entry > t_max)
+        {
+            continue;
+        }
+        const Node &node = nodes[entry.node];
+        if (node.count > 0)
+        {
+            found = intersect_leaf<any>(level, blocks, node, prepared, t_max, hit) || found;
+            if (any && found)
+            {
+                return true;
+            }
+            continue;
+        }
+        Entry near{node.first, box_entry(prepared, nodes[node.first], t_max)};
+        Entry far{node.first + 1, box_entry(prepared, nodes[node.first + 1], t_max)};
+        if (far.entry < near.entry)
+        {
+            std::swap(near, far);
+        }
+        if (far.entry != infinity)
+        {
+            stack[stack_size++] = far;
+        }
+        if (near.entry != infinity)
+        {
+            stack[stack_size++] = near;
+        }
+    }
+    return found;
+}
+} // namespace
+
+auto transform_ray(const Ray &ray, const glm::mat4 &transform) -> Ray
+{
+    return {
+        glm::vec3(transform * glm::vec4(ray.origin, 1.0F)),
+        glm::vec3(transform * glm::vec4(ray.direction, 0.0F)),
+        ray.t_min,
+        ray.t_max,
+    };
+}
+
+MeshBvh::MeshBvh(const std::vector<glm::vec3> &positions) : MeshBvh(positions.data(), positions.size())
+{
+}
+
+MeshBvh::MeshBvh(const glm::vec3 *positions, size_t count) : total_triangles(count / 3)
+{
+    if (count % 3 != 0)
+    {
+        throw std::invalid_argument("MeshBvh positions must make whole triangles");
+    }
+    if (total_triangles == 0)
+    {
+        return;
+    }
+    std::vector<BuildTriangle> build_triangles(total_triangles);
+    for (size_t triangle = 0; triangle < total_triangles; triangle++)
+    {
+        BuildTriangle &build_triangle = build_triangles[triangle];
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        build_triangle.vertices = {positions[triangle * 3], positions[triangle * 3 + 1], positions[triangle * 3 + 2]};
+        build_triangle.bounds = {build_triangle.vertices[0], build_triangle.vertices[0]};
+        grow(build_triangle.bounds, {build_triangle.vertices[1], build_triangle.vertices[1]});
+        grow(build_triangle.bounds, {build_triangle.vertices[2], build_triangle.vertices[2]});
+        build_triangle.centroid = (build_triangle.bounds.min + build_triangle.bounds.max) * 0.5F;
+        build_triangle.triangle = static_cast<uint32_t>(triangle);
+    }
+    nodes.reserve(2 * block_count(total_triangles));
+    blocks.reserve(block_count(total_triangles));
+    nodes.push_back({});
+    build(0, build_triangles, 0, total_triangles, 0);
+}
+
+auto MeshBvh::closest_hit(const Ray &ray, SimdLevel level) const -> std::optional<RayHit>
+{
+    RayHit hit{};
+    if (traverse<false>(std::min(level, detect_simd_level()), nodes, blocks, ray, hit))
+    {
+        return hit;
+    }
+    return std::nullopt;
+}
+
+auto MeshBvh::any_hit(const Ray &ray, SimdLevel level) const -> bool
+{
+    RayHit hit{};
+    return traverse<true>(std::min(level, detect_simd_level()), nodes, blocks, ray, hit);
+}
+
+void MeshBvh::closest_hits(
+    const std::vector<Ray> &rays, std::vector<std::optional<RayHit>> &hits, SimdLevel level
+) const
+{
+    std::vector<RayHit> results(rays.size());
+    traverse_packets<false>(rays, results.data(), level);
+    hits.resize(rays.size());
+    for (size_t ray = 0; ray < rays.size(); ray++)
+    {
+        hits[ray] = results[ray].t != infinity ? std::optional(results[ray]) : std::nullopt;
+    }
+}
+
+void MeshBvh::any_hits(const std::vector<Ray> &rays, std::vector<bool> &hits, SimdLevel level) const
+{
+    std::vector<RayHit> results(rays.size());
+    traverse_packets<true>(rays, results.data(), level);
+    hits.resize(rays.size());
+    for (size_t ray = 0; ray < rays.size(); ray++)
+    {
+        hits[ray] = results[ray].t != infinity;
+    }
+}
+
+auto MeshBvh::bounds() const -> Bounds
+{
+    if (nodes.empty())
+    {
+        return {};
+    }
+    return {nodes[0].min, nodes[0].max};
+}
+
+auto MeshBvh::triangle_count() const -> size_t
+{
+    return total_triangles;
+}
+
+auto MeshBvh::node_count() const -> size_t
+{
+    return nodes.size();
+}
+
+auto MeshBvh::memory_bytes() const -> size_t
+{
+    return nodes.size() * sizeof(Node) + blocks.size() * sizeof(TriangleBlock);
+}
+
+void MeshBvh::build(uint32_t node_idx, std::vector<BuildTriangle> &triangles, size_t begin, size_t end, size_t depth)
+{
+    Bounds bounds = triangles[begin].bounds;
+    Bounds centroids{triangles[begin].centroid, triangles[begin].centroid};
+    for (size_t triangle = begin + 1; triangle < end; triangle++)
+    {
+        grow(bounds, triangles[triangle].bounds);
+        grow(centroids, {triangles[triangle].centroid, triangles[triangle].centroid});
+    }
+    nodes[node_idx].min = bounds.min;
+    nodes[node_idx].max = bounds.max;
+    const size_t count = end - begin;
+    if (count <= lanes)
+    {
+        make_leaf(node_idx, triangles, begin, end);
+        return;
+    }
+
+    const glm::vec3 extent = centroids.max - centroids.min;
+    auto bin_of = [&](const BuildTriangle &triangle, int axis) {
+        const auto bin = static_cast<size_t>(
+            (triangle.centroid[axis] - centroids.min[axis]) * static_cast<float>(bin_count) / extent[axis]
+        );
+        return std::min(bin, bin_count - 1);
+    };
+    size_t split = begin + count / 2;
+    bool split_found = false;
+    if (depth < sah_depth)
+    {
+        // Binned SAH, costs counted in blocks since leaves are tested a block at a time
+        float best_cost = infinity;
+        int best_axis = 0;
+        size_t best_bin = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (extent[axis] <= 0.0F)
+            {
+                continue;
+            }
+            std::array<Bounds, bin_count> bin_bounds{};
+            std::array<size_t, bin_count> bin_counts{};
+            for (size_t triangle = begin; triangle < end; triangle++)
+            {
+                const size_t bin = bin_of(triangles[triangle], axis);
+                if (bin_counts[bin]++ == 0)
+                {
+                    bin_bounds[bin] = triangles[triangle].bounds;
+                }
+                else
+                {
+                    grow(bin_bounds[bin], triangles[triangle].bounds);
+                }
+            }
+            // Cost of everything right of each bin boundary, swept from the right
+            std::array<float, bin_count> right_costs{};
+            Bounds right_bounds;
+            size_t right_count = 0;
+            for (size_t bin = bin_count - 1; bin > 0; bin--)
+            {
+                if (bin_counts[bin] > 0)
+                {
+                    right_bounds = right_count == 0 ? bin_bounds[bin] : right_bounds;
+                    grow(right_bounds, bin_bounds[bin]);
+                    right_count += bin_counts[bin];
+                }
+                right_costs[bin] = right_count == 0 ? infinity
+                                                    : surface_area(right_bounds) *
+                                                          static_cast<float>(block_count(right_count));
+            }
+            Bounds left_bounds;
+            size_t left_count = 0;
+            for (size_t bin = 0; bin + 1 < bin_count; bin++)
+            {
+                if (bin_counts[bin] > 0)
+                {
+                    left_bounds = left_count == 0 ? bin_bounds[bin] : left_bounds;
+                    grow(left_bounds, bin_bounds[bin]);
+                    left_count += bin_counts[bin];
+                }
+                if (left_count == 0)
+                {
+                    continue;
+                }
+                const float cost =
+                    surface_area(left_bounds) * static_cast<float>(block_count(left_count)) + right_costs[bin + 1];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = bin;
+                }
+            }
+        }
+
+        const float area = surface_area(bounds);
+        const float split_cost = traversal_cost + (area > 0.0F ? best_cost / area : infinity);
+        if (count <= max_leaf_triangles && static_cast<float>(block_count(count)) <= split_cost)
+        {
+            make_leaf(node_idx, triangles, begin, end);
+            return;
+        }
+        if (best_cost != infinity)
+        {
+            const auto middle = std::partition(
+                triangles.begin() + static_cast<std::ptrdiff_t>(begin),
+                triangles.begin() + static_cast<std::ptrdiff_t>(end),
+                [&](const BuildTriangle &triangle) { return bin_of(triangle, best_axis) <= best_bin; }
+            );
+            split = static_cast<size_t>(middle - triangles.begin());
+            split_found = split > begin && split < end;
+        }
+    }
+    if (!split_found)
+    {
+        // Median split along the widest spread of centroids, always halves however the triangles lie
+        int axis = 0;
+        if (extent.y > extent[axis])
+        {
+            axis = 1;
+        }
+        if (extent.z > extent[axis])
+        {
+            axis = 2;
+        }
+        split = begin + count / 2;
+        std::nth_element(
+            triangles.begin() + static_cast<std::ptrdiff_t>(begin),
+            triangles.begin() + static_cast<std::ptrdiff_t>(split),
+            triangles.begin() + static_cast<std::ptrdiff_t>(end),
+            [&](const BuildTriangle &lhs, const BuildTriangle &rhs) { return lhs.centroid[axis] < rhs.centroid[axis]; }
+        );
+    }
+
+    const auto child = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({});
+    nodes.push_back({});
+    nodes[node_idx].first = child;
+    nodes[node_idx].count = 0;
+    build(child, triangles, begin, split, depth + 1);
+    build(child + 1, triangles, split, end, depth + 1);
+}
+
+void MeshBvh::make_leaf(uint32_t node_idx, const std::vector<BuildTriangle> &triangles, size_t begin, size_t end)
+{
+    nodes[node_idx].first = static_cast<uint32_t>(blocks.size());
+    nodes[node_idx].count = static_cast<uint32_t>(block_count(end - begin));
+    for (size_t first = begin; first < end; first += lanes)
+    {
+        // Zeroed lanes are degenerate triangles, which the kernels reject on their zero determinant
+        TriangleBlock block{};
+        for (size_t lane = 0; lane < lanes && first + lane < end; lane++)
+        {
+            const BuildTriangle &triangle = triangles[first + lane];
+            const glm::vec3 edge1 = triangle.vertices[1] - triangle.vertices[0];
+            const glm::vec3 edge2 = triangle.vertices[2] - triangle.vertices[0];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                block.vertex.at(axis)[lane] = triangle.vertices[0][axis];
+                block.edge1.at(axis)[lane] = edge1[axis];
+                block.edge2.at(axis)[lane] = edge2[axis];
+            }
+            block.triangle[lane] = triangle.triangle;
+        }
+        blocks.push_back(block);
+    }
+}
+
+template <bool any> void MeshBvh::traverse_packets(const std::vector<Ray> &rays, RayHit *hits, SimdLevel level) const
+{
+    level = std::min(level, detect_simd_level());
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (size_t first = 0; first < rays.size(); first += lanes)
+    {
+        const size_t count = std::min(lanes, rays.size() - first);
+        Packet packet{};
+        std::array<PreparedRay, lanes> prepared{};
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            if (lane >= count)
+            {
+                // An empty interval, so the lane never enters a box
+                packet.t_min[lane] = infinity;
+                packet.t_max[lane] = -infinity;
+                continue;
+            }
+            hits[first + lane].t = infinity;
+            prepared[lane] = prepare(rays[first + lane]);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                packet.origin.at(axis)[lane] = prepared[lane].origin[axis];
+                packet.inverse.at(axis)[lane] = prepared[lane].inverse[axis];
+            }
+            packet.t_min[lane] = rays[first + lane].t_min;
+            packet.t_max[lane] = rays[first + lane].t_max;
+        }
+        if (nodes.empty())
+        {
+            continue;
+        }
+
+        unsigned active = all_lanes >> (lanes - count);
+        std::array<uint32_t, max_depth> stack;
+        size_t stack_size = 0;
+        stack[stack_size++] = 0;
+        while (stack_size > 0 && active != 0)
+        {
+            const Node &node = nodes[stack[--stack_size]];
+            const unsigned mask = box_packet(level, packet, node) & active;
+            if (mask == 0)
+            {
+                continue;
+            }
+            if (node.count > 0)
+            {
+                for (size_t lane = 0; lane < lanes; lane++)
+                {
+                    if ((mask & (1U << lane)) == 0)
+                    {
+                        continue;
+                    }
+                    float &t_max = packet.t_max[lane];
+                    RayHit &hit = hits[first + lane];
+                    const bool found = intersect_leaf<any>(level, blocks, node, prepared[lane], t_max, hit);
+                    if (any && found)
+                    {
+                        active &= ~(1U << lane);
+                    }
+                }
+                continue;
+            }
+            // Nearer child first, judged along the direction of the first ray still looking
+            size_t lead = 0;
+            while ((mask & (1U << lead)) == 0)
+            {
+                lead++;
+            }
+            const Node &left = nodes[node.first];
+            const Node &right = nodes[node.first + 1];
+            const glm::vec3 offset = (left.min + left.max) - (right.min + right.max);
+            const bool left_far = glm::dot(prepared[lead].direction, offset) > 0.0F;
+            stack[stack_size++] = left_far ? node.first : node.first + 1;
+            stack[stack_size++] = left_far ? node.first + 1 : node.first;
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
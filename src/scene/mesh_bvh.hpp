@@ -0,0 +1,90 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "transform_batch.hpp"
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <optional>
+#include <vector>
+
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float t_min = 0.0F;
+    float t_max = std::numeric_limits<float>::infinity();
+};
+
+struct RayHit
+{
+    // Distance along the ray in multiples of its direction
+    float t;
+    // Index into the triangle list the BVH was built from
+    uint32_t triangle;
+    // Weights of the triangle's second and third vertices at the hit point
+    glm::vec2 barycentric;
+};
+
+// The same ray in the space transform maps from, t values stay comparable since the direction isn't renormalised
+auto transform_ray(const Ray &ray, const glm::mat4 &transform) -> Ray;
+
+// Bounding volume hierarchy over a triangle list, built with the surface area heuristic. Nodes are 32 bytes and leaf
+// triangles are stored in blocks of eight as structure-of-arrays, so the SSE2 and AVX2 kernels test a ray against
+// four or eight triangles at once and packets of eight rays against a box.
+class MeshBvh
+{
+  public:
+    static const size_t packet_width = 8;
+    // Every three positions make a triangle, as in a non-indexed mesh
+    explicit MeshBvh(const std::vector<glm::vec3> &positions);
+    MeshBvh(const glm::vec3 *positions, size_t count);
+    [[nodiscard]] auto closest_hit(const Ray &ray, SimdLevel level = detect_simd_level()) const
+        -> std::optional<RayHit>;
+    // Whether anything lies along the ray, stopping at the first hit found
+    [[nodiscard]] auto any_hit(const Ray &ray, SimdLevel level = detect_simd_level()) const -> bool;
+    // Packets of packet_width rays traverse the tree together, coherent rays share most of the box tests
+    void closest_hits(
+        const std::vector<Ray> &rays, std::vector<std::optional<RayHit>> &hits, SimdLevel level = detect_simd_level()
+    ) const;
+    void any_hits(const std::vector<Ray> &rays, std::vector<bool> &hits, SimdLevel level = detect_simd_level()) const;
+    [[nodiscard]] auto bounds() const -> Bounds;
+    [[nodiscard]] auto triangle_count() const -> size_t;
+    [[nodiscard]] auto node_count() const -> size_t;
+    [[nodiscard]] auto memory_bytes() const -> size_t;
+
+    struct Node
+    {
+        glm::vec3 min;
+        // First child for interior nodes, whose second child follows it, or first triangle block for leaves
+        uint32_t first;
+        glm::vec3 max;
+        // Triangle blocks in a leaf, zero for interior nodes
+        uint32_t count;
+    };
+    static_assert(sizeof(Node) == 32, "BVH nodes must stay 32 bytes");
+    // Unused lanes hold degenerate triangles that never hit
+    struct alignas(32) TriangleBlock
+    {
+        std::array<std::array<float, packet_width>, 3> vertex;
+        std::array<std::array<float, packet_width>, 3> edge1;
+        std::array<std::array<float, packet_width>, 3> edge2;
+        std::array<uint32_t, packet_width> triangle;
+    };
+
+  private:
+    struct BuildTriangle
+    {
+        std::array<glm::vec3, 3> vertices;
+        Bounds bounds;
+        glm::vec3 centroid;
+        uint32_t triangle;
+    };
+    void build(uint32_t node_idx, std::vector<BuildTriangle> &triangles, size_t begin, size_t end, size_t depth);
+    void make_leaf(uint32_t node_idx, const std::vector<BuildTriangle> &triangles, size_t begin, size_t end);
+    template <bool any> void traverse_packets(const std::vector<Ray> &rays, RayHit *hits, SimdLevel level) const;
+    std::vector<Node> nodes;
+    std::vector<TriangleBlock> blocks;
+    size_t total_triangles;
+};
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "../shader/shader.hpp"
+#include "../texture/texture.hpp"
 #include "camera.hpp"
+#include "impostor.hpp"
 #include "light.hpp"
 #include "mesh.hpp"
+#include "skeleton.hpp"
 #include <memory>
 #include <optional>
 #include <type_traits>
@@ -34,12 +37,20 @@ class VirtualNode
 
     virtual void draw(Camera &camera, Light &light) = 0;
     virtual void set_transform(glm::mat4 transform) = 0;
+    // Overlay nodes are drawn in NDC after the scene, at the window's native resolution
+    [[nodiscard]] virtual auto overlay() const -> bool = 0;
+    // World space ray queries against the mesh's BVH, nothing is hit if the mesh has none or the node is an overlay
+    [[nodiscard]] virtual auto closest_hit(const Ray &ray) const -> std::optional<RayHit> = 0;
+    [[nodiscard]] virtual auto any_hit(const Ray &ray) const -> bool = 0;
+    // The mesh's bounds under the node's transform, in NDC for overlays
+    [[nodiscard]] virtual auto world_bounds() const -> Bounds = 0;
 };
 
-template <bool NDC, bool has_colour, bool has_lighting, size_t num_tex_coords> class Node : public VirtualNode
+template <bool NDC, bool has_colour, bool has_lighting, size_t num_tex_coords, bool has_skin = false>
+class Node : public VirtualNode
 {
-    using Mesh = Mesh<has_colour, has_lighting, num_tex_coords>;
-    using Shader = ShaderProgram<NDC, has_colour, has_lighting, num_tex_coords>;
+    using Mesh = Mesh<has_colour, has_lighting, num_tex_coords, has_skin>;
+    using Shader = ShaderProgram<NDC, has_colour, has_lighting, num_tex_coords, has_skin>;
 
   public:
     Node(
@@ -52,17 +63,43 @@ template <bool NDC, bool has_colour, bool has_lighting, size_t num_tex_coords> c
         if constexpr (has_lighting)
         {
             assert(material != std::nullopt);
-            values.material = material;
+            values.material = *material;
         }
     }
     void draw(Camera &camera, Light &light) override
     {
+        float impostor_fade = 0.0F;
+        if constexpr (can_use_impostor)
+        {
+            // Impostor draws have no capture command, so a captured frame draws every node as geometry
+            if (impostor && FrameCapture::current() == nullptr)
+            {
+                impostor_fade = impostor->fade(screen_size(camera));
+                if (impostor_fade > 0.0F)
+                {
+                    const MaterialValues *material = nullptr;
+                    if constexpr (has_lighting)
+                    {
+                        material = &values.material;
+                    }
+                    impostor->queue(values.transform_mat, impostor_fade, material);
+                }
+                if (impostor_fade >= 1.0F)
+                {
+                    return;
+                }
+            }
+        }
         shader->use();
         mesh->use();
         uniforms.transform_mat.set(values.transform_mat);
         if constexpr (!NDC)
         {
             uniforms.projection_mat.set(camera.projection_mat());
+            if (impostor_fade > 0.0F)
+            {
+                uniforms.impostor_fade.set(impostor_fade);
+            }
         }
         if constexpr (has_lighting)
         {
@@ -73,18 +110,105 @@ template <bool NDC, bool has_colour, bool has_lighting, size_t num_tex_coords> c
             uniforms.light_pos.set(light.pos());
             uniforms.light_colour.set(light.colour());
             uniforms.intensities.set(light.intensities());
-            uniforms.view_pos = camera.pos();
+            uniforms.view_pos.set(camera.pos());
+        }
+        if constexpr (has_skin)
+        {
+            if (bone_palette)
+            {
+                uniforms.bone_palette.set(*bone_palette);
+            }
+        }
+        if constexpr (num_tex_coords == 2)
+        {
+            if (texture)
+            {
+                // Residency follows how large the node is on screen
+                texture->request(NDC ? 1.0F : screen_size(camera));
+                texture->bind(0);
+                uniforms.diffuse_texture.set(0);
+                if (auto *capture = FrameCapture::current())
+                {
+                    capture->record_unsupported("textured nodes");
+                }
+            }
         }
         mesh->draw();
+        if constexpr (!NDC)
+        {
+            // Other nodes sharing the shader draw solid
+            if (impostor_fade > 0.0F)
+            {
+                uniforms.impostor_fade.set(0.0F);
+            }
+        }
     }
     void set_transform(glm::mat4 transform_mat) override
     {
         values.transform_mat = transform_mat;
     }
+    [[nodiscard]] auto overlay() const -> bool override
+    {
+        return NDC;
+    }
+    [[nodiscard]] auto closest_hit(const Ray &ray) const -> std::optional<RayHit> override
+    {
+        const MeshBvh *bvh = mesh->bvh();
+        if (NDC || bvh == nullptr)
+        {
+            return std::nullopt;
+        }
+        return bvh->closest_hit(transform_ray(ray, glm::inverse(values.transform_mat)));
+    }
+    [[nodiscard]] auto any_hit(const Ray &ray) const -> bool override
+    {
+        const MeshBvh *bvh = mesh->bvh();
+        if (NDC || bvh == nullptr)
+        {
+            return false;
+        }
+        return bvh->any_hit(transform_ray(ray, glm::inverse(values.transform_mat)));
+    }
+    [[nodiscard]] auto world_bounds() const -> Bounds override
+    {
+        return transform_bounds(mesh->bounds(), values.transform_mat);
+    }
+    void set_texture(std::shared_ptr<Texture> texture)
+    {
+        static_assert(num_tex_coords == 2, "Textures need 2D texture coordinates");
+        this->texture = std::move(texture);
+    }
+    // Usually a Character's palette, which it updates in place
+    void set_bone_palette(std::shared_ptr<const BonePalette> palette)
+    {
+        static_assert(has_skin, "Bone palettes need a skinned node");
+        bone_palette = std::move(palette);
+    }
+    // Below the impostor's screen size the node is queued on it instead of drawn, so the impostor must also be added
+    // to the scene. The impostor should be baked from the node's mesh, the node's own material still applies. Frames
+    // being captured ignore the impostor and draw the geometry.
+    void set_impostor(std::shared_ptr<Impostor> impostor)
+    {
+        static_assert(can_use_impostor, "Impostors stand in for static, untextured world nodes");
+        this->impostor = std::move(impostor);
+    }
 
   private:
+    static constexpr bool can_use_impostor = !NDC && !has_skin && num_tex_coords != 2;
+    // Fraction of the screen height covered by the node's bounding sphere
+    [[nodiscard]] auto screen_size(Camera &camera) const -> float
+    {
+        const Bounds bounds = transform_bounds(mesh->bounds(), values.transform_mat);
+        const glm::vec3 centre = (bounds.min + bounds.max) / 2.0F;
+        return camera.projected_size(centre, glm::length(bounds.max - centre));
+    }
     std::shared_ptr<Mesh> mesh;
     std::shared_ptr<Shader> shader;
-    ShaderUniforms<NDC, has_lighting> uniforms;
+    typename Shader::Uniforms uniforms;
     NodeValues<has_lighting> values;
+    [[no_unique_address]] std::conditional_t<has_skin, std::shared_ptr<const BonePalette>, empty_bone_palette>
+        bone_palette;
+    [[no_unique_address]] std::conditional_t<num_tex_coords == 2, std::shared_ptr<Texture>, empty_diffuse_texture>
+        texture;
+    [[no_unique_address]] std::conditional_t<can_use_impostor, std::shared_ptr<Impostor>, empty_impostor> impostor;
 };
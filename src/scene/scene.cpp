@@ -1,4 +1,7 @@
 #include "scene.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
 
 Scene::Scene(std::shared_ptr<Camera> camera, std::shared_ptr<Light> light) : nodes({}), camera(std::move(camera)), light(std::move(light))
 {
@@ -14,10 +17,109 @@ void Scene::add_node(std::shared_ptr<VirtualNode> node)
     nodes.push_back(node);
 }
 
+void Scene::remove_nodes(const std::vector<std::shared_ptr<VirtualNode>> &removed)
+{
+    std::unordered_set<VirtualNode *> lookup;
+    for (const auto &node : removed)
+    {
+        lookup.insert(node.get());
+    }
+    auto is_removed = [&](const std::shared_ptr<VirtualNode> &node) { return lookup.count(node.get()) > 0; };
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), is_removed), nodes.end());
+}
+
+void Scene::set_transforms(size_t first, const std::vector<glm::mat4> &transforms)
+{
+    if (first + transforms.size() > nodes.size())
+    {
+        throw std::out_of_range("Scene::set_transforms range exceeds node count");
+    }
+    for (size_t i = 0; i < transforms.size(); i++)
+    {
+        nodes[first + i]->set_transform(transforms[i]);
+    }
+}
+
 void Scene::draw()
+{
+    draw_world();
+    draw_overlay();
+}
+
+void Scene::draw_world()
+{
+    for (auto &node : nodes)
+    {
+        if (!node->overlay())
+        {
+            node->draw(*camera, *light);
+        }
+    }
+    for (auto &impostor : impostors)
+    {
+        impostor->draw(*camera, *light);
+    }
+    if (gpu)
+    {
+        gpu->draw(*camera, *light);
+    }
+}
+
+void Scene::draw_overlay()
 {
     for (auto &node : nodes)
     {
-        node->draw(*camera, *light);
+        if (node->overlay())
+        {
+            node->draw(*camera, *light);
+        }
+    }
+}
+
+void Scene::set_gpu_scene(std::shared_ptr<GpuScene> scene)
+{
+    gpu = std::move(scene);
+}
+
+auto Scene::gpu_scene() const -> const std::shared_ptr<GpuScene> &
+{
+    return gpu;
+}
+
+void Scene::add_impostor(std::shared_ptr<Impostor> impostor)
+{
+    impostors.push_back(std::move(impostor));
+}
+
+auto Scene::closest_hit(const Ray &ray) const -> std::optional<SceneHit>
+{
+    std::optional<SceneHit> closest;
+    Ray remaining = ray;
+    for (const auto &node : nodes)
+    {
+        // Each hit shortens the ray, so nodes behind it are rejected at their root box
+        if (auto hit = node->closest_hit(remaining))
+        {
+            closest = SceneHit{node, *hit};
+            remaining.t_max = hit->t;
+        }
+    }
+    return closest;
+}
+
+auto Scene::any_hit(const Ray &ray) const -> bool
+{
+    return std::any_of(nodes.begin(), nodes.end(), [&](const auto &node) { return node->any_hit(ray); });
+}
+
+void Scene::world_bounds(std::vector<NodeBounds> &bounds) const
+{
+    bounds.clear();
+    for (const auto &node : nodes)
+    {
+        if (!node->overlay())
+        {
+            bounds.push_back({node.get(), node->world_bounds()});
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,21 +1,60 @@
 #pragma once
 
 #include "camera.hpp"
+#include "gpu_scene.hpp"
+#include "impostor.hpp"
 #include "light.hpp"
 #include "node.hpp"
 #include <assimp/scene.h>
+#include <glm/glm.hpp>
 #include <memory>
+#include <optional>
 #include <vector>
 
+struct SceneHit
+{
+    std::shared_ptr<VirtualNode> node;
+    RayHit hit;
+};
+
+// Owned by the scene, valid until the node is removed
+struct NodeBounds
+{
+    const VirtualNode *node;
+    Bounds bounds;
+};
+
 class Scene
 {
   public:
     Scene(std::shared_ptr<Camera> camera, std::shared_ptr<Light> light);
     Scene(std::vector<std::shared_ptr<VirtualNode>> &nodes, std::shared_ptr<Camera> camera, std::shared_ptr<Light> light);
     void add_node(std::shared_ptr<VirtualNode> node);
+    // Removes every node in the list in one pass, the rest keep their order
+    void remove_nodes(const std::vector<std::shared_ptr<VirtualNode>> &removed);
+    // Sets the transform of nodes [first, first + transforms.size()) in insertion order
+    void set_transforms(size_t first, const std::vector<glm::mat4> &transforms);
     void draw();
+    // World and overlay nodes separately, so they can go to different render targets
+    void draw_world();
+    void draw_overlay();
+    // Instances in the GPU driven scene are drawn with the world nodes, null to go back to nodes only. Nodes are never
+    // moved into it, only the world streamer adds to it.
+    void set_gpu_scene(std::shared_ptr<GpuScene> scene);
+    [[nodiscard]] auto gpu_scene() const -> const std::shared_ptr<GpuScene> &;
+    // Draws the copies nodes queued on the impostor after the world nodes each frame
+    void add_impostor(std::shared_ptr<Impostor> impostor);
+    // Nearest world node along a world space ray, for picking. Only nodes whose mesh has a BVH can be hit.
+    [[nodiscard]] auto closest_hit(const Ray &ray) const -> std::optional<SceneHit>;
+    // Whether any world node blocks the ray, for line of sight
+    [[nodiscard]] auto any_hit(const Ray &ray) const -> bool;
+    // World space bounds of every world node in insertion order. Overlays are left out. Nodes come with their bounds
+    // because indices shift as nodes are removed, callers keep their own map from node to e.g. broadphase body.
+    void world_bounds(std::vector<NodeBounds> &bounds) const;
   private:
     std::vector<std::shared_ptr<VirtualNode>> nodes;
     std::shared_ptr<Camera> camera;
     std::shared_ptr<Light> light;
+    std::shared_ptr<GpuScene> gpu;
+    std::vector<std::shared_ptr<Impostor>> impostors;
 };
\ No newline at end of file
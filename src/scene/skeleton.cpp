@@ -0,0 +1,198 @@
+#include "skeleton.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+#include <stdexcept>
+
+auto to_glm(const aiMatrix4x4 &matrix) -> glm::mat4
+{
+    // Assimp is row major, glm is column major
+    return glm::transpose(glm::make_mat4(&matrix.a1));
+}
+
+auto pack_skin_weights(const aiMesh &mesh, std::pmr::memory_resource *resource) -> std::pmr::vector<SkinWeights>
+{
+    if (mesh.mNumBones > max_bones)
+    {
+        throw std::runtime_error("Mesh has more bones than the shader's bone palette");
+    }
+
+    struct Influence
+    {
+        float weight;
+        uint8_t bone;
+    };
+    std::pmr::vector<std::array<Influence, max_bone_influences>> influences(mesh.mNumVertices, resource);
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (unsigned int bone_idx = 0; bone_idx < mesh.mNumBones; bone_idx++)
+    {
+        const aiBone &bone = *mesh.mBones[bone_idx];
+        for (unsigned int i = 0; i < bone.mNumWeights; i++)
+        {
+            const aiVertexWeight &vertex_weight = bone.mWeights[i];
+            auto &slots = influences.at(vertex_weight.mVertexId);
+            // Replace the weakest influence if this one is stronger
+            auto weakest = std::min_element(slots.begin(), slots.end(), [](const Influence &lhs, const Influence &rhs) {
+                return lhs.weight < rhs.weight;
+            });
+            if (vertex_weight.mWeight > weakest->weight)
+            {
+                *weakest = {vertex_weight.mWeight, static_cast<uint8_t>(bone_idx)};
+            }
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    const float byte_max = 255.0F;
+    std::pmr::vector<SkinWeights> packed(mesh.mNumVertices, resource);
+    for (size_t vertex = 0; vertex < influences.size(); vertex++)
+    {
+        auto &slots = influences[vertex];
+        float total = 0.0F;
+        for (const auto &influence : slots)
+        {
+            total += influence.weight;
+        }
+        if (total <= 0.0F)
+        {
+            // Unweighted vertices follow bone 0 rather than collapsing to the origin
+            slots[0].weight = 1.0F;
+            total = 1.0F;
+        }
+
+        // Quantise then push the rounding error onto the strongest weight so the bytes always sum to 255
+        int sum = 0;
+        size_t strongest = 0;
+        for (size_t slot = 0; slot < max_bone_influences; slot++)
+        {
+            const auto quantised = static_cast<uint8_t>(std::lround(slots[slot].weight / total * byte_max));
+            packed[vertex].bone_indices[slot] = slots[slot].bone;
+            packed[vertex].bone_weights[slot] = quantised;
+            sum += quantised;
+            if (slots[slot].weight > slots[strongest].weight)
+            {
+                strongest = slot;
+            }
+        }
+        packed[vertex].bone_weights[strongest] =
+            static_cast<uint8_t>(packed[vertex].bone_weights[strongest] + (static_cast<int>(byte_max) - sum));
+    }
+    return packed;
+}
+
+auto JointTransform::to_mat() const -> glm::mat4
+{
+    glm::mat4 matrix = glm::mat4_cast(rotation);
+    matrix[0] *= scale.x;
+    matrix[1] *= scale.y;
+    matrix[2] *= scale.z;
+    matrix[3] = glm::vec4(translation, 1.0F);
+    return matrix;
+}
+
+void blend_poses(const Pose &from, const Pose &to, float weight, Pose &out)
+{
+    out.resize(from.size());
+    for (size_t joint = 0; joint < from.size(); joint++)
+    {
+        const JointTransform &lhs = from[joint];
+        const JointTransform &rhs = to[joint];
+        glm::quat target = rhs.rotation;
+        if (glm::dot(lhs.rotation, target) < 0.0F)
+        {
+            target = -target;
+        }
+        out[joint].translation = glm::mix(lhs.translation, rhs.translation, weight);
+        out[joint].scale = glm::mix(lhs.scale, rhs.scale, weight);
+        out[joint].rotation = glm::normalize(lhs.rotation * (1.0F - weight) + target * weight);
+    }
+}
+
+Skeleton::Skeleton(const aiScene &scene, const aiMesh &mesh)
+{
+    if (mesh.mNumBones > max_bones)
+    {
+        throw std::runtime_error("Mesh has more bones than the shader's bone palette");
+    }
+    add_joint(*scene.mRootNode, -1);
+    global_inverse = glm::inverse(to_glm(scene.mRootNode->mTransformation));
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (unsigned int bone_idx = 0; bone_idx < mesh.mNumBones; bone_idx++)
+    {
+        const aiBone &bone = *mesh.mBones[bone_idx];
+        auto joint = find_joint(bone.mName.C_Str());
+        if (!joint)
+        {
+            throw std::runtime_error(std::string("Bone has no matching scene node: ").append(bone.mName.C_Str()));
+        }
+        bone_joints.push_back(static_cast<uint32_t>(*joint));
+        inverse_binds.push_back(to_glm(bone.mOffsetMatrix));
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+void Skeleton::add_joint(const aiNode &node, int32_t parent)
+{
+    const auto index = static_cast<int32_t>(parents.size());
+    joint_names.emplace_back(node.mName.C_Str());
+    parents.push_back(parent);
+
+    aiVector3D scale;
+    aiQuaternion rotation;
+    aiVector3D position;
+    node.mTransformation.Decompose(scale, rotation, position);
+    JointTransform local;
+    local.translation = {position.x, position.y, position.z};
+    local.rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+    local.scale = {scale.x, scale.y, scale.z};
+    bind.push_back(local);
+
+    for (unsigned int child = 0; child < node.mNumChildren; child++)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        add_joint(*node.mChildren[child], index);
+    }
+}
+
+auto Skeleton::joint_count() const -> size_t
+{
+    return parents.size();
+}
+
+auto Skeleton::bone_count() const -> size_t
+{
+    return bone_joints.size();
+}
+
+auto Skeleton::find_joint(std::string_view name) const -> std::optional<size_t>
+{
+    auto found = std::find(joint_names.begin(), joint_names.end(), name);
+    if (found == joint_names.end())
+    {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(found - joint_names.begin());
+}
+
+auto Skeleton::bind_pose() const -> const Pose &
+{
+    return bind;
+}
+
+void Skeleton::compute_palette(const Pose &local, std::vector<glm::mat4> &globals, BonePalette &palette) const
+{
+    globals.resize(parents.size());
+    for (size_t joint = 0; joint < parents.size(); joint++)
+    {
+        const glm::mat4 local_mat = local[joint].to_mat();
+        globals[joint] = parents[joint] < 0 ? local_mat : globals[parents[joint]] * local_mat;
+    }
+    palette.resize(bone_joints.size());
+    for (size_t bone = 0; bone < bone_joints.size(); bone++)
+    {
+        palette[bone] = global_inverse * globals[bone_joints[bone]] * inverse_binds[bone];
+    }
+}
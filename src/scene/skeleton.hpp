@@ -0,0 +1,68 @@
+#pragma once
+
+#include <assimp/mesh.h>
+#include <assimp/scene.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Must match MAX_BONES in shader.vert. 60 mat4s plus the transform and projection matrices fit the 1024 vertex uniform
+// components GL 3.3 guarantees.
+const size_t max_bones = 60;
+const size_t max_bone_influences = 4;
+
+// Per vertex skinning data, bone weights are normalised bytes that sum to 255
+struct SkinWeights
+{
+    glm::u8vec4 bone_indices;
+    glm::u8vec4 bone_weights;
+};
+
+// Keeps the strongest max_bone_influences weights for each of the mesh's vertices, indexed like mesh.mVertices
+auto pack_skin_weights(const aiMesh &mesh, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    -> std::pmr::vector<SkinWeights>;
+
+auto to_glm(const aiMatrix4x4 &matrix) -> glm::mat4;
+
+struct JointTransform
+{
+    glm::vec3 translation{0.0F};
+    glm::quat rotation{1.0F, 0.0F, 0.0F, 0.0F};
+    glm::vec3 scale{1.0F};
+    [[nodiscard]] auto to_mat() const -> glm::mat4;
+};
+
+using Pose = std::vector<JointTransform>;
+using BonePalette = std::vector<glm::mat4>;
+
+// Writes from * (1 - weight) + to * weight into out, rotations are normalised-lerped along the shortest path
+void blend_poses(const Pose &from, const Pose &to, float weight, Pose &out);
+
+// Joint hierarchy of an Assimp scene plus the mapping from a mesh's bones to joints
+class Skeleton
+{
+  public:
+    Skeleton(const aiScene &scene, const aiMesh &mesh);
+    [[nodiscard]] auto joint_count() const -> size_t;
+    [[nodiscard]] auto bone_count() const -> size_t;
+    [[nodiscard]] auto find_joint(std::string_view name) const -> std::optional<size_t>;
+    [[nodiscard]] auto bind_pose() const -> const Pose &;
+    // Converts a local pose to one skinning matrix per mesh bone, globals is scratch space
+    void compute_palette(const Pose &local, std::vector<glm::mat4> &globals, BonePalette &palette) const;
+
+  private:
+    void add_joint(const aiNode &node, int32_t parent);
+    std::vector<std::string> joint_names;
+    // Parents always come before their children, the root has -1
+    std::vector<int32_t> parents;
+    Pose bind;
+    std::vector<uint32_t> bone_joints;
+    std::vector<glm::mat4> inverse_binds;
+    glm::mat4 global_inverse{1.0F};
+};
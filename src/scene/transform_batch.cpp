@@ -0,0 +1,479 @@
+#include "transform_batch.hpp"
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRANSFORM_BATCH_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic in any function, so no per-function target is needed
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+namespace
+{
+using Streams = TransformBatch::Streams;
+
+// Reference implementation, also used for the tail that doesn't fill a full SIMD register
+template <bool apply_view_projection>
+void compose_scalar(const Streams &in, const glm::mat4 *view_projection, glm::mat4 *out, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const float x = in[TransformBatch::rot_x][i];
+        const float y = in[TransformBatch::rot_y][i];
+        const float z = in[TransformBatch::rot_z][i];
+        const float w = in[TransformBatch::rot_w][i];
+        const float x2 = x + x;
+        const float y2 = y + y;
+        const float z2 = z + z;
+        const float xx = x * x2;
+        const float yy = y * y2;
+        const float zz = z * z2;
+        const float xy = x * y2;
+        const float xz = x * z2;
+        const float yz = y * z2;
+        const float wx = w * x2;
+        const float wy = w * y2;
+        const float wz = w * z2;
+        const float sx = in[TransformBatch::scale_x][i];
+        const float sy = in[TransformBatch::scale_y][i];
+        const float sz = in[TransformBatch::scale_z][i];
+
+        glm::mat4 model(
+            glm::vec4((1.0F - (yy + zz)) * sx, (xy + wz) * sx, (xz - wy) * sx, 0.0F),
+            glm::vec4((xy - wz) * sy, (1.0F - (xx + zz)) * sy, (yz + wx) * sy, 0.0F),
+            glm::vec4((xz + wy) * sz, (yz - wx) * sz, (1.0F - (xx + yy)) * sz, 0.0F),
+            glm::vec4(in[TransformBatch::pos_x][i], in[TransformBatch::pos_y][i], in[TransformBatch::pos_z][i], 1.0F)
+        );
+        if constexpr (apply_view_projection)
+        {
+            out[i] = *view_projection * model;
+        }
+        else
+        {
+            out[i] = model;
+        }
+    }
+}
+
+#ifdef TRANSFORM_BATCH_X86
+// Matrix elements are kept column-major, one register per element with one node per lane, e.g. element 13 is
+// column 3 row 1 (y translation) for four or eight nodes at once.
+const size_t mat_elements = 16;
+
+// std::array would drop the alignment attributes of the vector types, so they get plain wrappers instead
+// NOLINTBEGIN(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+struct Sse2Matrix
+{
+    __m128 elements[mat_elements];
+    auto operator[](size_t idx) -> __m128 &
+    {
+        return elements[idx];
+    }
+    auto operator[](size_t idx) const -> const __m128 &
+    {
+        return elements[idx];
+    }
+};
+
+struct Avx2Matrix
+{
+    __m256 elements[mat_elements];
+    auto operator[](size_t idx) -> __m256 &
+    {
+        return elements[idx];
+    }
+    auto operator[](size_t idx) const -> const __m256 &
+    {
+        return elements[idx];
+    }
+};
+// NOLINTEND(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+
+void trs_sse2(const Streams &in, size_t i, Sse2Matrix &m)
+{
+    const __m128 x = _mm_loadu_ps(in[TransformBatch::rot_x] + i);
+    const __m128 y = _mm_loadu_ps(in[TransformBatch::rot_y] + i);
+    const __m128 z = _mm_loadu_ps(in[TransformBatch::rot_z] + i);
+    const __m128 w = _mm_loadu_ps(in[TransformBatch::rot_w] + i);
+    const __m128 sx = _mm_loadu_ps(in[TransformBatch::scale_x] + i);
+    const __m128 sy = _mm_loadu_ps(in[TransformBatch::scale_y] + i);
+    const __m128 sz = _mm_loadu_ps(in[TransformBatch::scale_z] + i);
+    const __m128 one = _mm_set1_ps(1.0F);
+    const __m128 zero = _mm_setzero_ps();
+
+    const __m128 x2 = _mm_add_ps(x, x);
+    const __m128 y2 = _mm_add_ps(y, y);
+    const __m128 z2 = _mm_add_ps(z, z);
+    const __m128 xx = _mm_mul_ps(x, x2);
+    const __m128 yy = _mm_mul_ps(y, y2);
+    const __m128 zz = _mm_mul_ps(z, z2);
+    const __m128 xy = _mm_mul_ps(x, y2);
+    const __m128 xz = _mm_mul_ps(x, z2);
+    const __m128 yz = _mm_mul_ps(y, z2);
+    const __m128 wx = _mm_mul_ps(w, x2);
+    const __m128 wy = _mm_mul_ps(w, y2);
+    const __m128 wz = _mm_mul_ps(w, z2);
+
+    m[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+    m[1] = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+    m[2] = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+    m[3] = zero;
+    m[4] = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+    m[5] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+    m[6] = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+    m[7] = zero;
+    m[8] = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+    m[9] = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+    m[10] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+    m[11] = zero;
+    m[12] = _mm_loadu_ps(in[TransformBatch::pos_x] + i);
+    m[13] = _mm_loadu_ps(in[TransformBatch::pos_y] + i);
+    m[14] = _mm_loadu_ps(in[TransformBatch::pos_z] + i);
+    m[15] = one;
+}
+
+// The model matrix always has (0, 0, 0, 1) as its bottom row, so each output element needs three multiplies plus
+// the view-projection translation on the last column.
+void apply_view_projection_sse2(
+    const Sse2Matrix &view_projection, Sse2Matrix &m
+)
+{
+    Sse2Matrix result{};
+    for (size_t col = 0; col < 4; col++)
+    {
+        for (size_t row = 0; row < 4; row++)
+        {
+            __m128 acc = _mm_mul_ps(view_projection[row], m[col * 4]);
+            acc = _mm_add_ps(acc, _mm_mul_ps(view_projection[4 + row], m[(col * 4) + 1]));
+            acc = _mm_add_ps(acc, _mm_mul_ps(view_projection[8 + row], m[(col * 4) + 2]));
+            if (col == 3)
+            {
+                acc = _mm_add_ps(acc, view_projection[12 + row]);
+            }
+            result[(col * 4) + row] = acc;
+        }
+    }
+    m = result;
+}
+
+template <bool apply_view_projection>
+void compose_sse2(const Streams &in, const glm::mat4 *view_projection, glm::mat4 *out, size_t begin, size_t end)
+{
+    const size_t lanes = 4;
+    Sse2Matrix view_projection_lanes{};
+    if constexpr (apply_view_projection)
+    {
+        for (size_t element = 0; element < mat_elements; element++)
+        {
+            view_projection_lanes[element] = _mm_set1_ps(glm::value_ptr(*view_projection)[element]);
+        }
+    }
+
+    size_t i = begin;
+    Sse2Matrix m{};
+    for (; i + lanes <= end; i += lanes)
+    {
+        trs_sse2(in, i, m);
+        if constexpr (apply_view_projection)
+        {
+            apply_view_projection_sse2(view_projection_lanes, m);
+        }
+        // Each group of four registers is one column for four nodes, transpose it into one column per node
+        float *dst = glm::value_ptr(out[i]);
+        for (size_t col = 0; col < 4; col++)
+        {
+            __m128 row0 = m[col * 4];
+            __m128 row1 = m[(col * 4) + 1];
+            __m128 row2 = m[(col * 4) + 2];
+            __m128 row3 = m[(col * 4) + 3];
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            _mm_storeu_ps(dst + (col * 4), row0);
+            _mm_storeu_ps(dst + mat_elements + (col * 4), row1);
+            _mm_storeu_ps(dst + (2 * mat_elements) + (col * 4), row2);
+            _mm_storeu_ps(dst + (3 * mat_elements) + (col * 4), row3);
+        }
+    }
+    compose_scalar<apply_view_projection>(in, view_projection, out, i, end);
+}
+
+TARGET_AVX2 inline void trs_avx2(const Streams &in, size_t i, Avx2Matrix &m)
+{
+    const __m256 x = _mm256_loadu_ps(in[TransformBatch::rot_x] + i);
+    const __m256 y = _mm256_loadu_ps(in[TransformBatch::rot_y] + i);
+    const __m256 z = _mm256_loadu_ps(in[TransformBatch::rot_z] + i);
+    const __m256 w = _mm256_loadu_ps(in[TransformBatch::rot_w] + i);
+    const __m256 sx = _mm256_loadu_ps(in[TransformBatch::scale_x] + i);
+    const __m256 sy = _mm256_loadu_ps(in[TransformBatch::scale_y] + i);
+    const __m256 sz = _mm256_loadu_ps(in[TransformBatch::scale_z] + i);
+    const __m256 one = _mm256_set1_ps(1.0F);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256 x2 = _mm256_add_ps(x, x);
+    const __m256 y2 = _mm256_add_ps(y, y);
+    const __m256 z2 = _mm256_add_ps(z, z);
+    const __m256 xx = _mm256_mul_ps(x, x2);
+    const __m256 yy = _mm256_mul_ps(y, y2);
+    const __m256 zz = _mm256_mul_ps(z, z2);
+    const __m256 xy = _mm256_mul_ps(x, y2);
+    const __m256 xz = _mm256_mul_ps(x, z2);
+    const __m256 yz = _mm256_mul_ps(y, z2);
+    const __m256 wx = _mm256_mul_ps(w, x2);
+    const __m256 wy = _mm256_mul_ps(w, y2);
+    const __m256 wz = _mm256_mul_ps(w, z2);
+
+    m[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx);
+    m[1] = _mm256_mul_ps(_mm256_add_ps(xy, wz), sx);
+    m[2] = _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx);
+    m[3] = zero;
+    m[4] = _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy);
+    m[5] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy);
+    m[6] = _mm256_mul_ps(_mm256_add_ps(yz, wx), sy);
+    m[7] = zero;
+    m[8] = _mm256_mul_ps(_mm256_add_ps(xz, wy), sz);
+    m[9] = _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz);
+    m[10] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz);
+    m[11] = zero;
+    m[12] = _mm256_loadu_ps(in[TransformBatch::pos_x] + i);
+    m[13] = _mm256_loadu_ps(in[TransformBatch::pos_y] + i);
+    m[14] = _mm256_loadu_ps(in[TransformBatch::pos_z] + i);
+    m[15] = one;
+}
+
+TARGET_AVX2 inline void apply_view_projection_avx2(
+    const Avx2Matrix &view_projection, Avx2Matrix &m
+)
+{
+    Avx2Matrix result{};
+    for (size_t col = 0; col < 4; col++)
+    {
+        for (size_t row = 0; row < 4; row++)
+        {
+            __m256 acc = _mm256_mul_ps(view_projection[row], m[col * 4]);
+            acc = _mm256_fmadd_ps(view_projection[4 + row], m[(col * 4) + 1], acc);
+            acc = _mm256_fmadd_ps(view_projection[8 + row], m[(col * 4) + 2], acc);
+            if (col == 3)
+            {
+                acc = _mm256_add_ps(acc, view_projection[12 + row]);
+            }
+            result[(col * 4) + row] = acc;
+        }
+    }
+    m = result;
+}
+
+// Transposes eight registers of eight lanes and writes lane n to dst + n * stride
+TARGET_AVX2 inline void transpose_store_avx2(const __m256 *rows, float *dst, size_t stride)
+{
+    const __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+    const __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+    const __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+    const __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+    const __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+    const __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+    const __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+    const __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+    const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(dst, _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(dst + stride, _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(dst + (2 * stride), _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(dst + (3 * stride), _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(dst + (4 * stride), _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(dst + (5 * stride), _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(dst + (6 * stride), _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(dst + (7 * stride), _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+template <bool apply_view_projection>
+TARGET_AVX2 void compose_avx2(
+    const Streams &in, const glm::mat4 *view_projection, glm::mat4 *out, size_t begin, size_t end
+)
+{
+    const size_t lanes = 8;
+    Avx2Matrix view_projection_lanes{};
+    if constexpr (apply_view_projection)
+    {
+        for (size_t element = 0; element < mat_elements; element++)
+        {
+            view_projection_lanes[element] = _mm256_set1_ps(glm::value_ptr(*view_projection)[element]);
+        }
+    }
+
+    size_t i = begin;
+    Avx2Matrix m{};
+    for (; i + lanes <= end; i += lanes)
+    {
+        trs_avx2(in, i, m);
+        if constexpr (apply_view_projection)
+        {
+            apply_view_projection_avx2(view_projection_lanes, m);
+        }
+        // Columns 0-1 and 2-3 are each an 8x8 block of elements by nodes
+        float *dst = glm::value_ptr(out[i]);
+        transpose_store_avx2(m.elements, dst, mat_elements);
+        transpose_store_avx2(m.elements + lanes, dst + lanes, mat_elements);
+    }
+    compose_scalar<apply_view_projection>(in, view_projection, out, i, end);
+}
+#endif
+
+template <bool apply_view_projection>
+void compose_dispatch(
+    SimdLevel level, const Streams &in, const glm::mat4 *view_projection, glm::mat4 *out, size_t count
+)
+{
+    switch (level)
+    {
+#ifdef TRANSFORM_BATCH_X86
+    case SimdLevel::avx2:
+        compose_avx2<apply_view_projection>(in, view_projection, out, 0, count);
+        return;
+    case SimdLevel::sse2:
+        compose_sse2<apply_view_projection>(in, view_projection, out, 0, count);
+        return;
+#endif
+    default:
+        compose_scalar<apply_view_projection>(in, view_projection, out, 0, count);
+        return;
+    }
+}
+} // namespace
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+auto detect_simd_level() -> SimdLevel
+{
+    static const SimdLevel level = [] {
+#ifdef TRANSFORM_BATCH_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+        const int osxsave_bit = 27;
+        const int avx_bit = 28;
+        const int fma_bit = 12;
+        const int avx2_bit = 5;
+        const unsigned long long ymm_state = 0x6;
+        std::array<int, 4> info{};
+        __cpuid(info.data(), 0);
+        if (info[0] >= 7)
+        {
+            __cpuid(info.data(), 1);
+            const bool os_avx = (info[2] & (1 << osxsave_bit)) != 0 && (info[2] & (1 << avx_bit)) != 0;
+            const bool fma = (info[2] & (1 << fma_bit)) != 0;
+            __cpuidex(info.data(), 7, 0);
+            const bool avx2 = (info[1] & (1 << avx2_bit)) != 0;
+            if (os_avx && fma && avx2 && (_xgetbv(0) & ymm_state) == ymm_state)
+            {
+                return SimdLevel::avx2;
+            }
+        }
+        return SimdLevel::sse2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        {
+            return SimdLevel::avx2;
+        }
+        return SimdLevel::sse2;
+#endif
+#else
+        return SimdLevel::scalar;
+#endif
+    }();
+    return level;
+}
+
+TransformBatch::TransformBatch(size_t count)
+{
+    resize(count);
+}
+
+void TransformBatch::resize(size_t count)
+{
+    for (size_t stream = 0; stream < stream_count; stream++)
+    {
+        // New nodes start at the identity transform
+        const bool is_one = stream == rot_w || stream == scale_x || stream == scale_y || stream == scale_z;
+        components[stream].resize(count, is_one ? 1.0F : 0.0F);
+    }
+    this->count = count;
+}
+
+auto TransformBatch::size() const -> size_t
+{
+    return count;
+}
+
+void TransformBatch::set(size_t idx, glm::vec3 position, glm::quat rotation, glm::vec3 scale)
+{
+    set_position(idx, position);
+    set_rotation(idx, rotation);
+    set_scale(idx, scale);
+}
+
+void TransformBatch::set_position(size_t idx, glm::vec3 position)
+{
+    components[pos_x][idx] = position.x;
+    components[pos_y][idx] = position.y;
+    components[pos_z][idx] = position.z;
+}
+
+void TransformBatch::set_rotation(size_t idx, glm::quat rotation)
+{
+    components[rot_x][idx] = rotation.x;
+    components[rot_y][idx] = rotation.y;
+    components[rot_z][idx] = rotation.z;
+    components[rot_w][idx] = rotation.w;
+}
+
+void TransformBatch::set_scale(size_t idx, glm::vec3 scale)
+{
+    components[scale_x][idx] = scale.x;
+    components[scale_y][idx] = scale.y;
+    components[scale_z][idx] = scale.z;
+}
+
+void TransformBatch::compose(std::vector<glm::mat4> &out, SimdLevel level) const
+{
+    run(nullptr, out, level);
+}
+
+void TransformBatch::compose(const glm::mat4 &view_projection, std::vector<glm::mat4> &out, SimdLevel level) const
+{
+    run(&view_projection, out, level);
+}
+
+auto TransformBatch::streams() const -> Streams
+{
+    Streams streams{};
+    for (size_t stream = 0; stream < stream_count; stream++)
+    {
+        streams[stream] = components[stream].data();
+    }
+    return streams;
+}
+
+void TransformBatch::run(const glm::mat4 *view_projection, std::vector<glm::mat4> &out, SimdLevel level) const
+{
+    // Never run a kernel the CPU can't execute, even if asked to
+    level = std::min(level, detect_simd_level());
+    out.resize(count);
+    if (view_projection != nullptr)
+    {
+        compose_dispatch<true>(level, streams(), view_projection, out.data(), count);
+    }
+    else
+    {
+        compose_dispatch<false>(level, streams(), nullptr, out.data(), count);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+enum class SimdLevel
+{
+    scalar,
+    sse2,
+    avx2,
+};
+
+// Highest instruction set the kernels can use on this CPU, detected once and cached.
+auto detect_simd_level() -> SimdLevel;
+
+// Translation/rotation/scale for many nodes stored as structure-of-arrays, so the compose kernels can load eight
+// (AVX2) or four (SSE2) nodes' worth of each component in a single instruction.
+class TransformBatch
+{
+  public:
+    enum Stream : size_t
+    {
+        pos_x,
+        pos_y,
+        pos_z,
+        rot_x,
+        rot_y,
+        rot_z,
+        rot_w,
+        scale_x,
+        scale_y,
+        scale_z,
+        stream_count,
+    };
+    using Streams = std::array<const float *, stream_count>;
+
+    TransformBatch() = default;
+    explicit TransformBatch(size_t count);
+    void resize(size_t count);
+    [[nodiscard]] auto size() const -> size_t;
+    void set(size_t idx, glm::vec3 position, glm::quat rotation, glm::vec3 scale);
+    void set_position(size_t idx, glm::vec3 position);
+    void set_rotation(size_t idx, glm::quat rotation);
+    void set_scale(size_t idx, glm::vec3 scale);
+    // Writes T * R * S for every node into out, which is resized to size().
+    void compose(std::vector<glm::mat4> &out, SimdLevel level = detect_simd_level()) const;
+    // Writes view_projection * T * R * S for every node into out, which is resized to size().
+    void compose(
+        const glm::mat4 &view_projection, std::vector<glm::mat4> &out, SimdLevel level = detect_simd_level()
+    ) const;
+
+  private:
+    [[nodiscard]] auto streams() const -> Streams;
+    void run(const glm::mat4 *view_projection, std::vector<glm::mat4> &out, SimdLevel level) const;
+    std::array<std::vector<float>, stream_count> components;
+    size_t count{};
+};
@@ -3,6 +3,10 @@
 #ifdef VERTEX_COLOUR
 in vec4 vertex_colour;
 #endif
+#ifdef TEXTURE_COORDS_2D
+in vec2 tex_coords;
+uniform sampler2D diffuse_texture;
+#endif
 #ifdef LIGHTING
 in vec3 normal;
 in vec3 frag_pos;
@@ -18,14 +22,26 @@ uniform vec3 intensities;
 uniform vec3 view_pos;
 uniform Material material;
 #endif
+#ifndef NDC
+// Set while a node cross-fades to its impostor, the complement of the dither in impostor.frag
+uniform float impostor_fade;
+#endif
 
 out vec4 frag_colour;
 
 void main() {
+    #ifndef NDC
+    if (fract(52.9829189f * fract(dot(gl_FragCoord.xy, vec2(0.06711056f, 0.00583715f)))) < impostor_fade) {
+        discard;
+    }
+    #endif
     frag_colour = vec4(1.0f);
     #ifdef VERTEX_COLOUR
     frag_colour *= vertex_colour;
     #endif
+    #ifdef TEXTURE_COORDS_2D
+    frag_colour *= texture(diffuse_texture, tex_coords);
+    #endif
     #ifdef LIGHTING
     vec3 light_dir = normalize(light_pos - frag_pos);
     float light_attenuation = 0.0001f * length(light_pos - frag_pos) + 1.0f;
@@ -10,6 +10,7 @@ layout(location = 2) in float aTexCoords;
 #endif
 #ifdef TEXTURE_COORDS_2D
 layout(location = 2) in vec2 aTexCoords;
+out vec2 tex_coords;
 #endif
 #ifdef TEXTURE_COORDS_3D
 layout(location = 2) in vec3 aTexCoords;
@@ -19,21 +20,40 @@ layout(location = 3) in vec3 aNormals;
 out vec3 normal;
 out vec3 frag_pos;
 #endif
+#ifdef SKINNING
+// Must match max_bones in skeleton.hpp
+#define MAX_BONES 60
+layout(location = 4) in uvec4 aBoneIndices;
+layout(location = 5) in vec4 aBoneWeights;
+uniform mat4 bone_palette[MAX_BONES];
+#endif
 uniform mat4 transform_mat;
 #ifndef NDC
 uniform mat4 projection_mat;
 #endif
 void main() {
+    #ifdef SKINNING
+    mat4 skin_mat = aBoneWeights.x * bone_palette[aBoneIndices.x]
+        + aBoneWeights.y * bone_palette[aBoneIndices.y]
+        + aBoneWeights.z * bone_palette[aBoneIndices.z]
+        + aBoneWeights.w * bone_palette[aBoneIndices.w];
+    mat4 model_mat = transform_mat * skin_mat;
+    #else
+    mat4 model_mat = transform_mat;
+    #endif
     gl_Position = vec4(aPos.xyz, 1.0f);
-    gl_Position = transform_mat * gl_Position;
+    gl_Position = model_mat * gl_Position;
     #ifndef NDC
     gl_Position = projection_mat * gl_Position;
     #endif
     #ifdef VERTEX_COLOUR
     vertex_colour = aColour;
     #endif
+    #ifdef TEXTURE_COORDS_2D
+    tex_coords = aTexCoords;
+    #endif
     #ifdef LIGHTING
-    normal = normalize(mat3(transform_mat) * aNormals);
-    frag_pos = (transform_mat * vec4(aPos.xyz, 1.0f)).xyz;
+    normal = normalize(mat3(model_mat) * aNormals);
+    frag_pos = (model_mat * vec4(aPos.xyz, 1.0f)).xyz;
     #endif
 }
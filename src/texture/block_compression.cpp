@@ -0,0 +1,223 @@
+#include "block_compression.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace
+{
+const uint32_t block_size = 4;
+const size_t block_bytes = 8;
+const size_t channels = 4;
+const int red_bits = 5;
+const int green_bits = 6;
+const int max_5_bit = 31;
+const int max_6_bit = 63;
+const int byte_max = 255;
+const int byte_bits = 8;
+
+using Colour = std::array<int, 3>;
+
+auto to_565(const Colour &colour) -> uint16_t
+{
+    const int red = (colour[0] * max_5_bit + (byte_max / 2)) / byte_max;
+    const int green = (colour[1] * max_6_bit + (byte_max / 2)) / byte_max;
+    const int blue = (colour[2] * max_5_bit + (byte_max / 2)) / byte_max;
+    return static_cast<uint16_t>((red << (green_bits + red_bits)) | (green << red_bits) | blue);
+}
+
+auto from_565(uint16_t packed) -> Colour
+{
+    const int red = (packed >> (green_bits + red_bits)) & max_5_bit;
+    const int green = (packed >> red_bits) & max_6_bit;
+    const int blue = packed & max_5_bit;
+    return {(red * byte_max) / max_5_bit, (green * byte_max) / max_6_bit, (blue * byte_max) / max_5_bit};
+}
+
+// Four colour palette when c0 > c1, otherwise three colours plus black
+auto palette(uint16_t c0, uint16_t c1) -> std::array<Colour, 4>
+{
+    const Colour colour0 = from_565(c0);
+    const Colour colour1 = from_565(c1);
+    std::array<Colour, 4> result{colour0, colour1, {}, {}};
+    for (size_t channel = 0; channel < 3; channel++)
+    {
+        if (c0 > c1)
+        {
+            result[2][channel] = ((2 * colour0[channel]) + colour1[channel]) / 3;
+            result[3][channel] = (colour0[channel] + (2 * colour1[channel])) / 3;
+        }
+        else
+        {
+            result[2][channel] = (colour0[channel] + colour1[channel]) / 2;
+            result[3][channel] = 0;
+        }
+    }
+    return result;
+}
+
+auto distance_squared(const Colour &lhs, const Colour &rhs) -> int
+{
+    int sum = 0;
+    for (size_t channel = 0; channel < 3; channel++)
+    {
+        const int diff = lhs[channel] - rhs[channel];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+// Bounding box endpoints inset by 1/16 of the range, which lands the 1/3 and 2/3 palette entries closer to the bulk
+// of the block's colours than the raw extremes do
+auto encode_block(const std::array<Colour, block_size * block_size> &pixels) -> std::array<uint8_t, block_bytes>
+{
+    const int inset_shift = 4;
+    Colour low{byte_max, byte_max, byte_max};
+    Colour high{0, 0, 0};
+    for (const auto &pixel : pixels)
+    {
+        for (size_t channel = 0; channel < 3; channel++)
+        {
+            low[channel] = std::min(low[channel], pixel[channel]);
+            high[channel] = std::max(high[channel], pixel[channel]);
+        }
+    }
+    for (size_t channel = 0; channel < 3; channel++)
+    {
+        const int inset = (high[channel] - low[channel]) >> inset_shift;
+        low[channel] = std::min(byte_max, low[channel] + inset);
+        high[channel] = std::max(0, high[channel] - inset);
+    }
+
+    uint16_t c0 = to_565(high);
+    uint16_t c1 = to_565(low);
+    uint32_t indices = 0;
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+    }
+    if (c0 != c1)
+    {
+        const auto colours = palette(c0, c1);
+        for (size_t pixel = 0; pixel < pixels.size(); pixel++)
+        {
+            uint32_t best = 0;
+            for (uint32_t entry = 1; entry < colours.size(); entry++)
+            {
+                if (distance_squared(pixels[pixel], colours[entry]) < distance_squared(pixels[pixel], colours[best]))
+                {
+                    best = entry;
+                }
+            }
+            indices |= best << (pixel * 2);
+        }
+    }
+
+    return {
+        static_cast<uint8_t>(c0 & byte_max),
+        static_cast<uint8_t>(c0 >> byte_bits),
+        static_cast<uint8_t>(c1 & byte_max),
+        static_cast<uint8_t>(c1 >> byte_bits),
+        static_cast<uint8_t>(indices & byte_max),
+        static_cast<uint8_t>((indices >> byte_bits) & byte_max),
+        static_cast<uint8_t>((indices >> (2 * byte_bits)) & byte_max),
+        static_cast<uint8_t>(indices >> (3 * byte_bits)),
+    };
+}
+} // namespace
+
+auto encode_bc1(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height) -> std::vector<uint8_t>
+{
+    const uint32_t blocks_x = std::max(1U, (width + block_size - 1) / block_size);
+    const uint32_t blocks_y = std::max(1U, (height + block_size - 1) / block_size);
+    std::vector<uint8_t> blocks;
+    blocks.reserve(static_cast<size_t>(blocks_x) * blocks_y * block_bytes);
+
+    std::array<Colour, block_size * block_size> pixels{};
+    for (uint32_t block_y = 0; block_y < blocks_y; block_y++)
+    {
+        for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+        {
+            // Edge blocks repeat the last row and column
+            for (uint32_t y = 0; y < block_size; y++)
+            {
+                for (uint32_t x = 0; x < block_size; x++)
+                {
+                    const uint32_t src_x = std::min((block_x * block_size) + x, width - 1);
+                    const uint32_t src_y = std::min((block_y * block_size) + y, height - 1);
+                    const size_t src = ((static_cast<size_t>(src_y) * width) + src_x) * channels;
+                    pixels.at((y * block_size) + x) = {rgba[src], rgba[src + 1], rgba[src + 2]};
+                }
+            }
+            const auto block = encode_block(pixels);
+            blocks.insert(blocks.end(), block.begin(), block.end());
+        }
+    }
+    return blocks;
+}
+
+auto decode_bc1(const std::vector<uint8_t> &blocks, uint32_t width, uint32_t height) -> std::vector<uint8_t>
+{
+    const uint32_t blocks_x = std::max(1U, (width + block_size - 1) / block_size);
+    const uint32_t blocks_y = std::max(1U, (height + block_size - 1) / block_size);
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * channels);
+
+    for (uint32_t block_y = 0; block_y < blocks_y; block_y++)
+    {
+        for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+        {
+            const size_t base = ((static_cast<size_t>(block_y) * blocks_x) + block_x) * block_bytes;
+            const auto c0 = static_cast<uint16_t>(blocks[base] | (blocks[base + 1] << byte_bits));
+            const auto c1 = static_cast<uint16_t>(blocks[base + 2] | (blocks[base + 3] << byte_bits));
+            const uint32_t indices = blocks[base + 4] | (blocks[base + 5] << byte_bits) |
+                                     (blocks[base + 6] << (2 * byte_bits)) |
+                                     (static_cast<uint32_t>(blocks[base + 7]) << (3 * byte_bits));
+            const auto colours = palette(c0, c1);
+            for (uint32_t y = 0; y < block_size; y++)
+            {
+                for (uint32_t x = 0; x < block_size; x++)
+                {
+                    const uint32_t dst_x = (block_x * block_size) + x;
+                    const uint32_t dst_y = (block_y * block_size) + y;
+                    if (dst_x >= width || dst_y >= height)
+                    {
+                        continue;
+                    }
+                    const uint32_t entry = (indices >> (((y * block_size) + x) * 2)) & 3U;
+                    const size_t dst = ((static_cast<size_t>(dst_y) * width) + dst_x) * channels;
+                    rgba[dst] = static_cast<uint8_t>(colours.at(entry)[0]);
+                    rgba[dst + 1] = static_cast<uint8_t>(colours.at(entry)[1]);
+                    rgba[dst + 2] = static_cast<uint8_t>(colours.at(entry)[2]);
+                    rgba[dst + 3] = static_cast<uint8_t>(byte_max);
+                }
+            }
+        }
+    }
+    return rgba;
+}
+
+auto downsample_rgba8(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height) -> std::vector<uint8_t>
+{
+    const uint32_t out_width = std::max(1U, width / 2);
+    const uint32_t out_height = std::max(1U, height / 2);
+    std::vector<uint8_t> out(static_cast<size_t>(out_width) * out_height * channels);
+    for (uint32_t y = 0; y < out_height; y++)
+    {
+        for (uint32_t x = 0; x < out_width; x++)
+        {
+            const uint32_t x0 = std::min(x * 2, width - 1);
+            const uint32_t x1 = std::min((x * 2) + 1, width - 1);
+            const uint32_t y0 = std::min(y * 2, height - 1);
+            const uint32_t y1 = std::min((y * 2) + 1, height - 1);
+            for (size_t channel = 0; channel < channels; channel++)
+            {
+                auto texel = [&](uint32_t src_x, uint32_t src_y) {
+                    return rgba[(((static_cast<size_t>(src_y) * width) + src_x) * channels) + channel];
+                };
+                const int sum = texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1);
+                const size_t dst = (((static_cast<size_t>(y) * out_width) + x) * channels) + channel;
+                out[dst] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// RGBA8 images are tightly packed rows, four bytes per pixel
+auto encode_bc1(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height) -> std::vector<uint8_t>;
+auto decode_bc1(const std::vector<uint8_t> &blocks, uint32_t width, uint32_t height) -> std::vector<uint8_t>;
+// Box filters to half size in each dimension, rounding odd sizes down but never below 1
+auto downsample_rgba8(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height) -> std::vector<uint8_t>;
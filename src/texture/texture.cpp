@@ -0,0 +1,547 @@
+#include "texture.hpp"
+#include "block_compression.hpp"
+#include "../core/arena.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+// GL_EXT_texture_compression_s3tc isn't core, so glad doesn't define it
+const GLenum compressed_rgb_s3tc_dxt1 = 0x83F0;
+
+template <typename T> auto is_ready(const std::future<T> &future) -> bool
+{
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+auto has_extension(std::string_view name) -> bool
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension != nullptr && name == extension)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reads levels [first_mip, end_mip)
+auto read_levels_from(
+    const std::string &path, const TextureFileInfo &info, uint32_t first_mip, uint32_t end_mip, bool decode
+)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Can't open texture " + path);
+    }
+    std::vector<MipLevelInfo> levels;
+    std::vector<std::vector<uint8_t>> data;
+    for (size_t level = first_mip; level < end_mip; level++)
+    {
+        const MipLevelInfo &level_info = info.levels[level];
+        std::vector<uint8_t> bytes(level_info.size);
+        file.seekg(static_cast<std::streamoff>(level_info.offset));
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file)
+        {
+            throw std::runtime_error("Texture truncated " + path);
+        }
+        if (decode)
+        {
+            bytes = decode_bc1(bytes, level_info.width, level_info.height);
+        }
+        levels.push_back(level_info);
+        data.push_back(std::move(bytes));
+    }
+    return std::make_pair(std::move(levels), std::move(data));
+}
+
+void write_level(GLint level, TextureFormat format, const MipLevelInfo &info, const std::vector<uint8_t> &data)
+{
+    const auto width = static_cast<GLsizei>(info.width);
+    const auto height = static_cast<GLsizei>(info.height);
+    if (format == TextureFormat::bc1)
+    {
+        glCompressedTexSubImage2D(
+            GL_TEXTURE_2D,
+            level,
+            0,
+            0,
+            width,
+            height,
+            compressed_rgb_s3tc_dxt1,
+            static_cast<GLsizei>(data.size()),
+            data.data()
+        );
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+    }
+}
+} // namespace
+
+Texture::Texture(std::string path, GLuint fallback) : file_path(std::move(path)), fallback(fallback)
+{
+}
+
+Texture::~Texture()
+{
+    if (handle != 0)
+    {
+        glDeleteTextures(1, &handle);
+    }
+}
+
+void Texture::request(float screen_fraction)
+{
+    requested_fraction = std::max(requested_fraction, screen_fraction);
+}
+
+void Texture::bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, resident_mip != no_mip ? handle : fallback);
+}
+
+auto Texture::path() const -> const std::string &
+{
+    return file_path;
+}
+
+auto Texture::resident_bytes() const -> size_t
+{
+    return resident_size;
+}
+
+TextureManager::TextureManager(std::shared_ptr<ThreadPool> pool, TextureBudget budget)
+    : pool(std::move(pool)), budget(budget), has_bc1(has_extension("GL_EXT_texture_compression_s3tc")),
+      has_storage(GLAD_GL_VERSION_4_2 != 0), has_copy(GLAD_GL_VERSION_4_3 != 0)
+{
+    const std::array<uint8_t, 4> white = {255, 255, 255, 255};
+    glGenTextures(1, &fallback);
+    glBindTexture(GL_TEXTURE_2D, fallback);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TextureManager::~TextureManager()
+{
+    // Workers only hold copies of what they need, but wait so nothing is still reading files after we're gone
+    for (auto &pending : pending_info)
+    {
+        pending.info.wait();
+    }
+    for (auto &pending : pending_levels)
+    {
+        pending.levels.wait();
+    }
+    glDeleteTextures(1, &fallback);
+}
+
+auto TextureManager::load(const std::string &path) -> std::shared_ptr<Texture>
+{
+    if (auto found = textures.find(path); found != textures.end())
+    {
+        if (auto texture = found->second.lock())
+        {
+            return texture;
+        }
+    }
+    auto texture = std::make_shared<Texture>(path, fallback);
+    textures[path] = texture;
+    auto info = pool->submit([path]() {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error("Can't open texture " + path);
+        }
+        return read_texture_info(file);
+    });
+    pending_info.push_back({texture, std::move(info)});
+    return texture;
+}
+
+auto TextureManager::load_material(const aiMaterial &material, const std::string &directory)
+    -> std::shared_ptr<Texture>
+{
+    aiString source;
+    if (material.GetTextureCount(aiTextureType_DIFFUSE) == 0 ||
+        material.GetTexture(aiTextureType_DIFFUSE, 0, &source) != AI_SUCCESS)
+    {
+        return nullptr;
+    }
+    // Embedded textures are referenced as "*<index>" and have no file to bake from
+    if (source.length > 0 && source.C_Str()[0] == '*')
+    {
+        return nullptr;
+    }
+    auto baked = std::filesystem::path(directory) / source.C_Str();
+    baked.replace_extension(".btex");
+    return load(baked.string());
+}
+
+void TextureManager::set_viewport_height(int height)
+{
+    viewport_height = static_cast<float>(std::max(height, 1));
+}
+
+void TextureManager::set_budget(TextureBudget budget)
+{
+    this->budget = budget;
+}
+
+void TextureManager::update()
+{
+    finish_loads();
+    rebalance();
+}
+
+auto TextureManager::stats() const -> TextureStats
+{
+    size_t resident = 0;
+    for (const auto &[path, weak] : textures)
+    {
+        if (auto texture = weak.lock())
+        {
+            resident += texture->resident_size;
+        }
+    }
+    return {textures.size(), resident, target_bytes, pending_info.size() + pending_levels.size()};
+}
+
+void TextureManager::finish_loads()
+{
+    for (auto pending = pending_info.begin(); pending != pending_info.end();)
+    {
+        if (!is_ready(pending->info))
+        {
+            pending++;
+            continue;
+        }
+        try
+        {
+            pending->texture->info = pending->info.get();
+            pending->texture->has_info = true;
+        }
+        catch (const std::exception &error)
+        {
+            pending->texture->failed = true;
+            std::cerr << "Texture " << pending->texture->file_path << ": " << error.what() << std::endl;
+        }
+        pending = pending_info.erase(pending);
+    }
+
+    for (auto pending = pending_levels.begin(); pending != pending_levels.end();)
+    {
+        if (!is_ready(pending->levels))
+        {
+            pending++;
+            continue;
+        }
+        Texture &texture = *pending->texture;
+        texture.load_in_flight = false;
+        try
+        {
+            LoadedLevels loaded = pending->levels.get();
+            upload(texture, pending->first_mip, loaded);
+        }
+        catch (const std::exception &error)
+        {
+            texture.failed = true;
+            std::cerr << "Texture " << texture.file_path << ": " << error.what() << std::endl;
+        }
+        pending = pending_levels.erase(pending);
+    }
+}
+
+void TextureManager::rebalance()
+{
+    struct Candidate
+    {
+        std::shared_ptr<Texture> texture;
+        float pixels;
+        uint32_t desired;
+        // Ties keep their order so the same textures win each frame
+        size_t order;
+    };
+    std::pmr::vector<Candidate> candidates(&frame_arena());
+    candidates.reserve(textures.size());
+    size_t resident = 0;
+    for (auto entry = textures.begin(); entry != textures.end();)
+    {
+        auto texture = entry->second.lock();
+        if (!texture)
+        {
+            entry = textures.erase(entry);
+            continue;
+        }
+        entry++;
+        resident += texture->resident_size;
+        if (!texture->has_info || texture->failed)
+        {
+            continue;
+        }
+
+        // Unrequested textures fall back to their tail, visible ones want about one texel per pixel
+        const float pixels = texture->requested_fraction * viewport_height;
+        texture->requested_fraction = 0.0F;
+        uint32_t desired = tail_mip(*texture);
+        if (pixels > 0.0F)
+        {
+            const auto texels = static_cast<float>(std::max(texture->info.width, texture->info.height));
+            const auto mip = static_cast<int>(std::floor(std::log2(texels / std::max(pixels, 1.0F))));
+            desired = std::min(static_cast<uint32_t>(std::max(mip, 0)), desired);
+        }
+        candidates.push_back({texture, pixels, desired, candidates.size()});
+    }
+
+    // The most visible textures get their detail first, later ones drop to coarser levels until everything fits and
+    // then out altogether, tails included
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &lhs, const Candidate &rhs) {
+        return lhs.pixels > rhs.pixels || (lhs.pixels == rhs.pixels && lhs.order < rhs.order);
+    });
+    target_bytes = 0;
+    for (auto &candidate : candidates)
+    {
+        const uint32_t tail = tail_mip(*candidate.texture);
+        uint32_t target = candidate.desired;
+        while (target < tail && target_bytes + gpu_size(*candidate.texture, target) > budget.vram_bytes)
+        {
+            target++;
+        }
+        if (target_bytes + gpu_size(*candidate.texture, target) > budget.vram_bytes)
+        {
+            target = Texture::no_mip;
+        }
+        else
+        {
+            target_bytes += gpu_size(*candidate.texture, target);
+        }
+        candidate.texture->target_mip = target;
+    }
+
+    // Evictions and drops in detail are copies on the GPU, done right away so their memory is back before uploads
+    // need it. Dropping a single level is only worth a copy when over budget, which stops textures near a mip
+    // boundary from bouncing every frame. Textures with a load in flight wait for it so it lands in the storage it
+    // was read for.
+    const bool over_budget = resident > budget.vram_bytes;
+    for (auto &candidate : candidates)
+    {
+        Texture &texture = *candidate.texture;
+        if (texture.load_in_flight || texture.storage_mip == Texture::no_mip)
+        {
+            continue;
+        }
+        if (texture.target_mip == Texture::no_mip ||
+            (texture.target_mip > texture.storage_mip &&
+             (over_budget || texture.target_mip > texture.storage_mip + 1)))
+        {
+            resize_storage(texture, texture.target_mip);
+        }
+    }
+
+    // The most visible textures load first. A texture's first load fills its tail, each one after that the next
+    // finer level.
+    for (auto &candidate : candidates)
+    {
+        if (pending_levels.size() >= budget.max_pending_loads)
+        {
+            break;
+        }
+        Texture &texture = *candidate.texture;
+        if (texture.load_in_flight || texture.target_mip == Texture::no_mip ||
+            (texture.resident_mip != Texture::no_mip && texture.target_mip >= texture.resident_mip))
+        {
+            continue;
+        }
+        if (texture.target_mip < texture.storage_mip || texture.storage_mip == Texture::no_mip)
+        {
+            resize_storage(texture, texture.target_mip);
+        }
+        const bool filled = texture.resident_mip != Texture::no_mip;
+        const uint32_t first = filled ? texture.resident_mip - 1 : tail_mip(texture);
+        const auto end = filled ? texture.resident_mip : static_cast<uint32_t>(texture.info.levels.size());
+        texture.load_in_flight = true;
+        // Without driver support BC1 is expanded on the worker, which still saves disk bandwidth
+        const bool decode = texture.info.format == TextureFormat::bc1 && !has_bc1;
+        auto read = [path = texture.file_path, info = texture.info, first, end, decode]() {
+            auto [level_infos, data] = read_levels_from(path, info, first, end, decode);
+            return LoadedLevels{decode ? TextureFormat::rgba8 : info.format, std::move(level_infos), std::move(data)};
+        };
+        pending_levels.push_back({candidate.texture, first, pool->submit(std::move(read))});
+    }
+}
+
+void TextureManager::resize_storage(Texture &texture, uint32_t storage_mip)
+{
+    GLuint handle = 0;
+    uint32_t resident_mip = Texture::no_mip;
+    if (storage_mip != Texture::no_mip)
+    {
+        const auto &levels = texture.info.levels;
+        const auto count = static_cast<GLsizei>(levels.size() - storage_mip);
+        const TextureFormat format = gpu_format(texture);
+        const GLenum internal_format = format == TextureFormat::bc1 ? compressed_rgb_s3tc_dxt1 : GL_RGBA8;
+        glGenTextures(1, &handle);
+        glBindTexture(GL_TEXTURE_2D, handle);
+        if (has_storage)
+        {
+            const MipLevelInfo &first = levels[storage_mip];
+            glTexStorage2D(
+                GL_TEXTURE_2D,
+                count,
+                internal_format,
+                static_cast<GLsizei>(first.width),
+                static_cast<GLsizei>(first.height)
+            );
+        }
+        else
+        {
+            for (GLsizei level = 0; level < count; level++)
+            {
+                const MipLevelInfo &info = levels[storage_mip + static_cast<size_t>(level)];
+                const auto width = static_cast<GLsizei>(info.width);
+                const auto height = static_cast<GLsizei>(info.height);
+                if (format == TextureFormat::bc1)
+                {
+                    const auto size = static_cast<GLsizei>(mip_level_size(format, info.width, info.height));
+                    glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format, width, height, 0, size, nullptr);
+                }
+                else
+                {
+                    glTexImage2D(
+                        GL_TEXTURE_2D, level, internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr
+                    );
+                }
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        // Levels both storages hold move over, anything finer is streamed in afterwards
+        if (texture.resident_mip != Texture::no_mip)
+        {
+            resident_mip = std::max(texture.resident_mip, storage_mip);
+            for (auto level = resident_mip; level < levels.size(); level++)
+            {
+                copy_level(texture, handle, storage_mip, level);
+            }
+            glBindTexture(GL_TEXTURE_2D, handle);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(resident_mip - storage_mip));
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    if (texture.handle != 0)
+    {
+        glDeleteTextures(1, &texture.handle);
+    }
+    texture.handle = handle;
+    texture.storage_mip = storage_mip;
+    texture.resident_mip = resident_mip;
+    texture.resident_size = storage_mip != Texture::no_mip ? gpu_size(texture, storage_mip) : 0;
+}
+
+void TextureManager::copy_level(const Texture &texture, GLuint storage, uint32_t storage_mip, uint32_t level) const
+{
+    const MipLevelInfo &info = texture.info.levels[level];
+    const auto from_level = static_cast<GLint>(level - texture.storage_mip);
+    const auto to_level = static_cast<GLint>(level - storage_mip);
+    if (has_copy)
+    {
+        glCopyImageSubData(
+            texture.handle,
+            GL_TEXTURE_2D,
+            from_level,
+            0,
+            0,
+            0,
+            storage,
+            GL_TEXTURE_2D,
+            to_level,
+            0,
+            0,
+            0,
+            static_cast<GLsizei>(info.width),
+            static_cast<GLsizei>(info.height),
+            1
+        );
+        return;
+    }
+    const TextureFormat format = gpu_format(texture);
+    std::vector<uint8_t> data(mip_level_size(format, info.width, info.height));
+    glBindTexture(GL_TEXTURE_2D, texture.handle);
+    if (format == TextureFormat::bc1)
+    {
+        glGetCompressedTexImage(GL_TEXTURE_2D, from_level, data.data());
+    }
+    else
+    {
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, from_level, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, storage);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    write_level(to_level, format, info, data);
+}
+
+void TextureManager::upload(Texture &texture, uint32_t first_mip, LoadedLevels &loaded)
+{
+    glBindTexture(GL_TEXTURE_2D, texture.handle);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level < loaded.levels.size(); level++)
+    {
+        const auto storage_level = static_cast<GLint>(first_mip + level - texture.storage_mip);
+        write_level(storage_level, loaded.format, loaded.levels[level], loaded.data[level]);
+    }
+    texture.resident_mip = first_mip;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(first_mip - texture.storage_mip));
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+auto TextureManager::gpu_format(const Texture &texture) const -> TextureFormat
+{
+    return texture.info.format == TextureFormat::bc1 && has_bc1 ? TextureFormat::bc1 : TextureFormat::rgba8;
+}
+
+auto TextureManager::gpu_size(const Texture &texture, uint32_t first_mip) const -> size_t
+{
+    const TextureFormat format = gpu_format(texture);
+    size_t size = 0;
+    for (size_t level = first_mip; level < texture.info.levels.size(); level++)
+    {
+        size += mip_level_size(format, texture.info.levels[level].width, texture.info.levels[level].height);
+    }
+    return size;
+}
+
+auto TextureManager::tail_mip(const Texture &texture) const -> uint32_t
+{
+    const auto &levels = texture.info.levels;
+    for (size_t level = 0; level < levels.size(); level++)
+    {
+        if (std::max(levels[level].width, levels[level].height) <= budget.tail_size)
+        {
+            return static_cast<uint32_t>(level);
+        }
+    }
+    return static_cast<uint32_t>(levels.size() - 1);
+}
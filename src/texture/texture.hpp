@@ -0,0 +1,133 @@
+#pragma once
+
+#include "../core/thread_pool.hpp"
+#include "texture_file.hpp"
+#include <assimp/material.h>
+#include <cstdint>
+#include <future>
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextureBudget
+{
+    // Total size of texture storage across every texture, tails included. Less visible textures drop detail first,
+    // and once even their tail doesn't fit they're evicted whole and bind the white fallback.
+    size_t vram_bytes = size_t{256} * 1024 * 1024;
+    // Upper bound on level data being read by workers at once, which also bounds staging memory
+    size_t max_pending_loads = 4;
+    // Levels no larger than this are kept whenever a texture has anything resident
+    uint32_t tail_size = 64;
+};
+
+struct TextureStats
+{
+    size_t textures;
+    size_t resident_bytes;
+    size_t target_bytes;
+    size_t pending_loads;
+};
+
+// Streamed texture from a baked file. Immutable storage holds levels [storage_mip, last], filled from the tail
+// towards storage_mip a level at a time, and GL_TEXTURE_BASE_LEVEL starts sampling at resident_mip, the finest level
+// filled so far. Moving storage_mip makes new storage and copies the levels both hold on the GPU, deleting the old
+// storage in the same update, so no second copy outlives it.
+class Texture
+{
+  public:
+    Texture(std::string path, GLuint fallback);
+    Texture(const Texture &) = delete;
+    Texture(Texture &&) = delete;
+    auto operator=(const Texture &) -> Texture & = delete;
+    auto operator=(Texture &&) -> Texture & = delete;
+    ~Texture();
+    // Reports how much of the screen height the texture covers this frame, the largest request wins
+    void request(float screen_fraction);
+    // Binds whatever is resident, or a white texel while nothing is
+    void bind(GLuint unit) const;
+    [[nodiscard]] auto path() const -> const std::string &;
+    [[nodiscard]] auto resident_bytes() const -> size_t;
+
+  private:
+    friend class TextureManager;
+    static const uint32_t no_mip = UINT32_MAX;
+    std::string file_path;
+    GLuint fallback;
+    GLuint handle{};
+    bool has_info{};
+    bool failed{};
+    bool load_in_flight{};
+    TextureFileInfo info{};
+    uint32_t storage_mip{no_mip};
+    uint32_t resident_mip{no_mip};
+    uint32_t target_mip{no_mip};
+    // Bytes of storage, whether or not every level in it is filled yet
+    size_t resident_size{};
+    float requested_fraction{};
+};
+
+// Owns every streamed texture. Files are read and decoded on the pool, the GL calls happen in update() on the thread
+// owning the context, and residency is rebalanced every update to fit the budget.
+class TextureManager
+{
+  public:
+    explicit TextureManager(std::shared_ptr<ThreadPool> pool, TextureBudget budget = {});
+    TextureManager(const TextureManager &) = delete;
+    TextureManager(TextureManager &&) = delete;
+    auto operator=(const TextureManager &) -> TextureManager & = delete;
+    auto operator=(TextureManager &&) -> TextureManager & = delete;
+    ~TextureManager();
+    // Returns the texture for path, shared with anything else that loaded it
+    auto load(const std::string &path) -> std::shared_ptr<Texture>;
+    // Diffuse texture of an Assimp material, pointing at the baked copy next to the source image
+    auto load_material(const aiMaterial &material, const std::string &directory) -> std::shared_ptr<Texture>;
+    void set_viewport_height(int height);
+    void set_budget(TextureBudget budget);
+    // Call once per frame after drawing
+    void update();
+    [[nodiscard]] auto stats() const -> TextureStats;
+
+  private:
+    struct LoadedLevels
+    {
+        TextureFormat format;
+        std::vector<MipLevelInfo> levels;
+        std::vector<std::vector<uint8_t>> data;
+    };
+    struct PendingInfo
+    {
+        std::shared_ptr<Texture> texture;
+        std::future<TextureFileInfo> info;
+    };
+    struct PendingLevels
+    {
+        std::shared_ptr<Texture> texture;
+        uint32_t first_mip;
+        std::future<LoadedLevels> levels;
+    };
+    void finish_loads();
+    void rebalance();
+    // Replaces the texture's storage with levels [storage_mip, last], no_mip deleting it
+    void resize_storage(Texture &texture, uint32_t storage_mip);
+    void copy_level(const Texture &texture, GLuint storage, uint32_t storage_mip, uint32_t level) const;
+    // Fills levels [first_mip, first_mip + loaded levels) of the storage
+    void upload(Texture &texture, uint32_t first_mip, LoadedLevels &loaded);
+    [[nodiscard]] auto gpu_format(const Texture &texture) const -> TextureFormat;
+    [[nodiscard]] auto gpu_size(const Texture &texture, uint32_t first_mip) const -> size_t;
+    [[nodiscard]] auto tail_mip(const Texture &texture) const -> uint32_t;
+    std::shared_ptr<ThreadPool> pool;
+    TextureBudget budget;
+    bool has_bc1{};
+    // glTexStorage2D, otherwise storage is every level given null data
+    bool has_storage{};
+    // glCopyImageSubData, otherwise kept levels are read back and uploaded again
+    bool has_copy{};
+    GLuint fallback{};
+    float viewport_height{1.0F};
+    std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+    std::vector<PendingInfo> pending_info;
+    std::vector<PendingLevels> pending_levels;
+    size_t target_bytes{};
+};
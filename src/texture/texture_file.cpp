@@ -0,0 +1,156 @@
+#include "texture_file.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+const size_t bc1_block_bytes = 8;
+const uint32_t bc1_block_size = 4;
+const size_t rgba8_bytes = 4;
+// Well past anything a GL 3.3 driver will allocate, only there to keep level sizes from overflowing
+const uint32_t max_texture_size = 65536;
+
+template <typename T> void write_value(std::ostream &stream, const T &value)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> auto read_value(std::istream &stream) -> T
+{
+    T value{};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.read(reinterpret_cast<char *>(&value), sizeof(T));
+    if (!stream)
+    {
+        throw std::runtime_error("Texture file truncated");
+    }
+    return value;
+}
+} // namespace
+
+auto mip_level_size(TextureFormat format, uint32_t width, uint32_t height) -> size_t
+{
+    switch (format)
+    {
+    case TextureFormat::bc1:
+        return static_cast<size_t>(std::max(1U, (width + bc1_block_size - 1) / bc1_block_size)) *
+               std::max(1U, (height + bc1_block_size - 1) / bc1_block_size) * bc1_block_bytes;
+    case TextureFormat::rgba8:
+    default:
+        return static_cast<size_t>(width) * height * rgba8_bytes;
+    }
+}
+
+auto mip_count(uint32_t width, uint32_t height) -> uint32_t
+{
+    uint32_t count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1U, width / 2);
+        height = std::max(1U, height / 2);
+        count++;
+    }
+    return count;
+}
+
+auto read_texture_info(std::istream &stream) -> TextureFileInfo
+{
+    auto magic = read_value<std::array<char, 4>>(stream);
+    if (magic != texture_file_magic)
+    {
+        throw std::runtime_error("Not a baked texture file");
+    }
+    if (read_value<uint32_t>(stream) != texture_file_version)
+    {
+        throw std::runtime_error("Unsupported baked texture version");
+    }
+    TextureFileInfo info{};
+    info.format = read_value<TextureFormat>(stream);
+    if (info.format != TextureFormat::rgba8 && info.format != TextureFormat::bc1)
+    {
+        throw std::runtime_error("Unknown baked texture format");
+    }
+    info.width = read_value<uint32_t>(stream);
+    info.height = read_value<uint32_t>(stream);
+    if (info.width == 0 || info.height == 0 || info.width > max_texture_size || info.height > max_texture_size)
+    {
+        throw std::runtime_error("Baked texture has invalid dimensions");
+    }
+    const auto level_count = read_value<uint32_t>(stream);
+    if (level_count == 0 || level_count > mip_count(info.width, info.height))
+    {
+        throw std::runtime_error("Baked texture has an invalid mip chain");
+    }
+    info.levels.reserve(level_count);
+    for (uint32_t level = 0; level < level_count; level++)
+    {
+        info.levels.push_back(read_value<MipLevelInfo>(stream));
+    }
+
+    // Everything after this is trusted by the loader, so check the table against the chain and the file itself
+    const auto header_end = static_cast<uint64_t>(stream.tellg());
+    stream.seekg(0, std::ios::end);
+    const auto file_size = static_cast<uint64_t>(stream.tellg());
+    if (!stream)
+    {
+        throw std::runtime_error("Can't find the size of the baked texture");
+    }
+    uint32_t level_width = info.width;
+    uint32_t level_height = info.height;
+    for (const MipLevelInfo &level : info.levels)
+    {
+        if (level.width != level_width || level.height != level_height)
+        {
+            throw std::runtime_error("Baked texture mip level has the wrong dimensions");
+        }
+        if (level.size != mip_level_size(info.format, level.width, level.height))
+        {
+            throw std::runtime_error("Baked texture mip level has the wrong size");
+        }
+        if (level.offset < header_end || level.offset > file_size || level.size > file_size - level.offset)
+        {
+            throw std::runtime_error("Baked texture mip level lies outside the file");
+        }
+        level_width = std::max(1U, level_width / 2);
+        level_height = std::max(1U, level_height / 2);
+    }
+    return info;
+}
+
+void write_texture_file(
+    std::ostream &stream, TextureFormat format, uint32_t width, uint32_t height,
+    const std::vector<std::vector<uint8_t>> &levels
+)
+{
+    write_value(stream, texture_file_magic);
+    write_value(stream, texture_file_version);
+    write_value(stream, format);
+    write_value(stream, width);
+    write_value(stream, height);
+    write_value(stream, static_cast<uint32_t>(levels.size()));
+
+    uint64_t offset = texture_file_magic.size() + (sizeof(uint32_t) * 5) + (levels.size() * sizeof(MipLevelInfo));
+    uint32_t level_width = width;
+    uint32_t level_height = height;
+    for (const auto &level : levels)
+    {
+        if (level.size() != mip_level_size(format, level_width, level_height))
+        {
+            throw std::runtime_error("Mip level size doesn't match its dimensions");
+        }
+        write_value(stream, MipLevelInfo{offset, level.size(), level_width, level_height});
+        offset += level.size();
+        level_width = std::max(1U, level_width / 2);
+        level_height = std::max(1U, level_height / 2);
+    }
+    for (const auto &level : levels)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        stream.write(reinterpret_cast<const char *>(level.data()), static_cast<std::streamsize>(level.size()));
+    }
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to write baked texture");
+    }
+}
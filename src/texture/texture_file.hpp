@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// Baked texture container written by texbake: a header, a table of mip levels, then each level's data. Levels are
+// stored largest first and are individually addressable, so residency can stream single levels from disk.
+enum class TextureFormat : uint32_t
+{
+    rgba8 = 0,
+    // 4x4 blocks of 8 bytes, opaque only
+    bc1 = 1,
+};
+
+struct MipLevelInfo
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct TextureFileInfo
+{
+    TextureFormat format;
+    uint32_t width;
+    uint32_t height;
+    std::vector<MipLevelInfo> levels;
+};
+
+const std::array<char, 4> texture_file_magic = {'B', 'T', 'E', 'X'};
+const uint32_t texture_file_version = 1;
+
+auto mip_level_size(TextureFormat format, uint32_t width, uint32_t height) -> size_t;
+// Number of levels in a full chain down to 1x1
+auto mip_count(uint32_t width, uint32_t height) -> uint32_t;
+// Checks the level table against the dimensions and the length of the stream, leaving the stream at its end
+auto read_texture_info(std::istream &stream) -> TextureFileInfo;
+// levels must hold the full chain, largest first, already encoded in format
+void write_texture_file(
+    std::ostream &stream, TextureFormat format, uint32_t width, uint32_t height,
+    const std::vector<std::vector<uint8_t>> &levels
+);
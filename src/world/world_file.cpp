@@ -0,0 +1,181 @@
+#include "world_file.hpp"
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+template <typename T> void write_value(std::ostream &stream, const T &value)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> void write_array(std::ostream &stream, const std::vector<T> &values)
+{
+    write_value(stream, static_cast<uint64_t>(values.size()));
+    const auto size = static_cast<std::streamsize>(values.size() * sizeof(T));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.write(reinterpret_cast<const char *>(values.data()), size);
+}
+
+template <typename T> auto read_value(std::istream &stream) -> T
+{
+    T value{};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.read(reinterpret_cast<char *>(&value), sizeof(T));
+    if (!stream)
+    {
+        throw std::runtime_error("World file truncated");
+    }
+    return value;
+}
+
+template <typename T> auto read_array(std::istream &stream, uint64_t limit_bytes) -> std::vector<T>
+{
+    const auto count = read_value<uint64_t>(stream);
+    if (count * sizeof(T) > limit_bytes)
+    {
+        throw std::runtime_error("World file corrupt");
+    }
+    std::vector<T> values(count);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    if (!stream)
+    {
+        throw std::runtime_error("World file truncated");
+    }
+    return values;
+}
+
+auto index_size(size_t chunk_count) -> uint64_t
+{
+    return sizeof(world_file_magic) + sizeof(world_file_version) + sizeof(float) + sizeof(uint32_t) +
+           chunk_count * sizeof(ChunkEntry);
+}
+} // namespace
+
+auto read_world_index(std::istream &stream) -> WorldIndex
+{
+    if (read_value<std::array<char, 4>>(stream) != world_file_magic)
+    {
+        throw std::runtime_error("Not a world file");
+    }
+    if (read_value<uint32_t>(stream) != world_file_version)
+    {
+        throw std::runtime_error("Unsupported world file version");
+    }
+    WorldIndex index{};
+    index.chunk_size = read_value<float>(stream);
+    index.chunks.resize(read_value<uint32_t>(stream));
+    for (auto &entry : index.chunks)
+    {
+        entry = read_value<ChunkEntry>(stream);
+    }
+    return index;
+}
+
+auto read_chunk(std::istream &stream, const ChunkEntry &entry) -> ChunkData
+{
+    stream.seekg(static_cast<std::streamoff>(entry.offset));
+    ChunkData chunk;
+    chunk.meshes.resize(read_value<uint32_t>(stream));
+    for (auto &mesh : chunk.meshes)
+    {
+        mesh.lods.resize(read_value<uint32_t>(stream));
+        if (mesh.lods.empty() || mesh.lods.size() > max_mesh_lods)
+        {
+            throw std::runtime_error("World chunk mesh has an invalid level of detail count");
+        }
+        for (auto &lod : mesh.lods)
+        {
+            lod = read_array<WorldVertex>(stream, entry.size);
+        }
+    }
+    chunk.instances = read_array<WorldInstance>(stream, entry.size);
+    for (const auto &instance : chunk.instances)
+    {
+        if (instance.mesh >= chunk.meshes.size())
+        {
+            throw std::runtime_error("World chunk instance references a missing mesh");
+        }
+    }
+    return chunk;
+}
+
+void write_world(
+    std::ostream &stream, float chunk_size, std::vector<ChunkEntry> entries, const std::vector<ChunkData> &chunks
+)
+{
+    if (entries.size() != chunks.size())
+    {
+        throw std::invalid_argument("write_world needs one entry per chunk");
+    }
+    // Payloads are serialised first so the index can hold their offsets and sizes
+    std::vector<std::string> payloads;
+    uint64_t offset = index_size(entries.size());
+    for (size_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++)
+    {
+        const ChunkData &chunk = chunks[chunk_idx];
+        ChunkEntry &entry = entries[chunk_idx];
+        std::ostringstream payload;
+        write_value(payload, static_cast<uint32_t>(chunk.meshes.size()));
+        entry.gpu_size = 0;
+        for (const auto &mesh : chunk.meshes)
+        {
+            if (mesh.lods.empty() || mesh.lods.size() > max_mesh_lods)
+            {
+                throw std::invalid_argument("World meshes need between 1 and max_mesh_lods levels of detail");
+            }
+            write_value(payload, static_cast<uint32_t>(mesh.lods.size()));
+            for (const auto &lod : mesh.lods)
+            {
+                write_array(payload, lod);
+                entry.gpu_size += lod.size() * sizeof(WorldVertex);
+            }
+        }
+        write_array(payload, chunk.instances);
+
+        bool first = true;
+        for (const auto &instance : chunk.instances)
+        {
+            const auto &vertices = chunk.meshes.at(instance.mesh).lods.at(0);
+            if (vertices.empty())
+            {
+                continue;
+            }
+            Bounds mesh_bounds{vertices[0].position, vertices[0].position};
+            for (const auto &vertex : vertices)
+            {
+                mesh_bounds.min = glm::min(mesh_bounds.min, vertex.position);
+                mesh_bounds.max = glm::max(mesh_bounds.max, vertex.position);
+            }
+            const Bounds placed = transform_bounds(mesh_bounds, instance.transform);
+            entry.bounds.min = first ? placed.min : glm::min(entry.bounds.min, placed.min);
+            entry.bounds.max = first ? placed.max : glm::max(entry.bounds.max, placed.max);
+            first = false;
+        }
+
+        payloads.push_back(payload.str());
+        entry.offset = offset;
+        entry.size = payloads.back().size();
+        offset += entry.size;
+    }
+
+    write_value(stream, world_file_magic);
+    write_value(stream, world_file_version);
+    write_value(stream, chunk_size);
+    write_value(stream, static_cast<uint32_t>(entries.size()));
+    for (const auto &entry : entries)
+    {
+        write_value(stream, entry);
+    }
+    for (const auto &payload : payloads)
+    {
+        stream.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    }
+    if (!stream)
+    {
+        throw std::runtime_error("Failed to write world file");
+    }
+}
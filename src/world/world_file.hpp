@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../scene/mesh.hpp"
+#include "../scene/node.hpp"
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Every world mesh is vertex coloured and lit
+using WorldVertex = VertexAttributes<true, true, 0>;
+
+struct WorldInstance
+{
+    uint32_t mesh;
+    glm::mat4 transform;
+    MaterialValues material;
+};
+
+// Meshes carry up to this many levels of detail, the GPU driven path picks one per instance by distance
+const size_t max_mesh_lods = 4;
+
+struct ChunkMesh
+{
+    // Full detail first, each level coarser than the last
+    std::vector<std::vector<WorldVertex>> lods;
+};
+
+struct ChunkData
+{
+    std::vector<ChunkMesh> meshes;
+    std::vector<WorldInstance> instances;
+};
+
+// Index entry of one chunk, enough to decide whether to stream it in without reading it
+struct ChunkEntry
+{
+    int32_t x;
+    int32_t z;
+    Bounds bounds;
+    uint64_t offset;
+    uint64_t size;
+    // Vertex buffer bytes of every level once uploaded
+    uint64_t gpu_size;
+};
+
+struct WorldIndex
+{
+    float chunk_size;
+    std::vector<ChunkEntry> chunks;
+};
+
+// World files are the index followed by each chunk's payload, chunks are read individually by seeking to their offset
+const std::array<char, 4> world_file_magic = {'G', 'W', 'L', 'D'};
+const uint32_t world_file_version = 2;
+
+auto read_world_index(std::istream &stream) -> WorldIndex;
+auto read_chunk(std::istream &stream, const ChunkEntry &entry) -> ChunkData;
+// Chunk bounds and sizes in the index are filled in from the data, only the coordinates of each entry are used
+void write_world(
+    std::ostream &stream, float chunk_size, std::vector<ChunkEntry> entries, const std::vector<ChunkData> &chunks
+);
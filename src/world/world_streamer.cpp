@@ -0,0 +1,350 @@
+#include "world_streamer.hpp"
+#include "../core/arena.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+using WorldMesh = Mesh<true, true, 0>;
+using WorldNode = Node<false, true, true, 0>;
+
+auto chunk_key(int32_t x, int32_t z) -> uint64_t
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32U) | static_cast<uint32_t>(z);
+}
+
+auto distance_to(const Bounds &bounds, glm::vec3 point) -> float
+{
+    return glm::length(glm::max(glm::max(bounds.min - point, point - bounds.max), glm::vec3(0.0F)));
+}
+} // namespace
+
+WorldStreamer::WorldStreamer(
+    const std::string &path, std::shared_ptr<ThreadPool> pool, std::shared_ptr<WorldShader> shader, Scene &scene,
+    StreamingSettings settings
+)
+    : path(path), pool(std::move(pool)), shader(std::move(shader)), scene(scene), settings(settings)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        throw std::runtime_error("Can't open world " + path);
+    }
+    world = read_world_index(stream);
+    chunks.resize(world.chunks.size());
+    for (size_t chunk_idx = 0; chunk_idx < world.chunks.size(); chunk_idx++)
+    {
+        chunk_lookup[chunk_key(world.chunks[chunk_idx].x, world.chunks[chunk_idx].z)] = chunk_idx;
+    }
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    for (auto &chunk : chunks)
+    {
+        if (chunk.load.valid())
+        {
+            chunk.load.wait();
+        }
+    }
+    while (!active.empty())
+    {
+        unload(active.back());
+    }
+}
+
+void WorldStreamer::update(glm::vec3 position, glm::vec3 velocity)
+{
+    const auto start = std::chrono::steady_clock::now();
+    finish_loads();
+
+    // Chunks ahead of the camera get a head start proportional to how soon it reaches them
+    const glm::vec3 motion = velocity * settings.lookahead;
+    auto priority_of = [&](const ChunkEntry &entry) {
+        const glm::vec3 centre = (entry.bounds.min + entry.bounds.max) / 2.0F;
+        const glm::vec3 offset = centre - position;
+        const float length = glm::length(offset);
+        const float ahead = length > 0.0F ? glm::dot(motion, offset / length) : 0.0F;
+        return std::max(0.0F, distance_to(entry.bounds, position) - ahead);
+    };
+
+    // Unloading first frees memory for this frame's loads, chunks still being read are dropped once they finish
+    for (size_t active_idx = active.size(); active_idx-- > 0;)
+    {
+        const size_t chunk_idx = active[active_idx];
+        chunks[chunk_idx].priority = priority_of(world.chunks[chunk_idx]);
+        if (chunks[chunk_idx].state != ChunkState::loading &&
+            distance_to(world.chunks[chunk_idx].bounds, position) > settings.unload_radius)
+        {
+            unload(chunk_idx);
+        }
+    }
+
+    // Only cells within the load radius are visited, so the cost doesn't grow with the world
+    const float radius = std::max(settings.load_radius, settings.required_radius);
+    const auto first_x = static_cast<int32_t>(std::floor((position.x - radius) / world.chunk_size));
+    const auto last_x = static_cast<int32_t>(std::floor((position.x + radius) / world.chunk_size));
+    const auto first_z = static_cast<int32_t>(std::floor((position.z - radius) / world.chunk_size));
+    const auto last_z = static_cast<int32_t>(std::floor((position.z + radius) / world.chunk_size));
+    std::pmr::vector<size_t> candidates(&frame_arena());
+    bool stalled = false;
+    for (int32_t x = first_x; x <= last_x; x++)
+    {
+        for (int32_t z = first_z; z <= last_z; z++)
+        {
+            auto found = chunk_lookup.find(chunk_key(x, z));
+            if (found == chunk_lookup.end())
+            {
+                continue;
+            }
+            const ChunkEntry &entry = world.chunks[found->second];
+            const float distance = distance_to(entry.bounds, position);
+            Chunk &chunk = chunks[found->second];
+            stalled |= distance < settings.required_radius && chunk.state != ChunkState::resident &&
+                       chunk.state != ChunkState::failed;
+            if (chunk.state == ChunkState::unloaded && distance <= settings.load_radius)
+            {
+                chunk.priority = priority_of(entry);
+                candidates.push_back(found->second);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](size_t lhs, size_t rhs) {
+        return chunks[lhs].priority < chunks[rhs].priority;
+    });
+
+    size_t pending = std::count_if(active.begin(), active.end(), [&](size_t chunk_idx) {
+        return chunks[chunk_idx].state == ChunkState::loading;
+    });
+    for (size_t chunk_idx : candidates)
+    {
+        if (pending >= settings.max_pending_loads)
+        {
+            break;
+        }
+        const ChunkEntry &entry = world.chunks[chunk_idx];
+        if (!make_room(entry.size + entry.gpu_size, chunks[chunk_idx].priority))
+        {
+            break;
+        }
+        Chunk &chunk = chunks[chunk_idx];
+        chunk.state = ChunkState::loading;
+        chunk.load = pool->submit([file = path, entry]() {
+            std::ifstream stream(file, std::ios::binary);
+            return read_chunk(stream, entry);
+        });
+        active.push_back(chunk_idx);
+        pending++;
+    }
+
+    // Nearest chunks are uploaded first, spread over frames to bound the time spent here
+    std::pmr::vector<size_t> ready(&frame_arena());
+    for (size_t chunk_idx : active)
+    {
+        if (chunks[chunk_idx].state == ChunkState::loaded)
+        {
+            ready.push_back(chunk_idx);
+        }
+    }
+    std::sort(ready.begin(), ready.end(), [&](size_t lhs, size_t rhs) {
+        return chunks[lhs].priority < chunks[rhs].priority;
+    });
+    size_t uploaded = 0;
+    for (size_t chunk_idx : ready)
+    {
+        const ChunkEntry &entry = world.chunks[chunk_idx];
+        if (uploaded > 0 && uploaded + entry.gpu_size > settings.upload_budget)
+        {
+            break;
+        }
+        upload(chunks[chunk_idx]);
+        uploaded += entry.gpu_size;
+    }
+
+    const float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    counters.frames++;
+    counters.stalled_frames += stalled ? 1 : 0;
+    counters.last_update_ms = elapsed;
+    counters.max_update_ms = std::max(counters.max_update_ms, elapsed);
+    counters.peak_bytes = std::max(counters.peak_bytes, memory_used());
+}
+
+void WorldStreamer::set_settings(StreamingSettings settings)
+{
+    this->settings = settings;
+}
+
+auto WorldStreamer::stats() const -> StreamingStats
+{
+    StreamingStats stats = counters;
+    stats.resident_chunks = 0;
+    stats.pending_loads = 0;
+    stats.cpu_bytes = 0;
+    stats.gpu_bytes = 0;
+    for (size_t chunk_idx : active)
+    {
+        const ChunkEntry &entry = world.chunks[chunk_idx];
+        switch (chunks[chunk_idx].state)
+        {
+        case ChunkState::loading:
+            stats.pending_loads++;
+            stats.cpu_bytes += entry.size;
+            break;
+        case ChunkState::loaded:
+            stats.cpu_bytes += entry.size;
+            break;
+        case ChunkState::resident:
+            stats.resident_chunks++;
+            stats.gpu_bytes += entry.gpu_size;
+            break;
+        case ChunkState::unloaded:
+        case ChunkState::failed:
+            break;
+        }
+    }
+    return stats;
+}
+
+auto WorldStreamer::index() const -> const WorldIndex &
+{
+    return world;
+}
+
+void WorldStreamer::finish_loads()
+{
+    std::pmr::vector<size_t> failed(&frame_arena());
+    for (size_t chunk_idx : active)
+    {
+        Chunk &chunk = chunks[chunk_idx];
+        if (chunk.state == ChunkState::loading &&
+            chunk.load.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            try
+            {
+                chunk.data = chunk.load.get();
+                chunk.state = ChunkState::loaded;
+            }
+            catch (const std::exception &error)
+            {
+                // A chunk that didn't read once won't next time either, so it stays a hole instead of being retried
+                const ChunkEntry &entry = world.chunks[chunk_idx];
+                std::cerr << "World chunk (" << entry.x << ", " << entry.z << "): " << error.what() << std::endl;
+                chunk.state = ChunkState::failed;
+                failed.push_back(chunk_idx);
+            }
+        }
+    }
+    for (size_t chunk_idx : failed)
+    {
+        active.erase(std::find(active.begin(), active.end(), chunk_idx));
+        counters.failed_loads++;
+    }
+}
+
+void WorldStreamer::upload(Chunk &chunk)
+{
+    // The GPU driven scene takes every level of detail, nodes only the full detail mesh
+    chunk.gpu = scene.gpu_scene();
+    if (chunk.gpu)
+    {
+        for (const auto &mesh : chunk.data.meshes)
+        {
+            chunk.gpu_meshes.push_back(chunk.gpu->add_mesh(mesh.lods));
+        }
+        for (const auto &instance : chunk.data.instances)
+        {
+            chunk.gpu_instances.push_back(
+                chunk.gpu->add_instance(chunk.gpu_meshes.at(instance.mesh), instance.transform, instance.material)
+            );
+        }
+    }
+    else
+    {
+        std::vector<std::shared_ptr<WorldMesh>> meshes;
+        meshes.reserve(chunk.data.meshes.size());
+        for (auto &mesh : chunk.data.meshes)
+        {
+            meshes.push_back(std::make_shared<WorldMesh>(mesh.lods[0]));
+        }
+        for (const auto &instance : chunk.data.instances)
+        {
+            auto node =
+                std::make_shared<WorldNode>(meshes[instance.mesh], shader, instance.transform, instance.material);
+            scene.add_node(node);
+            chunk.nodes.push_back(node);
+        }
+    }
+    // Vertex data now lives on the GPU only
+    chunk.data = {};
+    chunk.state = ChunkState::resident;
+    counters.loads++;
+}
+
+void WorldStreamer::unload(size_t chunk_idx)
+{
+    Chunk &chunk = chunks[chunk_idx];
+    if (chunk.state == ChunkState::loading)
+    {
+        chunk.load.wait();
+        chunk.load = {};
+    }
+    scene.remove_nodes(chunk.nodes);
+    chunk.nodes.clear();
+    if (chunk.gpu)
+    {
+        for (uint32_t instance : chunk.gpu_instances)
+        {
+            chunk.gpu->remove_instance(instance);
+        }
+        for (uint32_t mesh : chunk.gpu_meshes)
+        {
+            chunk.gpu->remove_mesh(mesh);
+        }
+        chunk.gpu_instances.clear();
+        chunk.gpu_meshes.clear();
+        chunk.gpu = nullptr;
+    }
+    chunk.data = {};
+    chunk.state = ChunkState::unloaded;
+    active.erase(std::find(active.begin(), active.end(), chunk_idx));
+    counters.unloads++;
+}
+
+auto WorldStreamer::make_room(size_t bytes, float priority) -> bool
+{
+    if (memory_used() + bytes <= settings.memory_budget)
+    {
+        return true;
+    }
+    std::pmr::vector<size_t> evictable(&frame_arena());
+    for (size_t chunk_idx : active)
+    {
+        if (chunks[chunk_idx].state != ChunkState::loading && chunks[chunk_idx].priority > priority)
+        {
+            evictable.push_back(chunk_idx);
+        }
+    }
+    // Furthest first
+    std::sort(evictable.begin(), evictable.end(), [&](size_t lhs, size_t rhs) {
+        return chunks[lhs].priority > chunks[rhs].priority;
+    });
+    for (size_t chunk_idx : evictable)
+    {
+        if (memory_used() + bytes <= settings.memory_budget)
+        {
+            break;
+        }
+        unload(chunk_idx);
+    }
+    return memory_used() + bytes <= settings.memory_budget;
+}
+
+auto WorldStreamer::memory_used() const -> size_t
+{
+    const StreamingStats current = stats();
+    return current.cpu_bytes + current.gpu_bytes;
+}
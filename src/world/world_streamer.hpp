@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../core/thread_pool.hpp"
+#include "../scene/scene.hpp"
+#include "world_file.hpp"
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct StreamingSettings
+{
+    // Chunks whose bounds come within load_radius are streamed in, and only dropped past unload_radius
+    float load_radius = 300.0F;
+    float unload_radius = 400.0F;
+    // Chunks nearer than this should always be resident, a frame where one isn't counts as a stall
+    float required_radius = 100.0F;
+    // Seconds of camera motion to anticipate, chunks ahead of the camera are loaded first
+    float lookahead = 1.0F;
+    // Chunk data read or waiting for upload plus uploaded vertex buffers
+    size_t memory_budget = size_t{512} * 1024 * 1024;
+    // Vertex bytes uploaded per update, at least one chunk is always uploaded when one is waiting
+    size_t upload_budget = size_t{8} * 1024 * 1024;
+    size_t max_pending_loads = 4;
+};
+
+struct StreamingStats
+{
+    size_t resident_chunks;
+    size_t pending_loads;
+    size_t cpu_bytes;
+    size_t gpu_bytes;
+    size_t peak_bytes;
+    size_t loads;
+    size_t unloads;
+    size_t failed_loads;
+    size_t frames;
+    size_t stalled_frames;
+    float last_update_ms;
+    float max_update_ms;
+};
+
+using WorldShader = ShaderProgram<false, true, true, 0>;
+
+// Streams chunks of a world file into a scene around the camera. Chunk files are read on the pool, meshes are
+// created and nodes added in update(), which must run on the thread owning the GL context.
+class WorldStreamer
+{
+  public:
+    WorldStreamer(
+        const std::string &path, std::shared_ptr<ThreadPool> pool, std::shared_ptr<WorldShader> shader, Scene &scene,
+        StreamingSettings settings = {}
+    );
+    WorldStreamer(const WorldStreamer &) = delete;
+    WorldStreamer(WorldStreamer &&) = delete;
+    auto operator=(const WorldStreamer &) -> WorldStreamer & = delete;
+    auto operator=(WorldStreamer &&) -> WorldStreamer & = delete;
+    // Waits for loads in flight, which hold a reference to the file path only
+    ~WorldStreamer();
+    // Call once per frame with the camera's position and velocity in units per second. Chunks that fail to read are
+    // logged and skipped rather than thrown out of here.
+    void update(glm::vec3 position, glm::vec3 velocity);
+    void set_settings(StreamingSettings settings);
+    [[nodiscard]] auto stats() const -> StreamingStats;
+    [[nodiscard]] auto index() const -> const WorldIndex &;
+
+  private:
+    enum class ChunkState
+    {
+        unloaded,
+        loading,
+        loaded,
+        resident,
+        // Reading the chunk threw, it's left out of the world from then on
+        failed,
+    };
+    struct Chunk
+    {
+        ChunkState state{ChunkState::unloaded};
+        std::future<ChunkData> load;
+        ChunkData data;
+        std::vector<std::shared_ptr<VirtualNode>> nodes;
+        // Set instead of nodes when the chunk went to the scene's GPU driven path
+        std::shared_ptr<GpuScene> gpu;
+        std::vector<uint32_t> gpu_meshes;
+        std::vector<uint32_t> gpu_instances;
+        float priority{};
+    };
+    void finish_loads();
+    void upload(Chunk &chunk);
+    void unload(size_t chunk_idx);
+    // Makes room for bytes by unloading chunks further away than priority, returns whether it fit
+    auto make_room(size_t bytes, float priority) -> bool;
+    [[nodiscard]] auto memory_used() const -> size_t;
+    std::string path;
+    std::shared_ptr<ThreadPool> pool;
+    std::shared_ptr<WorldShader> shader;
+    Scene &scene;
+    StreamingSettings settings;
+    WorldIndex world;
+    std::vector<Chunk> chunks;
+    std::unordered_map<uint64_t, size_t> chunk_lookup;
+    // Chunks that aren't unloaded, the only ones checked for unloading
+    std::vector<size_t> active;
+    StreamingStats counters{};
+};
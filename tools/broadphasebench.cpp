@@ -0,0 +1,169 @@
+// Times Broadphase updates for bodies drifting through a box, spread uniformly and packed into a few dense clusters.
+// Each tick moves every body a little, updates its bounds and runs both methods, checking they agree on the pairs.
+//
+//     broadphasebench [bodies] [ticks] [threads]
+#include "physics/broadphase.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Body
+{
+    glm::vec3 position;
+    glm::vec3 velocity;
+    float half_size;
+};
+
+const float world_size = 1000.0F;
+
+auto uniform_bodies(size_t count) -> std::vector<Body>
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(0.0F, world_size);
+    std::uniform_real_distribution<float> velocity(-1.0F, 1.0F);
+    std::uniform_real_distribution<float> half_size(0.5F, 1.5F);
+    std::vector<Body> bodies(count);
+    for (Body &body : bodies)
+    {
+        body = {
+            {position(random), position(random), position(random)},
+            {velocity(random), velocity(random), velocity(random)},
+            half_size(random),
+        };
+    }
+    return bodies;
+}
+
+// A few hundred bodies in each of 32 clusters, crowded enough that most touch several neighbours
+auto clustered_bodies(size_t count) -> std::vector<Body>
+{
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> position(0.0F, world_size);
+    std::normal_distribution<float> offset(0.0F, 15.0F);
+    std::uniform_real_distribution<float> velocity(-1.0F, 1.0F);
+    std::uniform_real_distribution<float> half_size(0.5F, 1.5F);
+    std::vector<glm::vec3> centres(32);
+    for (glm::vec3 &centre : centres)
+    {
+        centre = {position(random), position(random), position(random)};
+    }
+    std::vector<Body> bodies(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const glm::vec3 &centre = centres[i % centres.size()];
+        bodies[i] = {
+            centre + glm::vec3(offset(random), offset(random), offset(random)),
+            {velocity(random), velocity(random), velocity(random)},
+            half_size(random),
+        };
+    }
+    return bodies;
+}
+
+void step(std::vector<Body> &bodies, float seconds, std::vector<Bounds> &bounds)
+{
+    bounds.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        Body &body = bodies[i];
+        body.position += body.velocity * seconds;
+        // Bounce off the walls so the distribution holds
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (body.position[axis] < 0.0F || body.position[axis] > world_size)
+            {
+                body.velocity[axis] = -body.velocity[axis];
+            }
+        }
+        bounds[i] = {body.position - body.half_size, body.position + body.half_size};
+    }
+}
+
+void benchmark(const std::string &name, std::vector<Body> bodies, size_t ticks, std::shared_ptr<ThreadPool> pool)
+{
+    Broadphase sweep(pool, {BroadphaseMethod::sweep_and_prune});
+    Broadphase grid(pool, {BroadphaseMethod::uniform_grid});
+    std::vector<Bounds> bounds;
+    step(bodies, 0.0F, bounds);
+    for (const Bounds &body : bounds)
+    {
+        sweep.add(body);
+        grid.add(body);
+    }
+
+    float sweep_ms = 0.0F;
+    float grid_ms = 0.0F;
+    size_t began = 0;
+    size_t ended = 0;
+    size_t swaps = 0;
+    size_t mismatches = 0;
+    for (size_t tick = 0; tick <= ticks; tick++)
+    {
+        step(bodies, 1.0F / 60.0F, bounds);
+        sweep.set_bounds(0, bounds);
+        grid.set_bounds(0, bounds);
+        sweep.update();
+        grid.update();
+        // The first update finds every pair from scratch, so it's left out of the averages
+        if (tick == 0)
+        {
+            continue;
+        }
+        sweep_ms += sweep.stats().update_ms;
+        grid_ms += grid.stats().update_ms;
+        began += sweep.stats().began;
+        ended += sweep.stats().ended;
+        swaps += sweep.stats().swaps;
+        mismatches += sweep.pairs() == grid.pairs() ? 0 : 1;
+    }
+
+    const auto per_tick = [&](auto total) { return static_cast<double>(total) / static_cast<double>(ticks); };
+    std::cout << name << ": " << bodies.size() << " bodies, " << sweep.stats().pairs << " pairs, " << std::fixed
+              << std::setprecision(1) << per_tick(began) << " began and " << per_tick(ended) << " ended per tick"
+              << std::endl;
+    std::cout << "  sweep and prune " << std::setprecision(2) << per_tick(sweep_ms) << " ms/tick, "
+              << std::setprecision(0) << per_tick(swaps) << " swaps/tick" << std::endl;
+    std::cout << "  uniform grid    " << std::setprecision(2) << per_tick(grid_ms) << " ms/tick" << std::endl;
+    if (mismatches != 0)
+    {
+        std::cout << "  methods disagreed on " << mismatches << " ticks" << std::endl;
+    }
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (args.size() > 3)
+    {
+        std::cerr << "Usage: broadphasebench [bodies] [ticks] [threads]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const size_t bodies = !args.empty() ? std::stoul(args[0]) : 100000;
+        const size_t ticks = args.size() > 1 ? std::stoul(args[1]) : 60;
+        const size_t threads = args.size() > 2 ? std::stoul(args[2]) : std::thread::hardware_concurrency();
+        auto pool = std::make_shared<ThreadPool>(std::max<size_t>(threads, 1));
+        std::cout << pool->size() << " threads" << std::endl;
+        benchmark("uniform", uniform_bodies(bodies), ticks, pool);
+        benchmark("clustered", clustered_bodies(bodies), ticks, pool);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "broadphasebench: " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+// Times building a MeshBvh and casting rays through it, for a model file and for generated terrain of increasing size.
+// Rays come in two sets: a coherent grid from a camera looking at the mesh, and incoherent rays between random points
+// of its bounds. Every query runs at each SIMD level the CPU supports, and every level's closest hits, single and
+// packeted, are checked against the scalar single ray results. Exits with 1 if any disagree.
+//
+//     bvhbench [model.obj] [rays]
+#include "scene/mesh_bvh.hpp"
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+auto load_positions(const std::string &path) -> std::vector<glm::vec3>
+{
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate);
+    if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0)
+    {
+        throw std::runtime_error("Assimp: " + std::string(importer.GetErrorString()));
+    }
+    std::vector<glm::vec3> positions;
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++)
+    {
+        const aiMesh &mesh = *scene->mMeshes[mesh_idx];
+        for (unsigned int face_idx = 0; face_idx < mesh.mNumFaces; face_idx++)
+        {
+            const aiFace &face = mesh.mFaces[face_idx];
+            if (face.mNumIndices != 3)
+            {
+                continue;
+            }
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                const aiVector3D &vertex = mesh.mVertices[face.mIndices[i]];
+                positions.emplace_back(vertex.x, vertex.y, vertex.z);
+            }
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return positions;
+}
+
+// Rolling heightfield of 2 * cells^2 triangles
+auto terrain_positions(int cells) -> std::vector<glm::vec3>
+{
+    const float size = 100.0F;
+    auto vertex_at = [&](int i, int j) {
+        const float x = size * static_cast<float>(i) / static_cast<float>(cells);
+        const float z = size * static_cast<float>(j) / static_cast<float>(cells);
+        return glm::vec3(x, 5.0F * std::sin(x * 0.2F) * std::cos(z * 0.15F), z);
+    };
+    std::vector<glm::vec3> positions;
+    positions.reserve(static_cast<size_t>(cells) * static_cast<size_t>(cells) * 6);
+    for (int i = 0; i < cells; i++)
+    {
+        for (int j = 0; j < cells; j++)
+        {
+            for (auto corner : {glm::ivec2(0, 0), glm::ivec2(0, 1), glm::ivec2(1, 1), glm::ivec2(0, 0),
+                                glm::ivec2(1, 1), glm::ivec2(1, 0)})
+            {
+                positions.push_back(vertex_at(i + corner.x, j + corner.y));
+            }
+        }
+    }
+    return positions;
+}
+
+auto coherent_rays(const Bounds &bounds, size_t count) -> std::vector<Ray>
+{
+    const glm::vec3 centre = (bounds.min + bounds.max) * 0.5F;
+    const float radius = glm::length(bounds.max - centre);
+    const glm::vec3 eye = centre + glm::vec3(0.3F, 0.8F, 1.0F) * radius * 1.5F;
+    const glm::vec3 forward = glm::normalize(centre - eye);
+    const glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0F, 1.0F, 0.0F)));
+    const glm::vec3 up = glm::cross(right, forward);
+    const auto side = static_cast<size_t>(std::sqrt(static_cast<double>(count)));
+    std::vector<Ray> rays;
+    rays.reserve(side * side);
+    for (size_t y = 0; y < side; y++)
+    {
+        for (size_t x = 0; x < side; x++)
+        {
+            const float u = (static_cast<float>(x) + 0.5F) / static_cast<float>(side) * 2.0F - 1.0F;
+            const float v = (static_cast<float>(y) + 0.5F) / static_cast<float>(side) * 2.0F - 1.0F;
+            rays.push_back({eye, glm::normalize(forward + (right * u + up * v) * 0.6F)});
+        }
+    }
+    return rays;
+}
+
+auto incoherent_rays(const Bounds &bounds, size_t count) -> std::vector<Ray>
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0F, 1.0F);
+    auto point = [&] {
+        return bounds.min + (bounds.max - bounds.min) * glm::vec3(unit(random), unit(random), unit(random));
+    };
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (size_t ray = 0; ray < count; ray++)
+    {
+        const glm::vec3 from = point();
+        rays.push_back({from, glm::normalize(point() - from)});
+    }
+    return rays;
+}
+
+template <typename Function> auto rays_per_second(size_t rays, Function &&function) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(rays) / elapsed.count();
+}
+
+auto level_name(SimdLevel level) -> const char *
+{
+    switch (level)
+    {
+    case SimdLevel::avx2:
+        return "avx2";
+    case SimdLevel::sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+// Levels may round differently, so distances only need to be close, and a different triangle at the same distance is
+// a ray through a shared edge rather than a wrong answer
+auto same_hit(const std::optional<RayHit> &lhs, const std::optional<RayHit> &rhs) -> bool
+{
+    if (!lhs || !rhs)
+    {
+        return lhs.has_value() == rhs.has_value();
+    }
+    const float tolerance = 1e-4F * std::max(1.0F, std::abs(lhs->t));
+    return std::abs(lhs->t - rhs->t) <= tolerance;
+}
+
+auto count_mismatches(
+    const std::vector<std::optional<RayHit>> &expected, const std::vector<std::optional<RayHit>> &hits
+) -> size_t
+{
+    size_t mismatches = 0;
+    for (size_t ray = 0; ray < expected.size(); ray++)
+    {
+        mismatches += same_hit(expected[ray], hits[ray]) ? 0 : 1;
+    }
+    return mismatches;
+}
+
+// Returns how many results disagreed with the scalar single ray ones
+auto benchmark(const std::string &name, const std::vector<glm::vec3> &positions, size_t ray_count) -> size_t
+{
+    const auto start = std::chrono::steady_clock::now();
+    const MeshBvh bvh(positions);
+    const std::chrono::duration<double, std::milli> build = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << bvh.triangle_count() << " triangles, built in " << std::fixed << std::setprecision(1)
+              << build.count() << " ms, " << bvh.node_count() << " nodes, " << bvh.memory_bytes() / 1024 << " KiB"
+              << std::endl;
+
+    size_t mismatches = 0;
+    for (const auto &[set, rays] : {std::pair{"coherent", coherent_rays(bvh.bounds(), ray_count)},
+                                    std::pair{"incoherent", incoherent_rays(bvh.bounds(), ray_count)}})
+    {
+        std::vector<std::optional<RayHit>> expected;
+        expected.reserve(rays.size());
+        for (const Ray &ray : rays)
+        {
+            expected.push_back(bvh.closest_hit(ray, SimdLevel::scalar));
+        }
+        for (SimdLevel level : {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2})
+        {
+            if (level > detect_simd_level())
+            {
+                continue;
+            }
+            size_t hits = 0;
+            const double closest = rays_per_second(rays.size(), [&] {
+                for (const Ray &ray : rays)
+                {
+                    hits += bvh.closest_hit(ray, level).has_value() ? 1 : 0;
+                }
+            });
+            const double any = rays_per_second(rays.size(), [&] {
+                for (const Ray &ray : rays)
+                {
+                    hits += bvh.any_hit(ray, level) ? 1 : 0;
+                }
+            });
+            std::vector<std::optional<RayHit>> packet_hits;
+            const double packets =
+                rays_per_second(rays.size(), [&] { bvh.closest_hits(rays, packet_hits, level); });
+            std::cout << "  " << std::setw(10) << set << " " << std::setw(6) << level_name(level) << "  closest "
+                      << std::setprecision(2) << closest / 1e6 << " Mrays/s, any " << any / 1e6
+                      << " Mrays/s, packets " << packets / 1e6 << " Mrays/s (" << hits / 2 << " hits)" << std::endl;
+
+            std::vector<std::optional<RayHit>> single_hits;
+            single_hits.reserve(rays.size());
+            for (const Ray &ray : rays)
+            {
+                single_hits.push_back(bvh.closest_hit(ray, level));
+            }
+            const size_t single_mismatches = count_mismatches(expected, single_hits);
+            const size_t packet_mismatches = count_mismatches(expected, packet_hits);
+            if (single_mismatches != 0 || packet_mismatches != 0)
+            {
+                std::cout << "  " << std::setw(10) << set << " " << std::setw(6) << level_name(level)
+                          << "  disagreed with scalar on " << single_mismatches << " single and " << packet_mismatches
+                          << " packet rays" << std::endl;
+            }
+            mismatches += single_mismatches + packet_mismatches;
+        }
+    }
+    return mismatches;
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (args.size() > 2)
+    {
+        std::cerr << "Usage: bvhbench [model.obj] [rays]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const std::string model = !args.empty() ? args[0] : "teapot2.obj";
+        const size_t ray_count = args.size() > 1 ? std::stoul(args[1]) : 1U << 18U;
+        size_t mismatches = benchmark(model, load_positions(model), ray_count);
+        for (int cells : {224, 707})
+        {
+            mismatches += benchmark("terrain " + std::to_string(cells), terrain_positions(cells), ray_count);
+        }
+        if (mismatches != 0)
+        {
+            std::cerr << "bvhbench: " << mismatches << " results disagreed between SIMD levels or packets" << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "bvhbench: " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+// CPU microbenchmarks for the engine's per frame and load time work, run against a NullBackend so no GL context is
+// needed and the times are engine overhead only, with no driver cost. Covers Camera::projection_mat, importing meshes
+// with and without a scratch arena, Scene::draw over growing node counts, composing node transforms with
+// TransformBatch against plain glm and updating animated characters.
+//
+//     microbench [--benchmark_filter=regex]
+#include "backend/null_backend.hpp"
+#include "backend/recording_backend.hpp"
+#include "core/arena.hpp"
+#include "core/thread_pool.hpp"
+#include "scene/animation.hpp"
+#include "scene/mesh.hpp"
+#include "scene/node.hpp"
+#include "scene/scene.hpp"
+#include "scene/transform_batch.hpp"
+#include <assimp/mesh.h>
+#include <assimp/scene.h>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+using BenchMesh = Mesh<false, true, 0>;
+using BenchNode = Node<false, false, true, 0>;
+using BenchShader = ShaderProgram<false, false, true, 0>;
+
+auto null_backend() -> NullBackend &
+{
+    static NullBackend backend;
+    RenderBackend::set_current(&backend);
+    return backend;
+}
+
+auto make_camera() -> std::shared_ptr<Camera>
+{
+    return std::make_shared<Camera>(
+        glm::vec3(0.0F, 10.0F, 30.0F), glm::quat(1.0F, 0.0F, 0.0F, 0.0F), 70.0F, 16.0F / 9.0F, 0.1F, 1000.0F
+    );
+}
+
+// Triangulated grid of 2 * cells^2 faces over shared vertices, as Assimp hands over an imported model
+auto grid_mesh(unsigned int cells) -> std::unique_ptr<aiMesh>
+{
+    auto mesh = std::make_unique<aiMesh>();
+    const unsigned int side = cells + 1;
+    mesh->mNumVertices = side * side;
+    mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+    mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (unsigned int i = 0; i < side; i++)
+    {
+        for (unsigned int j = 0; j < side; j++)
+        {
+            const auto x = static_cast<float>(i);
+            const auto z = static_cast<float>(j);
+            mesh->mVertices[i * side + j] = aiVector3D(x, std::sin(x * 0.2F) * std::cos(z * 0.15F), z);
+            mesh->mNormals[i * side + j] = aiVector3D(0.0F, 1.0F, 0.0F);
+        }
+    }
+    mesh->mNumFaces = 2 * cells * cells;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    unsigned int face = 0;
+    for (unsigned int i = 0; i < cells; i++)
+    {
+        for (unsigned int j = 0; j < cells; j++)
+        {
+            const unsigned int corner = i * side + j;
+            for (const auto &indices : {std::array{corner, corner + 1, corner + side + 1},
+                                        std::array{corner, corner + side + 1, corner + side}})
+            {
+                aiFace &target = mesh->mFaces[face++];
+                target.mNumIndices = 3;
+                target.mIndices = new unsigned int[3]{indices[0], indices[1], indices[2]};
+            }
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return mesh;
+}
+
+void projection_mat(benchmark::State &state)
+{
+    auto camera = make_camera();
+    float angle = 0.0F;
+    for (auto _ : state)
+    {
+        // Moving the camera each time keeps the compiler from hoisting the work out of the loop
+        angle += 0.001F;
+        camera->set_rotation(glm::angleAxis(angle, glm::vec3(0.0F, 1.0F, 0.0F)));
+        benchmark::DoNotOptimize(camera->projection_mat());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(projection_mat);
+
+void mesh_import(benchmark::State &state)
+{
+    null_backend();
+    const auto mesh = grid_mesh(static_cast<unsigned int>(state.range(0)));
+    const bool arena = state.range(1) != 0;
+    LinearArena scratch(0);
+    for (auto _ : state)
+    {
+        if (arena)
+        {
+            ArenaScope scope(scratch);
+            BenchMesh imported(*mesh, false, &scratch);
+            benchmark::DoNotOptimize(imported.bounds());
+        }
+        else
+        {
+            BenchMesh imported(*mesh);
+            benchmark::DoNotOptimize(imported.bounds());
+        }
+        // The arena's block grows to fit after the first import
+        scratch.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * mesh->mNumFaces);
+    state.SetLabel(arena ? "arena" : "heap");
+}
+BENCHMARK(mesh_import)->ArgsProduct({{32, 256}, {0, 1}});
+
+void scene_draw(benchmark::State &state)
+{
+    NullBackend &backend = null_backend();
+    const auto node_count = static_cast<size_t>(state.range(0));
+    auto camera = make_camera();
+    auto light = std::make_shared<Light>();
+    auto shader = std::make_shared<BenchShader>();
+    auto mesh = std::make_shared<BenchMesh>(*grid_mesh(4));
+    const MaterialValues material{glm::vec3(0.1F), glm::vec3(0.6F), glm::vec3(0.3F), 32.0F};
+    Scene scene(camera, light);
+    for (size_t node = 0; node < node_count; node++)
+    {
+        const glm::vec3 position(static_cast<float>(node % 100), 0.0F, static_cast<float>(node / 100));
+        scene.add_node(std::make_shared<BenchNode>(mesh, shader, glm::translate(glm::mat4(1.0F), position), material));
+    }
+
+    // Check the draw path issues what's expected before timing it
+    RecordingBackend recording;
+    RenderBackend::set_current(&recording);
+    Scene check(camera, light);
+    auto check_shader = std::make_shared<BenchShader>();
+    auto check_mesh = std::make_shared<BenchMesh>(*grid_mesh(4));
+    check.add_node(std::make_shared<BenchNode>(check_mesh, check_shader, glm::mat4(1.0F), material));
+    check.add_node(std::make_shared<BenchNode>(check_mesh, check_shader, glm::mat4(1.0F), material));
+    recording.clear();
+    check.draw();
+    RenderBackend::set_current(&backend);
+    if (recording.count(BackendOp::draw_arrays) != 2 || recording.count(BackendOp::use_program) != 2)
+    {
+        state.SkipWithError("Scene::draw didn't draw each node once");
+        return;
+    }
+
+    backend.reset_counters();
+    for (auto _ : state)
+    {
+        scene.draw();
+    }
+    const BackendCounters counters = backend.counters();
+    const auto draws = static_cast<double>(counters.draws);
+    state.SetItemsProcessed(static_cast<int64_t>(counters.draws));
+    state.counters["uniforms/draw"] = static_cast<double>(counters.uniforms) / draws;
+    state.counters["uniform bytes/draw"] = static_cast<double>(counters.uniform_bytes) / draws;
+}
+BENCHMARK(scene_draw)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+void random_transforms(size_t count, TransformBatch &batch)
+{
+    batch.resize(count);
+    for (size_t node = 0; node < count; node++)
+    {
+        const auto t = static_cast<float>(node);
+        batch.set(
+            node, glm::vec3(t, t * 0.5F, -t), glm::angleAxis(t * 0.01F, glm::normalize(glm::vec3(1.0F, 2.0F, 3.0F))),
+            glm::vec3(1.0F + t * 0.001F)
+        );
+    }
+}
+
+// The path main.cpp took before TransformBatch, one glm composition per node
+void compose_glm(benchmark::State &state)
+{
+    const auto count = static_cast<size_t>(state.range(0));
+    std::vector<glm::vec3> positions(count);
+    std::vector<glm::quat> rotations(count);
+    std::vector<glm::vec3> scales(count);
+    for (size_t node = 0; node < count; node++)
+    {
+        const auto t = static_cast<float>(node);
+        positions[node] = glm::vec3(t, t * 0.5F, -t);
+        rotations[node] = glm::angleAxis(t * 0.01F, glm::normalize(glm::vec3(1.0F, 2.0F, 3.0F)));
+        scales[node] = glm::vec3(1.0F + t * 0.001F);
+    }
+    std::vector<glm::mat4> out(count);
+    for (auto _ : state)
+    {
+        for (size_t node = 0; node < count; node++)
+        {
+            out[node] = glm::translate(glm::mat4(1.0F), positions[node]) * glm::mat4_cast(rotations[node]) *
+                        glm::scale(glm::mat4(1.0F), scales[node]);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(compose_glm)->Arg(10000);
+
+void compose_batch(benchmark::State &state)
+{
+    const auto level = static_cast<SimdLevel>(state.range(1));
+    if (level > detect_simd_level())
+    {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    TransformBatch batch;
+    random_transforms(static_cast<size_t>(state.range(0)), batch);
+    std::vector<glm::mat4> out;
+    for (auto _ : state)
+    {
+        batch.compose(out, level);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    const std::array names{"scalar", "sse2", "avx2"};
+    state.SetLabel(names.at(static_cast<size_t>(level)));
+}
+BENCHMARK(compose_batch)->ArgsProduct({{10000}, {0, 1, 2}});
+
+struct Rig
+{
+    std::shared_ptr<const Skeleton> skeleton;
+    std::shared_ptr<const AnimationClip> clip;
+};
+
+// A chain of joints one unit apart with a bone on each, and a one second clip swinging every joint about z
+auto chain_rig(unsigned int joints) -> Rig
+{
+    const auto joint_name = [](unsigned int joint) {
+        return aiString(std::string("joint").append(std::to_string(joint)));
+    };
+    aiScene scene;
+    scene.mRootNode = new aiNode("root");
+    aiNode *parent = scene.mRootNode;
+    aiMesh mesh;
+    mesh.mNumBones = joints;
+    mesh.mBones = new aiBone *[joints];
+    aiAnimation animation;
+    animation.mName = aiString(std::string("swing"));
+    animation.mDuration = 30.0;
+    animation.mTicksPerSecond = 30.0;
+    animation.mNumChannels = joints;
+    animation.mChannels = new aiNodeAnim *[joints];
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (unsigned int joint = 0; joint < joints; joint++)
+    {
+        auto *node = new aiNode(joint_name(joint).C_Str());
+        node->mTransformation.b4 = 1.0F;
+        parent->addChildren(1, &node);
+        parent = node;
+
+        mesh.mBones[joint] = new aiBone();
+        mesh.mBones[joint]->mName = joint_name(joint);
+
+        auto *channel = new aiNodeAnim();
+        channel->mNodeName = joint_name(joint);
+        channel->mNumPositionKeys = 1;
+        channel->mPositionKeys = new aiVectorKey[1];
+        channel->mPositionKeys[0] = aiVectorKey(0.0, aiVector3D(0.0F, 1.0F, 0.0F));
+        channel->mNumScalingKeys = 1;
+        channel->mScalingKeys = new aiVectorKey[1];
+        channel->mScalingKeys[0] = aiVectorKey(0.0, aiVector3D(1.0F, 1.0F, 1.0F));
+        channel->mNumRotationKeys = 3;
+        channel->mRotationKeys = new aiQuatKey[3];
+        for (unsigned int key = 0; key < 3; key++)
+        {
+            const float half_angle = key == 1 ? 0.25F : 0.0F;
+            const aiQuaternion rotation(std::cos(half_angle), 0.0F, 0.0F, std::sin(half_angle));
+            channel->mRotationKeys[key] = aiQuatKey(15.0 * key, rotation);
+        }
+        animation.mChannels[joint] = channel;
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto skeleton = std::make_shared<const Skeleton>(scene, mesh);
+    auto clip = std::make_shared<const AnimationClip>(animation, *skeleton);
+    return {skeleton, clip};
+}
+
+// Samples, cross-fades and skins a crowd of characters across the pool, the work update_characters spreads each frame
+void character_update(benchmark::State &state)
+{
+    const auto count = static_cast<size_t>(state.range(0));
+    const Rig rig = chain_rig(static_cast<unsigned int>(state.range(1)));
+    ThreadPool pool;
+    std::vector<std::shared_ptr<Character>> characters;
+    for (size_t character = 0; character < count; character++)
+    {
+        characters.push_back(std::make_shared<Character>(rig.skeleton));
+        characters.back()->set_speed(0.5F + static_cast<float>(character % 7) * 0.1F);
+        characters.back()->play(rig.clip);
+    }
+    size_t frame = 0;
+    for (auto _ : state)
+    {
+        // Restarting the clip now and then keeps some characters mid cross-fade
+        if (++frame % 30 == 0)
+        {
+            characters[frame % count]->play(rig.clip, 0.25F);
+        }
+        update_characters(pool, characters, 1.0F / 60.0F);
+        benchmark::DoNotOptimize(characters.front()->palette()->data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(character_update)->ArgsProduct({{100, 1000}, {32}})->Unit(benchmark::kMicrosecond);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,334 @@
+// Offline frame replay: re-issues the draws of a frame capture (press F12 in the game) in a hidden window, rendering
+// off screen so the result doesn't depend on the desktop, and reports CPU submit and GPU times per frame. Frames are
+// replayed in order iterations times, the first pass warms caches and isn't timed. The hash of the final image is
+// printed so two runs can be checked for identical output. Like the game, each frame's scene renders off screen at its
+// captured size and is upscaled with the captured filter before the overlay draws at the output size.
+//
+//     replay capture.gcap [iterations]
+#include "backend/gl_backend.hpp"
+#include "capture/capture_file.hpp"
+#include "render/render_target.hpp"
+#include "render/upscaler.hpp"
+#include "shader/shader.hpp"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct ReplayProgram
+{
+    GLuint program;
+    // Capture time location to the location of the same uniform in the rebuilt program
+    std::unordered_map<int32_t, GLint> locations;
+};
+
+auto build_program(const CapturedProgram &captured) -> ReplayProgram
+{
+    ReplayProgram replay{compile_program(captured.defines), {}};
+    for (const auto &[location, name] : captured.uniforms)
+    {
+        replay.locations[location] = glGetUniformLocation(replay.program, name.c_str());
+    }
+    return replay;
+}
+
+auto build_mesh(GlBackend &backend, const CapturedMesh &captured) -> GLuint
+{
+    const GLuint buffer = backend.create_buffer(captured.vertices.data(), captured.vertices.size());
+    return backend.create_vertex_array(buffer, static_cast<GLsizei>(captured.stride), captured.attributes);
+}
+
+class CommandReader
+{
+  public:
+    explicit CommandReader(const std::vector<uint8_t> &commands) : commands(commands) {};
+    [[nodiscard]] auto done() const -> bool
+    {
+        return cursor == commands.size();
+    }
+    template <typename T> auto read() -> T
+    {
+        T value{};
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    auto take(size_t size) -> const uint8_t *
+    {
+        if (commands.size() - cursor < size)
+        {
+            throw std::runtime_error("Capture command stream truncated");
+        }
+        const uint8_t *data = &commands[cursor];
+        cursor += size;
+        return data;
+    }
+
+  private:
+    const std::vector<uint8_t> &commands;
+    size_t cursor{};
+};
+
+class Replayer
+{
+  public:
+    explicit Replayer(const CaptureFile &capture)
+    {
+        for (const auto &program : capture.programs)
+        {
+            programs[program.id] = build_program(program);
+        }
+        for (const auto &mesh : capture.meshes)
+        {
+            meshes[mesh.id] = build_mesh(backend, mesh);
+        }
+        for (const auto &frame : capture.frames)
+        {
+            scene_target.reserve(frame.width, frame.height);
+        }
+    }
+    // Leaves output bound with the finished frame in its bottom left corner
+    void run(const CapturedFrame &frame, GLuint output)
+    {
+        // Matches the state the game sets before drawing a frame
+        scene_target.bind(frame.width, frame.height);
+        glPolygonMode(GL_FRONT_AND_BACK, frame.polygon_mode);
+        glClearColor(0.0F, 0.0F, 0.0F, 1.0F);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        const ReplayProgram *program = nullptr;
+        bool upscaled = false;
+        CommandReader reader(frame.commands);
+        while (!reader.done())
+        {
+            switch (reader.read<CaptureOp>())
+            {
+            case CaptureOp::use_program:
+                program = &programs.at(reader.read<uint32_t>());
+                glUseProgram(program->program);
+                break;
+            case CaptureOp::bind_mesh:
+                glBindVertexArray(meshes.at(reader.read<uint32_t>()));
+                break;
+            case CaptureOp::uniform:
+            {
+                const auto location = reader.read<int32_t>();
+                const auto kind = reader.read<UniformKind>();
+                const auto count = reader.read<uint32_t>();
+                const uint8_t *data = reader.take(uniform_kind_size(kind) * count);
+                if (program == nullptr)
+                {
+                    throw std::runtime_error("Capture sets a uniform with no program bound");
+                }
+                // Copied out as the stream gives no alignment guarantees
+                scratch.resize(uniform_kind_size(kind) * count);
+                std::memcpy(scratch.data(), data, scratch.size());
+                const GLint replay_location = program->locations.at(location);
+                backend.set_uniform(replay_location, kind, static_cast<GLsizei>(count), scratch.data());
+                break;
+            }
+            case CaptureOp::draw_arrays:
+            {
+                const auto first = reader.read<int32_t>();
+                const auto count = reader.read<int32_t>();
+                glDrawArrays(GL_TRIANGLES, first, count);
+                break;
+            }
+            case CaptureOp::upscale:
+            {
+                const auto filter = reader.read<uint8_t>();
+                const auto sharpness = reader.read<float>();
+                if (filter > static_cast<uint8_t>(UpscaleFilter::sharpen))
+                {
+                    throw std::runtime_error("Unknown upscale filter in capture");
+                }
+                upscaler.draw(
+                    scene_target, frame.output_width, frame.output_height, static_cast<UpscaleFilter>(filter),
+                    sharpness, output
+                );
+                glClear(GL_DEPTH_BUFFER_BIT);
+                // The pass used its own program and vertex array
+                program = nullptr;
+                upscaled = true;
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown capture command");
+            }
+        }
+        if (!upscaled)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, scene_target.framebuffer());
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output);
+            glBlitFramebuffer(
+                0, 0, frame.width, frame.height, 0, 0, frame.width, frame.height, GL_COLOR_BUFFER_BIT, GL_NEAREST
+            );
+            glBindFramebuffer(GL_FRAMEBUFFER, output);
+        }
+    }
+
+  private:
+    GlBackend backend;
+    RenderTarget scene_target;
+    Upscaler upscaler;
+    std::unordered_map<uint32_t, ReplayProgram> programs;
+    std::unordered_map<uint32_t, GLuint> meshes;
+    std::vector<uint8_t> scratch;
+};
+
+struct Timings
+{
+    std::vector<double> cpu_ms;
+    std::vector<double> gpu_ms;
+};
+
+void print_stat(const std::string &name, std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    std::cout << std::setw(4) << name << " ms  min " << samples.front() << "  median " << samples[samples.size() / 2]
+              << "  max " << samples.back() << std::endl;
+}
+
+// FNV-1a over the pixels
+auto hash_pixels(const std::vector<uint8_t> &pixels) -> uint64_t
+{
+    const uint64_t offset_basis = 14695981039346656037ULL;
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = offset_basis;
+    for (uint8_t byte : pixels)
+    {
+        hash = (hash ^ byte) * prime;
+    }
+    return hash;
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (args.empty() || args.size() > 2)
+    {
+        std::cerr << "Usage: replay capture.gcap [iterations]" << std::endl;
+        return 1;
+    }
+    const size_t default_iterations = 100;
+    const size_t iterations = args.size() == 2 ? std::stoul(args[1]) : default_iterations;
+
+    if (!SDL_Init(SDL_INIT_VIDEO))
+    {
+        std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    auto window = std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)>(
+        SDL_CreateWindow("replay", 1, 1, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL), SDL_DestroyWindow
+    );
+    using GLContextType = std::remove_pointer_t<SDL_GLContext>;
+    auto context = std::unique_ptr<GLContextType, decltype(&SDL_GL_DestroyContext)>(
+        window ? SDL_GL_CreateContext(window.get()) : nullptr, SDL_GL_DestroyContext
+    );
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!context || gladLoadGLLoader(reinterpret_cast<GLADloadproc>(SDL_GL_GetProcAddress)) == 0)
+    {
+        std::cerr << "Failed to create a GL context: " << SDL_GetError() << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+
+    try
+    {
+        const CaptureFile capture = read_capture(args[0]);
+        if (capture.frames.empty())
+        {
+            throw std::runtime_error("Capture has no frames");
+        }
+        int width = 0;
+        int height = 0;
+        for (const auto &frame : capture.frames)
+        {
+            width = std::max(width, frame.output_width);
+            height = std::max(height, frame.output_height);
+        }
+
+        // Off screen target big enough for every frame, hidden windows may not have a usable back buffer
+        GLuint framebuffer = 0;
+        std::array<GLuint, 2> renderbuffers{};
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(2, renderbuffers.data());
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            throw std::runtime_error("Replay framebuffer incomplete");
+        }
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+
+        Replayer replayer(capture);
+        std::vector<GLuint> queries(capture.frames.size());
+        glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+
+        Timings timings;
+        for (size_t iteration = 0; iteration <= iterations; iteration++)
+        {
+            std::vector<double> cpu_ms;
+            for (size_t frame = 0; frame < capture.frames.size(); frame++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                glBeginQuery(GL_TIME_ELAPSED, queries[frame]);
+                replayer.run(capture.frames[frame], framebuffer);
+                glEndQuery(GL_TIME_ELAPSED);
+                cpu_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                                     .count());
+            }
+            // Waits for the pass to finish, so passes don't overlap
+            for (size_t frame = 0; frame < capture.frames.size() && iteration > 0; frame++)
+            {
+                const double nanoseconds_per_ms = 1e6;
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[frame], GL_QUERY_RESULT, &elapsed);
+                timings.gpu_ms.push_back(static_cast<double>(elapsed) / nanoseconds_per_ms);
+                timings.cpu_ms.push_back(cpu_ms[frame]);
+            }
+            glFinish();
+        }
+
+        const CapturedFrame &last = capture.frames.back();
+        std::vector<uint8_t> pixels(
+            static_cast<size_t>(last.output_width) * static_cast<size_t>(last.output_height) * 4
+        );
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, last.output_width, last.output_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        std::cout << capture.frames.size() << " frames, " << iterations << " iterations" << std::endl;
+        if (iterations > 0)
+        {
+            print_stat("cpu", timings.cpu_ms);
+            print_stat("gpu", timings.gpu_ms);
+        }
+        std::cout << "image hash " << std::hex << hash_pixels(pixels) << std::dec << std::endl;
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "replay: " << error.what() << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,392 @@
+// Checks what the scene's draw path asks the backend for, against a RecordingBackend so no GL context is needed:
+// one program bind and one draw of the whole mesh per node, world nodes before overlays, and the transform and
+// projection each draw was given. With GAME_COUNT_ALLOCATIONS it also checks that Scene::draw, WorldStreamer::update
+// and TextureManager::update make no heap allocations once settled. The texture check needs a hidden GL window and is
+// skipped where one can't be made. Prints each failure and exits with 1 if there were any.
+//
+//     scenecheck
+#include "backend/null_backend.hpp"
+#include "backend/recording_backend.hpp"
+#include "core/allocation_count.hpp"
+#include "core/arena.hpp"
+#include "scene/mesh.hpp"
+#include "scene/node.hpp"
+#include "scene/scene.hpp"
+#include "texture/texture.hpp"
+#include "world/world_streamer.hpp"
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+using CheckMesh = Mesh<true, false, 0>;
+using WorldNode = Node<false, true, false, 0>;
+using OverlayNode = Node<true, true, false, 0>;
+using WorldShader = ShaderProgram<false, true, false, 0>;
+using OverlayShader = ShaderProgram<true, true, false, 0>;
+
+// Frames the allocation checks measure once settled, and how long they wait for loads to settle
+const int measured_frames = 10;
+const int settle_frames = 1000;
+
+size_t failures = 0;
+
+void check(bool passed, const std::string &what)
+{
+    if (!passed)
+    {
+        std::cout << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+auto make_camera() -> std::shared_ptr<Camera>
+{
+    return std::make_shared<Camera>(
+        glm::vec3(0.0F, 10.0F, 30.0F), glm::quat(1.0F, 0.0F, 0.0F, 0.0F), 70.0F, 16.0F / 9.0F, 0.1F, 1000.0F
+    );
+}
+
+auto triangle_mesh() -> std::shared_ptr<CheckMesh>
+{
+    using Vertex = VertexAttributes<true, false, 0>;
+    std::vector<Vertex> vertices(3);
+    vertices[0].position = glm::vec3(0.0F, 0.0F, 0.0F);
+    vertices[1].position = glm::vec3(1.0F, 0.0F, 0.0F);
+    vertices[2].position = glm::vec3(0.0F, 1.0F, 0.0F);
+    for (auto &vertex : vertices)
+    {
+        vertex.colour = glm::vec4(1.0F);
+    }
+    return std::make_shared<CheckMesh>(vertices);
+}
+
+auto same_bytes(const std::vector<uint8_t> &data, const glm::mat4 &matrix) -> bool
+{
+    return data.size() == sizeof(matrix) && std::memcmp(data.data(), &matrix, sizeof(matrix)) == 0;
+}
+
+void check_draw_calls()
+{
+    RecordingBackend recording;
+    RenderBackend::set_current(&recording);
+    auto camera = make_camera();
+    auto light = std::make_shared<Light>();
+    auto world_shader = std::make_shared<WorldShader>();
+    auto overlay_shader = std::make_shared<OverlayShader>();
+    auto mesh = triangle_mesh();
+    std::vector<GLuint> programs;
+    for (const BackendCall &call : recording.calls())
+    {
+        if (call.op == BackendOp::create_program)
+        {
+            programs.push_back(call.object);
+        }
+    }
+    check(programs.size() == 2, "each shader creates one program");
+    if (programs.size() != 2)
+    {
+        RenderBackend::set_current(nullptr);
+        return;
+    }
+
+    // The overlay goes in first to check it's still drawn after the world
+    Scene scene(camera, light);
+    const glm::mat4 overlay_transform = glm::scale(glm::mat4(1.0F), glm::vec3(0.5F));
+    scene.add_node(std::make_shared<OverlayNode>(mesh, overlay_shader, overlay_transform));
+    const std::vector<glm::mat4> world_transforms{
+        glm::translate(glm::mat4(1.0F), glm::vec3(1.0F, 2.0F, 3.0F)),
+        glm::translate(glm::mat4(1.0F), glm::vec3(-4.0F, 0.0F, 5.0F))
+    };
+    for (const auto &transform : world_transforms)
+    {
+        scene.add_node(std::make_shared<WorldNode>(mesh, world_shader, transform));
+    }
+
+    recording.clear();
+    scene.draw();
+    check(recording.count(BackendOp::draw_arrays) == 3, "Scene::draw draws each node once");
+    check(recording.count(BackendOp::use_program) == 3, "Scene::draw binds a program for each node");
+    check(recording.count(BackendOp::bind_vertex_array) == 3, "Scene::draw binds a vertex array for each node");
+
+    // Every uniform name shares one location across programs in a NullBackend
+    const GLint transform_location = recording.uniform_location(programs[0], "transform_mat");
+    const GLint projection_location = recording.uniform_location(programs[0], "projection_mat");
+    const glm::mat4 projection = camera->projection_mat();
+    std::vector<GLuint> drawn_programs;
+    std::vector<glm::mat4> expected_transforms = world_transforms;
+    expected_transforms.push_back(overlay_transform);
+    GLuint program = 0;
+    const std::vector<uint8_t> *transform = nullptr;
+    const std::vector<uint8_t> *projection_data = nullptr;
+    for (const BackendCall &call : recording.calls())
+    {
+        if (call.op == BackendOp::use_program)
+        {
+            program = call.object;
+            transform = nullptr;
+            projection_data = nullptr;
+        }
+        else if (call.op == BackendOp::set_uniform && call.location == transform_location)
+        {
+            transform = &call.data;
+        }
+        else if (call.op == BackendOp::set_uniform && call.location == projection_location)
+        {
+            projection_data = &call.data;
+        }
+        else if (call.op == BackendOp::draw_arrays)
+        {
+            const size_t draw = drawn_programs.size();
+            drawn_programs.push_back(program);
+            check(call.first == 0 && call.count == 3, "draw " + std::to_string(draw) + " covers the whole mesh");
+            check(
+                transform != nullptr && draw < expected_transforms.size() &&
+                    same_bytes(*transform, expected_transforms[draw]),
+                "draw " + std::to_string(draw) + " sets its node's transform"
+            );
+            const bool world = program == programs[0];
+            check(
+                !world || (projection_data != nullptr && same_bytes(*projection_data, projection)),
+                "draw " + std::to_string(draw) + " sets the camera's projection"
+            );
+            check(world || projection_data == nullptr, "overlay draw sets no projection");
+        }
+    }
+    check(
+        drawn_programs == std::vector<GLuint>{programs[0], programs[0], programs[1]},
+        "world nodes draw with their program before the overlay"
+    );
+    RenderBackend::set_current(nullptr);
+}
+
+void check_frame_allocations()
+{
+    NullBackend backend;
+    RenderBackend::set_current(&backend);
+    auto camera = make_camera();
+    auto light = std::make_shared<Light>();
+    auto shader = std::make_shared<WorldShader>();
+    auto mesh = triangle_mesh();
+    Scene scene(camera, light);
+    const size_t node_count = 1000;
+    for (size_t node = 0; node < node_count; node++)
+    {
+        const glm::vec3 position(static_cast<float>(node % 100), 0.0F, static_cast<float>(node / 100));
+        scene.add_node(std::make_shared<WorldNode>(mesh, shader, glm::translate(glm::mat4(1.0F), position)));
+    }
+
+    // The first frame may size things that persist, later ones have to stay off the heap
+    scene.draw();
+    AllocationCounter allocations;
+    for (int frame = 0; frame < measured_frames; frame++)
+    {
+        scene.draw();
+    }
+    const uint64_t count = allocations.count();
+    check(count == 0, "settled Scene::draw made " + std::to_string(count) + " heap allocations");
+    RenderBackend::set_current(nullptr);
+}
+
+// A square of chunks holding one triangle each, small enough to sit inside the default load radius
+void write_check_world(const std::string &path, int32_t side)
+{
+    const float chunk_size = 50.0F;
+    ChunkMesh triangle;
+    triangle.lods.emplace_back(3);
+    triangle.lods[0][0].position = glm::vec3(0.0F, 0.0F, 0.0F);
+    triangle.lods[0][1].position = glm::vec3(1.0F, 0.0F, 0.0F);
+    triangle.lods[0][2].position = glm::vec3(0.0F, 0.0F, 1.0F);
+    for (auto &vertex : triangle.lods[0])
+    {
+        vertex.colour = glm::vec4(1.0F);
+        vertex.normal = glm::vec3(0.0F, 1.0F, 0.0F);
+    }
+    const MaterialValues material{glm::vec3(0.2F), glm::vec3(0.8F), glm::vec3(0.5F), 32.0F};
+    std::vector<ChunkEntry> entries;
+    std::vector<ChunkData> chunks;
+    for (int32_t x = 0; x < side; x++)
+    {
+        for (int32_t z = 0; z < side; z++)
+        {
+            entries.push_back({x, z, {}, 0, 0, 0});
+            const glm::vec3 corner(static_cast<float>(x) * chunk_size, 0.0F, static_cast<float>(z) * chunk_size);
+            chunks.push_back({{triangle}, {{0, glm::translate(glm::mat4(1.0F), corner), material}}});
+        }
+    }
+    std::ofstream out(path, std::ios::binary);
+    write_world(out, chunk_size, entries, chunks);
+}
+
+void check_streaming_allocations()
+{
+    NullBackend backend;
+    RenderBackend::set_current(&backend);
+    const int32_t side = 4;
+    const std::string path = (std::filesystem::temp_directory_path() / "scenecheck.gworld").string();
+    write_check_world(path, side);
+    auto camera = make_camera();
+    auto light = std::make_shared<Light>();
+    Scene scene(camera, light);
+    {
+        // World chunks are lit, unlike the nodes above
+        auto shader = std::make_shared<ShaderProgram<false, true, true, 0>>();
+        WorldStreamer streamer(path, std::make_shared<ThreadPool>(), shader, scene);
+        const glm::vec3 position(100.0F, 10.0F, 100.0F);
+        const glm::vec3 velocity(0.0F);
+        auto settled = [&]() {
+            const StreamingStats stats = streamer.stats();
+            return stats.resident_chunks == static_cast<size_t>(side * side) && stats.pending_loads == 0;
+        };
+        for (int frame = 0; frame < settle_frames && !settled(); frame++)
+        {
+            streamer.update(position, velocity);
+            frame_arena().reset();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        check(settled(), "WorldStreamer streamed in every chunk of the check world");
+
+        AllocationCounter allocations;
+        for (int frame = 0; frame < measured_frames; frame++)
+        {
+            streamer.update(position, velocity);
+            frame_arena().reset();
+        }
+        const uint64_t count = allocations.count();
+        check(count == 0, "settled WorldStreamer::update made " + std::to_string(count) + " heap allocations");
+    }
+    std::filesystem::remove(path);
+    RenderBackend::set_current(nullptr);
+}
+
+// Two uncompressed textures, every level one grey
+auto write_check_textures() -> std::vector<std::string>
+{
+    std::vector<std::string> paths;
+    for (const uint32_t size : {64U, 256U})
+    {
+        std::vector<std::vector<uint8_t>> levels;
+        for (uint32_t level = 0; level < mip_count(size, size); level++)
+        {
+            const uint32_t level_size = std::max(size >> level, 1U);
+            levels.emplace_back(mip_level_size(TextureFormat::rgba8, level_size, level_size), uint8_t{128});
+        }
+        paths.push_back(
+            (std::filesystem::temp_directory_path() / ("scenecheck" + std::to_string(size) + ".btex")).string()
+        );
+        std::ofstream out(paths.back(), std::ios::binary);
+        write_texture_file(out, TextureFormat::rgba8, size, size, levels);
+    }
+    return paths;
+}
+
+void check_texture_allocations()
+{
+    if (!SDL_Init(SDL_INIT_VIDEO))
+    {
+        std::cout << "texture allocation check skipped, no video: " << SDL_GetError() << std::endl;
+        return;
+    }
+    auto window = std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)>(
+        SDL_CreateWindow("scenecheck", 1, 1, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL), SDL_DestroyWindow
+    );
+    using GLContextType = std::remove_pointer_t<SDL_GLContext>;
+    auto context = std::unique_ptr<GLContextType, decltype(&SDL_GL_DestroyContext)>(
+        window ? SDL_GL_CreateContext(window.get()) : nullptr, SDL_GL_DestroyContext
+    );
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!context || gladLoadGLLoader(reinterpret_cast<GLADloadproc>(SDL_GL_GetProcAddress)) == 0)
+    {
+        std::cout << "texture allocation check skipped, no GL context: " << SDL_GetError() << std::endl;
+        context.reset();
+        window.reset();
+        SDL_Quit();
+        return;
+    }
+
+    const std::vector<std::string> paths = write_check_textures();
+    {
+        TextureManager manager(std::make_shared<ThreadPool>());
+        std::vector<std::shared_ptr<Texture>> textures;
+        for (const auto &path : paths)
+        {
+            textures.push_back(manager.load(path));
+        }
+        // Every texture fills the screen, so settling means all of each chain is resident
+        auto frame = [&]() {
+            for (const auto &texture : textures)
+            {
+                texture->request(1.0F);
+            }
+            manager.update();
+            frame_arena().reset();
+        };
+        auto settled = [&]() {
+            const TextureStats stats = manager.stats();
+            return stats.pending_loads == 0 && stats.resident_bytes > 0 && stats.resident_bytes == stats.target_bytes;
+        };
+        for (int settle = 0; settle < settle_frames && !settled(); settle++)
+        {
+            frame();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        check(settled(), "TextureManager loaded every level of the check textures");
+
+        AllocationCounter allocations;
+        for (int measured = 0; measured < measured_frames; measured++)
+        {
+            frame();
+        }
+        const uint64_t count = allocations.count();
+        check(count == 0, "settled TextureManager::update made " + std::to_string(count) + " heap allocations");
+    }
+    for (const auto &path : paths)
+    {
+        std::filesystem::remove(path);
+    }
+    context.reset();
+    window.reset();
+    SDL_Quit();
+}
+} // namespace
+
+auto main() -> int
+{
+    try
+    {
+        check_draw_calls();
+        if (allocation_counting())
+        {
+            check_frame_allocations();
+            check_streaming_allocations();
+            check_texture_allocations();
+        }
+        else
+        {
+            std::cout << "allocation checks skipped, build with GAME_COUNT_ALLOCATIONS to run them" << std::endl;
+        }
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "scenecheck: " << error.what() << std::endl;
+        return 1;
+    }
+    if (failures != 0)
+    {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,340 @@
+// Offline texture baker: reads a PNG, JPEG, TGA, binary PPM (P6) or PGM (P5), picked by extension, builds the full
+// mip chain and writes a .btex file, BC1 compressed unless --rgba8 is given.
+//
+//     texbake [--rgba8] input.png output.btex
+#include "texture/block_compression.hpp"
+#include "texture/texture_file.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <jpeglib.h>
+#include <memory>
+#include <png.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Image
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> rgba;
+};
+
+const uint8_t opaque = 255;
+
+// samples are rows top to bottom of grey, RGB or RGBA pixels
+auto to_rgba(uint32_t width, uint32_t height, size_t channels, const std::vector<uint8_t> &samples) -> Image
+{
+    Image image{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+    for (size_t pixel = 0; pixel < static_cast<size_t>(width) * height; pixel++)
+    {
+        for (size_t channel = 0; channel < 3; channel++)
+        {
+            image.rgba[(pixel * 4) + channel] = samples[(pixel * channels) + (channels >= 3 ? channel : 0)];
+        }
+        image.rgba[(pixel * 4) + 3] = channels == 4 ? samples[(pixel * channels) + 3] : opaque;
+    }
+    return image;
+}
+
+auto next_token(std::istream &stream) -> std::string
+{
+    std::string token;
+    while (stream >> token)
+    {
+        if (token[0] != '#')
+        {
+            return token;
+        }
+        // Comments run to the end of the line
+        std::getline(stream, token);
+    }
+    throw std::runtime_error("Unexpected end of image header");
+}
+
+auto read_netpbm(const std::string &path) -> Image
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Can't open " + path);
+    }
+    const std::string magic = next_token(file);
+    if (magic != "P6" && magic != "P5")
+    {
+        throw std::runtime_error(path + " is not a binary PPM or PGM");
+    }
+    const auto width = static_cast<uint32_t>(std::stoul(next_token(file)));
+    const auto height = static_cast<uint32_t>(std::stoul(next_token(file)));
+    if (std::stoi(next_token(file)) > opaque)
+    {
+        throw std::runtime_error(path + " uses 16 bit samples");
+    }
+    // Exactly one whitespace byte separates the header from the samples
+    file.get();
+
+    const size_t channels = magic == "P6" ? 3 : 1;
+    std::vector<uint8_t> samples(static_cast<size_t>(width) * height * channels);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.read(reinterpret_cast<char *>(samples.data()), static_cast<std::streamsize>(samples.size()));
+    if (!file)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+    return to_rgba(width, height, channels, samples);
+}
+
+auto read_png(const std::string &path) -> Image
+{
+    png_image png{};
+    png.version = PNG_IMAGE_VERSION;
+    if (png_image_begin_read_from_file(&png, path.c_str()) == 0)
+    {
+        throw std::runtime_error(path + ": " + png.message);
+    }
+    // libpng converts palettes, grey and 16 bit samples itself
+    png.format = PNG_FORMAT_RGBA;
+    Image image{png.width, png.height, std::vector<uint8_t>(PNG_IMAGE_SIZE(png))};
+    if (png_image_finish_read(&png, nullptr, image.rgba.data(), 0, nullptr) == 0)
+    {
+        throw std::runtime_error(path + ": " + png.message);
+    }
+    return image;
+}
+
+// libjpeg reports errors through a callback that mustn't return, so it jumps back into read_jpeg
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr jpeg)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    std::longjmp(reinterpret_cast<JpegError *>(jpeg->err)->jump, 1);
+}
+
+auto read_jpeg(const std::string &path) -> Image
+{
+    const std::unique_ptr<FILE, decltype(&std::fclose)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!file)
+    {
+        throw std::runtime_error("Can't open " + path);
+    }
+    // Everything with a destructor is made before the jump point, so jumping back skips none
+    jpeg_decompress_struct jpeg{};
+    JpegError error{};
+    std::vector<uint8_t> samples;
+    std::array<char, JMSG_LENGTH_MAX> message{};
+    jpeg.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = jpeg_error_exit;
+    if (setjmp(error.jump) != 0)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        error.manager.format_message(reinterpret_cast<j_common_ptr>(&jpeg), message.data());
+        jpeg_destroy_decompress(&jpeg);
+        throw std::runtime_error(path + ": " + message.data());
+    }
+    jpeg_create_decompress(&jpeg);
+    jpeg_stdio_src(&jpeg, file.get());
+    jpeg_read_header(&jpeg, TRUE);
+    if (jpeg.jpeg_color_space == JCS_CMYK || jpeg.jpeg_color_space == JCS_YCCK)
+    {
+        jpeg_destroy_decompress(&jpeg);
+        throw std::runtime_error(path + " is a CMYK JPEG");
+    }
+    jpeg_start_decompress(&jpeg);
+    const auto channels = static_cast<size_t>(jpeg.output_components);
+    const size_t row_size = jpeg.output_width * channels;
+    samples.resize(row_size * jpeg.output_height);
+    while (jpeg.output_scanline < jpeg.output_height)
+    {
+        JSAMPROW row = &samples[jpeg.output_scanline * row_size];
+        jpeg_read_scanlines(&jpeg, &row, 1);
+    }
+    jpeg_finish_decompress(&jpeg);
+    const uint32_t width = jpeg.output_width;
+    const uint32_t height = jpeg.output_height;
+    jpeg_destroy_decompress(&jpeg);
+    return to_rgba(width, height, channels, samples);
+}
+
+// Uncompressed or run length encoded true colour and greyscale TGAs, 8, 24 or 32 bits per pixel
+auto read_tga(const std::string &path) -> Image
+{
+    enum : uint8_t
+    {
+        true_colour = 2,
+        grey = 3,
+        rle_true_colour = 10,
+        rle_grey = 11,
+    };
+    const size_t header_size = 18;
+    const uint8_t top_left_origin = 0x20;
+    const uint8_t rle_repeat = 0x80;
+    const uint8_t rle_count = 0x7F;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Can't open " + path);
+    }
+    const std::vector<uint8_t> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (bytes.size() < header_size)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+    const uint8_t type = bytes[2];
+    if (bytes[1] != 0 || (type != true_colour && type != grey && type != rle_true_colour && type != rle_grey))
+    {
+        throw std::runtime_error(path + " is not a true colour or greyscale TGA");
+    }
+    const bool is_grey = type == grey || type == rle_grey;
+    const size_t channels = bytes[16] / 8U;
+    if (is_grey ? channels != 1 : (channels != 3 && channels != 4))
+    {
+        throw std::runtime_error(path + " has an unsupported pixel depth");
+    }
+    const auto width = static_cast<uint32_t>(bytes[12] | (bytes[13] << 8U));
+    const auto height = static_cast<uint32_t>(bytes[14] | (bytes[15] << 8U));
+    const size_t pixels = static_cast<size_t>(width) * height;
+
+    // Samples in file order, pixel by pixel
+    std::vector<uint8_t> stored(pixels * channels);
+    size_t at = header_size + bytes[0];
+    if (type == rle_true_colour || type == rle_grey)
+    {
+        size_t pixel = 0;
+        while (pixel < pixels)
+        {
+            if (at >= bytes.size())
+            {
+                throw std::runtime_error(path + " is truncated");
+            }
+            const uint8_t packet = bytes[at++];
+            const size_t count = std::min<size_t>((packet & rle_count) + 1U, pixels - pixel);
+            const size_t read = (packet & rle_repeat) != 0 ? channels : count * channels;
+            if (at + read > bytes.size())
+            {
+                throw std::runtime_error(path + " is truncated");
+            }
+            for (size_t repeat = 0; repeat < count; repeat++)
+            {
+                const size_t from = (packet & rle_repeat) != 0 ? at : at + (repeat * channels);
+                std::copy_n(&bytes[from], channels, &stored[(pixel + repeat) * channels]);
+            }
+            at += read;
+            pixel += count;
+        }
+    }
+    else
+    {
+        if (at + stored.size() > bytes.size())
+        {
+            throw std::runtime_error(path + " is truncated");
+        }
+        std::copy_n(&bytes[at], stored.size(), stored.data());
+    }
+
+    // TGAs store BGR(A) and usually start at the bottom row
+    const bool top_down = (bytes[17] & top_left_origin) != 0;
+    const size_t row_size = static_cast<size_t>(width) * channels;
+    std::vector<uint8_t> samples(stored.size());
+    for (size_t row = 0; row < height; row++)
+    {
+        const size_t from = (top_down ? row : height - 1 - row) * row_size;
+        std::copy_n(&stored[from], row_size, &samples[row * row_size]);
+    }
+    if (!is_grey)
+    {
+        for (size_t pixel = 0; pixel < pixels; pixel++)
+        {
+            std::swap(samples[pixel * channels], samples[(pixel * channels) + 2]);
+        }
+    }
+    return to_rgba(width, height, channels, samples);
+}
+
+auto read_image(const std::string &path) -> Image
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char letter) {
+        return static_cast<char>(std::tolower(letter));
+    });
+    if (extension == ".png")
+    {
+        return read_png(path);
+    }
+    if (extension == ".jpg" || extension == ".jpeg")
+    {
+        return read_jpeg(path);
+    }
+    if (extension == ".tga")
+    {
+        return read_tga(path);
+    }
+    if (extension == ".ppm" || extension == ".pgm")
+    {
+        return read_netpbm(path);
+    }
+    throw std::runtime_error(path + " isn't a PNG, JPEG, TGA, PPM or PGM");
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    TextureFormat format = TextureFormat::bc1;
+    if (!args.empty() && args[0] == "--rgba8")
+    {
+        format = TextureFormat::rgba8;
+        args.erase(args.begin());
+    }
+    if (args.size() != 2)
+    {
+        std::cerr << "Usage: texbake [--rgba8] input.png output.btex" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        Image image = read_image(args[0]);
+        std::vector<std::vector<uint8_t>> levels;
+        std::vector<uint8_t> level = image.rgba;
+        uint32_t width = image.width;
+        uint32_t height = image.height;
+        const uint32_t count = mip_count(width, height);
+        for (uint32_t mip = 0; mip < count; mip++)
+        {
+            levels.push_back(format == TextureFormat::bc1 ? encode_bc1(level, width, height) : level);
+            if (mip + 1 < count)
+            {
+                level = downsample_rgba8(level, width, height);
+                width = std::max(1U, width / 2);
+                height = std::max(1U, height / 2);
+            }
+        }
+
+        std::ofstream out(args[1], std::ios::binary);
+        write_texture_file(out, format, image.width, image.height, levels);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "texbake: " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
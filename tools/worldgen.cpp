@@ -0,0 +1,187 @@
+// Generates a large streaming test world: a square grid of chunks, each with its own terrain mesh (with coarser levels
+// of detail) and a scattering of box buildings. Terrain heights are continuous across chunk edges and everything is
+// seeded, so the same arguments always produce the same file.
+//
+//     worldgen output.gworld [chunks_per_side] [chunk_size] [terrain_cells]
+#include "world/world_file.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+auto terrain_height(float x, float z) -> float
+{
+    const float broad = 12.0F * std::sin(x * 0.011F) * std::cos(z * 0.013F);
+    const float detail = 2.5F * std::sin(x * 0.07F + z * 0.05F);
+    return broad + detail;
+}
+
+auto terrain_normal(float x, float z) -> glm::vec3
+{
+    const float step = 0.5F;
+    const float dx = terrain_height(x + step, z) - terrain_height(x - step, z);
+    const float dz = terrain_height(x, z + step) - terrain_height(x, z - step);
+    return glm::normalize(glm::vec3(-dx, 2.0F * step, -dz));
+}
+
+// Terrain for the chunk whose corner is at origin, in coordinates relative to that corner
+auto terrain_mesh(glm::vec2 origin, float size, int cells) -> std::vector<WorldVertex>
+{
+    const glm::vec4 low_colour{0.25F, 0.45F, 0.2F, 1.0F};
+    const glm::vec4 high_colour{0.55F, 0.45F, 0.35F, 1.0F};
+    const float height_range = 15.0F;
+    const float cell = size / static_cast<float>(cells);
+    auto vertex_at = [&](int i, int j) {
+        const float x = origin.x + static_cast<float>(i) * cell;
+        const float z = origin.y + static_cast<float>(j) * cell;
+        const float height = terrain_height(x, z);
+        WorldVertex vertex{};
+        vertex.position = {x - origin.x, height, z - origin.y};
+        vertex.normal = terrain_normal(x, z);
+        vertex.colour = glm::mix(low_colour, high_colour, glm::clamp(height / height_range * 0.5F + 0.5F, 0.0F, 1.0F));
+        return vertex;
+    };
+
+    std::vector<WorldVertex> vertices;
+    vertices.reserve(static_cast<size_t>(cells) * static_cast<size_t>(cells) * 6);
+    for (int i = 0; i < cells; i++)
+    {
+        for (int j = 0; j < cells; j++)
+        {
+            vertices.push_back(vertex_at(i, j));
+            vertices.push_back(vertex_at(i, j + 1));
+            vertices.push_back(vertex_at(i + 1, j + 1));
+            vertices.push_back(vertex_at(i, j));
+            vertices.push_back(vertex_at(i + 1, j + 1));
+            vertices.push_back(vertex_at(i + 1, j));
+        }
+    }
+    return vertices;
+}
+
+// Unit box standing on the origin, scaled into buildings by instance transforms
+auto box_mesh(glm::vec4 colour) -> std::vector<WorldVertex>
+{
+    std::vector<WorldVertex> vertices;
+    auto add_face = [&](glm::vec3 normal, glm::vec3 u_axis, glm::vec3 v_axis) {
+        const glm::vec3 centre = normal * 0.5F + glm::vec3(0.0F, 0.5F, 0.0F);
+        const std::array<glm::vec3, 4> corners = {
+            centre - u_axis * 0.5F - v_axis * 0.5F,
+            centre + u_axis * 0.5F - v_axis * 0.5F,
+            centre + u_axis * 0.5F + v_axis * 0.5F,
+            centre - u_axis * 0.5F + v_axis * 0.5F,
+        };
+        for (size_t corner : {0, 1, 2, 0, 2, 3})
+        {
+            WorldVertex vertex{};
+            vertex.position = corners.at(corner);
+            vertex.normal = normal;
+            vertex.colour = colour;
+            vertices.push_back(vertex);
+        }
+    };
+    const glm::vec3 x_axis{1.0F, 0.0F, 0.0F};
+    const glm::vec3 y_axis{0.0F, 1.0F, 0.0F};
+    const glm::vec3 z_axis{0.0F, 0.0F, 1.0F};
+    add_face(z_axis, x_axis, y_axis);
+    add_face(-z_axis, -x_axis, y_axis);
+    add_face(x_axis, -z_axis, y_axis);
+    add_face(-x_axis, z_axis, y_axis);
+    add_face(y_axis, x_axis, -z_axis);
+    add_face(-y_axis, x_axis, z_axis);
+    return vertices;
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (args.empty() || args.size() > 4)
+    {
+        std::cerr << "Usage: worldgen output.gworld [chunks_per_side] [chunk_size] [terrain_cells]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const int chunks_per_side = args.size() > 1 ? std::stoi(args[1]) : 32;
+        const float chunk_size = args.size() > 2 ? std::stof(args[2]) : 64.0F;
+        const int terrain_cells = args.size() > 3 ? std::stoi(args[3]) : 24;
+        if (chunks_per_side <= 0 || chunk_size <= 0.0F || terrain_cells <= 0)
+        {
+            throw std::invalid_argument("World dimensions must be positive");
+        }
+
+        const MaterialValues terrain_material{glm::vec3(0.3F), glm::vec3(0.9F), glm::vec3(0.05F), 4.0F};
+        std::mt19937 random(chunks_per_side);
+        std::uniform_real_distribution<float> unit(0.0F, 1.0F);
+        const int max_buildings = 12;
+        std::uniform_int_distribution<int> building_count(0, max_buildings);
+
+        std::vector<ChunkEntry> entries;
+        std::vector<ChunkData> chunks;
+        // Centred on the origin so the game's camera starts inside the world
+        const int first = -chunks_per_side / 2;
+        for (int x = first; x < first + chunks_per_side; x++)
+        {
+            for (int z = first; z < first + chunks_per_side; z++)
+            {
+                const glm::vec2 origin{static_cast<float>(x) * chunk_size, static_cast<float>(z) * chunk_size};
+                ChunkData chunk;
+                ChunkMesh terrain;
+                for (int cells = terrain_cells; terrain.lods.size() < max_mesh_lods; cells = std::max(1, cells / 2))
+                {
+                    terrain.lods.push_back(terrain_mesh(origin, chunk_size, cells));
+                }
+                chunk.meshes.push_back(std::move(terrain));
+                chunk.instances.push_back(
+                    {0, glm::translate(glm::mat4(1.0F), glm::vec3(origin.x, 0.0F, origin.y)), terrain_material}
+                );
+
+                const glm::vec4 building_colour{0.6F + 0.3F * unit(random), 0.6F, 0.6F + 0.3F * unit(random), 1.0F};
+                chunk.meshes.push_back({{box_mesh(building_colour)}});
+                const int buildings = building_count(random);
+                for (int building = 0; building < buildings; building++)
+                {
+                    const float base_x = origin.x + unit(random) * chunk_size;
+                    const float base_z = origin.y + unit(random) * chunk_size;
+                    const glm::vec3 size{
+                        4.0F + 8.0F * unit(random), 8.0F + 50.0F * unit(random), 4.0F + 8.0F * unit(random)
+                    };
+                    glm::mat4 transform = glm::translate(
+                        glm::mat4(1.0F), glm::vec3(base_x, terrain_height(base_x, base_z) - 1.0F, base_z)
+                    );
+                    transform = glm::rotate(transform, unit(random) * glm::pi<float>(), glm::vec3(0.0F, 1.0F, 0.0F));
+                    transform = glm::scale(transform, size);
+                    const MaterialValues material{
+                        glm::vec3(0.2F), glm::vec3(0.8F), glm::vec3(0.3F), 8.0F + 56.0F * unit(random)
+                    };
+                    chunk.instances.push_back({1, transform, material});
+                }
+
+                entries.push_back({x, z, {}, 0, 0, 0});
+                chunks.push_back(std::move(chunk));
+            }
+        }
+
+        std::ofstream out(args[0], std::ios::binary);
+        write_world(out, chunk_size, entries, chunks);
+        std::cout << "Wrote " << chunks.size() << " chunks to " << args[0] << std::endl;
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "worldgen: " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}